@@ -29,20 +29,49 @@ void run() {
     driver.runTest();
   } else if (FLAGS_joe_task == "infer") {
     driver.runInfer();
+  } else if (FLAGS_joe_task == "convert") {
+    driver.runConvert();
+  } else if (FLAGS_joe_task == "serve") {
+    driver.runServe();
+  } else if (FLAGS_joe_task == "quantize") {
+    driver.runQuantize();
+  } else if (FLAGS_joe_task == "compact") {
+    driver.runCompact();
   }
 }
 
 void checkFlags() {
   if (FLAGS_joe_task != "train" && FLAGS_joe_task != "test" &&
-      FLAGS_joe_task != "infer") {
+      FLAGS_joe_task != "infer" && FLAGS_joe_task != "convert" &&
+      FLAGS_joe_task != "serve" && FLAGS_joe_task != "quantize" &&
+      FLAGS_joe_task != "compact") {
     LOG(FATAL) << "Joe unrecognized command-line flag -joe_task "
                << FLAGS_joe_task;
   }
-  if (FLAGS_joe_tensor != "double" && FLAGS_joe_tensor != "float") {
+  if (FLAGS_joe_tensor != "double" && FLAGS_joe_tensor != "float" &&
+      FLAGS_joe_tensor != "half" && FLAGS_joe_tensor != "quant" &&
+      FLAGS_joe_tensor != "sparse") {
     LOG(FATAL) << "Joe unrecognized command-line flag -joe_tensor "
                << FLAGS_joe_tensor;
   }
-  if (FLAGS_joe_hash != "fnv" && FLAGS_joe_hash != "city") {
+  // Quantized and compacted models are converted from trained models and
+  // never trained
+  if (FLAGS_joe_tensor == "quant" && FLAGS_joe_task == "train") {
+    LOG(FATAL) << "Joe cannot train with -joe_tensor quant, train a double or"
+               << " float model and quantize it";
+  }
+  if (FLAGS_joe_task == "quantize" && FLAGS_joe_tensor != "quant") {
+    LOG(FATAL) << "Joe task quantize needs -joe_tensor quant";
+  }
+  if (FLAGS_joe_tensor == "sparse" && FLAGS_joe_task == "train") {
+    LOG(FATAL) << "Joe cannot train with -joe_tensor sparse, train a double"
+               << " or float model and compact it";
+  }
+  if (FLAGS_joe_task == "compact" && FLAGS_joe_tensor != "sparse") {
+    LOG(FATAL) << "Joe task compact needs -joe_tensor sparse";
+  }
+  if (FLAGS_joe_hash != "fnv" && FLAGS_joe_hash != "city" &&
+      FLAGS_joe_hash != "rolling") {
     LOG(FATAL) << "Joe unrecognized command-line flag -joe_hash "
                << FLAGS_joe_hash;
   }
@@ -50,6 +79,41 @@ void checkFlags() {
     LOG(FATAL) << "Joe unrecognized command-line flag -joe_loss "
                << FLAGS_joe_loss;
   }
+  if (FLAGS_infer_score != "none" && FLAGS_infer_score != "raw" &&
+      FLAGS_infer_score != "probability") {
+    LOG(FATAL) << "Joe unrecognized command-line flag -infer_score "
+               << FLAGS_infer_score;
+  }
+  if (FLAGS_data_shuffle == true && FLAGS_data_shuffle_size == 0) {
+    LOG(FATAL) << "Joe unrecognized command-line flag -data_shuffle_size "
+               << FLAGS_data_shuffle_size;
+  }
+  if (FLAGS_train_batch_size == 0) {
+    LOG(FATAL) << "Joe unrecognized command-line flag -train_batch_size "
+               << FLAGS_train_batch_size;
+  }
+  if (FLAGS_model_page != "default" && FLAGS_model_page != "huge" &&
+      FLAGS_model_page != "hugetlb") {
+    LOG(FATAL) << "Joe unrecognized command-line flag -model_page "
+               << FLAGS_model_page;
+  }
+  if (FLAGS_model_policy != "default" && FLAGS_model_policy != "interleave" &&
+      FLAGS_model_policy != "bind") {
+    LOG(FATAL) << "Joe unrecognized command-line flag -model_policy "
+               << FLAGS_model_policy;
+  }
+  if (FLAGS_quantize_bits != 8 && FLAGS_quantize_bits != 4) {
+    LOG(FATAL) << "Joe unrecognized command-line flag -quantize_bits "
+               << FLAGS_quantize_bits;
+  }
+  if (FLAGS_quantize_tensor != "double" && FLAGS_quantize_tensor != "float") {
+    LOG(FATAL) << "Joe unrecognized command-line flag -quantize_tensor "
+               << FLAGS_quantize_tensor;
+  }
+  if (FLAGS_compact_tensor != "double" && FLAGS_compact_tensor != "float") {
+    LOG(FATAL) << "Joe unrecognized command-line flag -compact_tensor "
+               << FLAGS_compact_tensor;
+  }
 }
 
 int main(int argc, char *argv[]) {
@@ -74,10 +138,32 @@ int main(int argc, char *argv[]) {
   map["float-fnv-nll"] = run< FloatFNVNLLDriver >;
   map["double-city-nll"] = run< DoubleCityNLLDriver >;
   map["float-city-nll"] = run< FloatCityNLLDriver >;
+  map["double-rolling-nll"] = run< DoubleRollingNLLDriver >;
+  map["float-rolling-nll"] = run< FloatRollingNLLDriver >;
   map["double-fnv-hinge"] = run< DoubleFNVHingeDriver >;
   map["float-fnv-hinge"] = run< FloatFNVHingeDriver >;
   map["double-city-hinge"] = run< DoubleCityHingeDriver >;
   map["float-city-hinge"] = run< FloatCityHingeDriver >;
+  map["double-rolling-hinge"] = run< DoubleRollingHingeDriver >;
+  map["float-rolling-hinge"] = run< FloatRollingHingeDriver >;
+  map["half-fnv-nll"] = run< HalfFNVNLLDriver >;
+  map["half-city-nll"] = run< HalfCityNLLDriver >;
+  map["half-rolling-nll"] = run< HalfRollingNLLDriver >;
+  map["half-fnv-hinge"] = run< HalfFNVHingeDriver >;
+  map["half-city-hinge"] = run< HalfCityHingeDriver >;
+  map["half-rolling-hinge"] = run< HalfRollingHingeDriver >;
+  map["quant-fnv-nll"] = run< QuantFNVNLLDriver >;
+  map["quant-city-nll"] = run< QuantCityNLLDriver >;
+  map["quant-rolling-nll"] = run< QuantRollingNLLDriver >;
+  map["quant-fnv-hinge"] = run< QuantFNVHingeDriver >;
+  map["quant-city-hinge"] = run< QuantCityHingeDriver >;
+  map["quant-rolling-hinge"] = run< QuantRollingHingeDriver >;
+  map["sparse-fnv-nll"] = run< SparseFNVNLLDriver >;
+  map["sparse-city-nll"] = run< SparseCityNLLDriver >;
+  map["sparse-rolling-nll"] = run< SparseRollingNLLDriver >;
+  map["sparse-fnv-hinge"] = run< SparseFNVHingeDriver >;
+  map["sparse-city-hinge"] = run< SparseCityHingeDriver >;
+  map["sparse-rolling-hinge"] = run< SparseRollingHingeDriver >;
   map[FLAGS_joe_tensor + "-" + FLAGS_joe_hash + "-" + FLAGS_joe_loss]();
 
   // Clean up Google gflags
@@ -17,9 +17,14 @@
 #include "bytesteady/data.hpp"
 #include "bytesteady/driver.hpp"
 #include "bytesteady/flags.hpp"
+#include "bytesteady/half_tensor.hpp"
 #include "bytesteady/hash.hpp"
 #include "bytesteady/loss.hpp"
 #include "bytesteady/model.hpp"
+#include "bytesteady/model_map.hpp"
+#include "bytesteady/predictor.hpp"
+#include "bytesteady/quant_tensor.hpp"
+#include "bytesteady/sparse_tensor.hpp"
 #include "bytesteady/test.hpp"
 #include "bytesteady/train.hpp"
 #include "bytesteady/universum.hpp"
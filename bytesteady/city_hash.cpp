@@ -169,4 +169,13 @@ uint64_t CityHash::hash64(const uint8_t *s, uint64_t len, uint64_t seed) {
   return hashLen16(cityHash64(s, len) - k2, seed, k3);
 }
 
+void CityHash::reset(const uint8_t *s, uint64_t len, uint64_t seed) {
+  data_ = s;
+  seed_ = seed;
+}
+
+uint64_t CityHash::gram64(uint64_t pos, uint64_t len) const {
+  return hash64(data_ + pos, len, seed_);
+}
+
 }  // namespace bytesteady
@@ -21,6 +21,15 @@ namespace bytesteady {
 class CityHash {
  public:
   static uint64_t hash64(const uint8_t *s, uint64_t len, uint64_t seed);
+
+  // Set the byte sequence to hash n-grams from
+  void reset(const uint8_t *s, uint64_t len, uint64_t seed);
+  // Hash of the n-gram of length len starting at pos of the sequence
+  uint64_t gram64(uint64_t pos, uint64_t len) const;
+
+ private:
+  const uint8_t *data_ = nullptr;
+  uint64_t seed_ = 0;
 };
 
 }  // namespace bytesteady
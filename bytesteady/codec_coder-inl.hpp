@@ -20,6 +20,7 @@
 #include <variant>
 #include <vector>
 
+#include "bytesteady/field_format.hpp"
 #include "bytesteady/integer.hpp"
 
 namespace bytesteady {
@@ -94,19 +95,19 @@ void CodecCoder< D, C >::encodeJob(
   index_pair &data_label = local.data_label;
   field_array &data_output = local.data_output;
 
-  byte_array output_field_bytes;
   result = true;
   while(data_->getSample(&data_input, &data_label, &data_index)) {
     mutex->lock();
-    data_output.clear();
+    // Overwrite the output fields in place to reuse their storage
+    data_output.resize(data_input.size());
     for (size_type i = 0; i < data_input.size(); ++i) {
       if ((*codec_).find(i) != (*codec_).end()) {
         const byte_array &input_field_bytes =
             ::std::get< byte_array >(data_input[i]);
-        (*codec_)[i].encode(input_field_bytes, &output_field_bytes);
-        data_output.push_back(output_field_bytes);
+        (*codec_)[i].encode(input_field_bytes,
+                            resetField< byte_array >(&data_output, i));
       } else {
-        data_output.push_back(data_input[i]);
+        data_output[i] = data_input[i];
       }
     }
     mutex->unlock();
@@ -128,19 +129,19 @@ void CodecCoder< D, C >::decodeJob(
   index_pair &data_label = local.data_label;
   field_array &data_output = local.data_output;
 
-  byte_array output_field_bytes;
   result = true;
   while(data_->getSample(&data_input, &data_label, &data_index)) {
     mutex->lock();
-    data_output.clear();
+    // Overwrite the output fields in place to reuse their storage
+    data_output.resize(data_input.size());
     for (size_type i = 0; i < data_input.size(); ++i) {
       if ((*codec_).find(i) != (*codec_).end()) {
         const byte_array &input_field_bytes =
             ::std::get< byte_array >(data_input[i]);
-        (*codec_)[i].decode(input_field_bytes, &output_field_bytes);
-        data_output.push_back(output_field_bytes);
+        (*codec_)[i].decode(input_field_bytes,
+                            resetField< byte_array >(&data_output, i));
       } else {
-        data_output.push_back(data_input[i]);
+        data_output[i] = data_input[i];
       }
     }
     mutex->unlock();
@@ -13,9 +13,22 @@
 
 #include "bytesteady/data.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <numeric>
+#include <random>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -26,135 +39,935 @@ namespace bytesteady {
 
 template < typename T >
 Data< T >::Data(
-    const ::std::string &fn, const format_array &ft) :
-    file_(fn), format_(ft), count_(0), fp_(::std::fopen(fn.c_str(), "r")) {}
+    const ::std::string &fn, const format_array &ft, size_type s) :
+    file_(fn), format_(ft), current_(0), map_(nullptr), map_size_(0),
+    map_flags_(0), map_index_(0), cache_size_(0), cache_usage_(0),
+    shuffle_size_(0), shuffle_seed_(0), pass_(0) {
+  for (size_type i = 0; i < (s == 0 ? 1 : s); ++i) {
+    shards_.push_back(::std::make_unique< Shard >());
+  }
+  open();
+}
 
 template < typename T >
 Data< T >::~Data() {
   ::std::lock_guard< ::std::mutex > lock(file_mutex_);
-  ::std::fclose(fp_);
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    if (shard->fp != nullptr) {
+      ::std::fclose(shard->fp);
+    }
+  }
+  if (map_ != nullptr) {
+    ::munmap(const_cast< uint8_t * >(map_), map_size_);
+  }
 }
 
 template < typename T >
-bool Data< T >::rewind() {
-  ::std::lock_guard< ::std::mutex > lock(file_mutex_);
-  if (fp_ == nullptr) {
-    fp_ = ::std::fopen(file_.c_str(), "r");
+bool Data< T >::open() {
+  if (map_ != nullptr) {
+    return true;
   }
-  if (fp_ == nullptr) {
+  bool opened = shards_[0]->fp == nullptr;
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    if (shard->fp == nullptr) {
+      shard->fp = ::std::fopen(file_.c_str(), "r");
+    }
+    if (shard->fp == nullptr) {
+      return false;
+    }
+  }
+  // Check for the binary format when the file is first opened
+  if (opened == true) {
+    char magic[sizeof(kMagic)];
+    if (::std::fread(magic, 1, sizeof(kMagic), shards_[0]->fp) ==
+        sizeof(kMagic) &&
+        ::std::memcmp(magic, kMagic, sizeof(kMagic)) == 0) {
+      return openBinary();
+    }
+  }
+  if (shards_.size() == 1) {
+    return seekShard(shards_[0].get(), tellShard(shards_[0].get()));
+  }
+  // Shards are split once, so that opening again never moves a shard that
+  // was sought on its own
+  if (opened == false) {
+    return true;
+  }
+  // Find the file size
+  FILE *fp = shards_[0]->fp;
+  if (::std::fseek(fp, 0, SEEK_END) != 0) {
     return false;
   }
-  ::std::rewind(fp_);
-  count_ = 0;
+  long size = ::std::ftell(fp);
+  // Move each shard beginning to the start of the next line
+  shards_[0]->begin = 0;
+  for (size_type i = 1; i < shards_.size(); ++i) {
+    long begin = static_cast< long >(
+        static_cast< double >(size) * static_cast< double >(i) /
+        static_cast< double >(shards_.size()));
+    if (begin <= shards_[i - 1]->begin) {
+      begin = shards_[i - 1]->begin;
+    } else {
+      if (::std::fseek(fp, begin - 1, SEEK_SET) != 0) {
+        return false;
+      }
+      int c = ::std::fgetc(fp);
+      while (c != '\n' && c != EOF) {
+        c = ::std::fgetc(fp);
+      }
+      begin = ::std::ftell(fp);
+    }
+    shards_[i]->begin = begin;
+    shards_[i - 1]->end = begin;
+  }
+  shards_.back()->end = size;
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    if (seekShard(shard.get(), shard->begin) == false) {
+      return false;
+    }
+  }
   return true;
 }
 
 template < typename T >
-bool Data< T >::seek(long os, size_type ct) {
-  ::std::lock_guard< ::std::mutex > lock(file_mutex_);
-  if (fp_ == nullptr) {
-    fp_ = ::std::fopen(file_.c_str(), "r");
+bool Data< T >::openBinary() {
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    ::std::fclose(shard->fp);
+    shard->fp = nullptr;
+  }
+  int fd = ::open(file_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    ::close(fd);
+    return false;
+  }
+  size_type size = static_cast< size_type >(status.st_size);
+  void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    return false;
   }
-  if (fp_ == nullptr) {
+  const uint8_t *map = static_cast< const uint8_t * >(address);
+
+  // Magic, field count, record count, index offset and flags
+  uint64_t header[5];
+  bool valid = size >= sizeof(header);
+  if (valid == true) {
+    ::std::memcpy(header, map, sizeof(header));
+    valid = header[1] == format_.size() &&
+        header[1] <= size - sizeof(header) && header[3] <= size &&
+        header[2] <= (size - header[3]) / sizeof(uint64_t);
+  }
+  for (size_type i = 0; valid == true && i < format_.size(); ++i) {
+    valid = map[sizeof(header) + i] == static_cast< uint8_t >(format_[i]);
+  }
+  if (valid == false) {
+    ::munmap(address, size);
+    return false;
+  }
+  if (shards_.size() == 1) {
+    ::madvise(address, size, MADV_SEQUENTIAL);
+  }
+  map_ = map;
+  map_size_ = size;
+  map_flags_ = header[4];
+  map_index_ = header[3];
+
+  // Split records evenly among the shards using the index
+  uint64_t record_size = header[2];
+  auto shardOffset = [&](uint64_t record) -> long {
+    return record < record_size ? recordOffset(record) :
+        static_cast< long >(map_index_);
+  };
+  for (size_type i = 0; i < shards_.size(); ++i) {
+    Shard *shard = shards_[i].get();
+    shard->record_begin = record_size * i / shards_.size();
+    shard->record_end = record_size * (i + 1) / shards_.size();
+    shard->begin = shardOffset(shard->record_begin);
+    shard->end = shardOffset(shard->record_end);
+    seekShard(shard, shard->begin);
+  }
+  return true;
+}
+
+template < typename T >
+bool Data< T >::rewind() {
+  ::std::lock_guard< ::std::mutex > lock(file_mutex_);
+  if (open() == false) {
     return false;
   }
-  if (::std::fseek(fp_, os, SEEK_SET) != 0) {
+  pass_ = pass_ + 1;
+  for (size_type i = 0; i < shards_.size(); ++i) {
+    Shard *shard = shards_[i].get();
+    ::std::lock_guard< ::std::mutex > shard_lock(shard->mutex);
+    shard->count = 0;
+    if (shard->cache_state == kCacheFull) {
+      shard->cache_record = 0;
+    } else {
+      // Cache the shard in this pass unless it exceeded the budget before
+      if (map_ == nullptr && cache_size_ > 0 &&
+          shard->cache_state != kCacheOver) {
+        dropCache(shard, kCacheFill);
+      }
+      if (seekShard(shard, shard->begin) == false) {
+        return false;
+      }
+    }
+    shuffleShard(shard, i);
+  }
+  current_ = 0;
+  return true;
+}
+
+template < typename T >
+bool Data< T >::seek(long os, size_type ct) {
+  if (seek(0, os, ct) == false) {
     return false;
   }
-  count_ = ct;
+  ::std::lock_guard< ::std::mutex > lock(file_mutex_);
+  current_ = 0;
   return true;
 }
 
+template < typename T >
+bool Data< T >::seek(size_type shard, long os, size_type ct) {
+  return seek(shard, os, ct, shard < shards_.size() && ordered(shard));
+}
+
+template < typename T >
+bool Data< T >::seek(
+    size_type shard, long os, size_type ct, bool ordered) {
+  ::std::lock_guard< ::std::mutex > lock(file_mutex_);
+  if (shard >= shards_.size() || open() == false) {
+    return false;
+  }
+  Shard *current = shards_[shard].get();
+  ::std::lock_guard< ::std::mutex > shard_lock(current->mutex);
+  if (shuffle_size_ > 0) {
+    // Replay the pass of the shard up to the position. A text shard is
+    // read from the cache exactly when the pass read it in a permutation.
+    if (current->cache_state == kCacheFill ||
+        (map_ == nullptr && current->cache_state == kCacheFull &&
+         ordered == false)) {
+      dropCache(current, kCacheFill);
+    }
+    if (current->cache_state != kCacheFull &&
+        seekShard(current, current->begin) == false) {
+      return false;
+    }
+    if (map_ == nullptr && ordered == true &&
+        current->cache_state != kCacheFull) {
+      field_array input;
+      index_pair label;
+      while (current->cache_state == kCacheFill &&
+             readFile(current, &input, &label) == true) {}
+      if (current->cache_state != kCacheFull) {
+        return false;
+      }
+    }
+    shuffleShard(current, shard);
+    if (current->shuffle_state == kShuffleOrder) {
+      current->order_record = ::std::min(ct, current->order.size());
+    } else {
+      field_array input;
+      index_pair label;
+      size_type count = 0;
+      while (count < ct && readPool(current, &input, &label) == true) {
+        count = count + 1;
+      }
+    }
+    current->count = ct;
+    return true;
+  }
+  if (current->shuffle_state != kShuffleOff) {
+    shuffleShard(current, shard);
+  }
+  current->count = ct;
+  if (current->cache_state == kCacheFull) {
+    auto record = ::std::lower_bound(
+        current->cache_index.begin(), current->cache_index.end(),
+        cache_entry(os, 0));
+    if (record != current->cache_index.end() && record->first == os) {
+      current->cache_record = record - current->cache_index.begin();
+      return true;
+    }
+  }
+  // A partial pass cannot complete the cache
+  if (current->cache_state == kCacheFill ||
+      current->cache_state == kCacheFull) {
+    dropCache(current, kCacheOff);
+  }
+  return seekShard(current, os);
+}
+
 template < typename T >
 bool Data< T >::getSample(
     field_array *input, index_pair *label, size_type *count) {
   ::std::lock_guard< ::std::mutex > lock(file_mutex_);
-  input->clear();
+  while (current_ < shards_.size()) {
+    Shard *shard = shards_[current_].get();
+    ::std::lock_guard< ::std::mutex > shard_lock(shard->mutex);
+    if (count != nullptr) {
+      *count = 0;
+      for (size_type i = 0; i <= current_; ++i) {
+        *count = *count + shards_[i]->count;
+      }
+    }
+    if (readSample(shard, input, label) == true) {
+      return true;
+    }
+    // Read error at the last shard is reported as is
+    if (current_ + 1 == shards_.size()) {
+      return false;
+    }
+    current_ = current_ + 1;
+  }
+  return false;
+}
+
+template < typename T >
+bool Data< T >::getSample(
+    size_type *shard, size_type step, field_array *input, index_pair *label,
+    size_type *count) {
+  while (*shard < shards_.size()) {
+    Shard *current = shards_[*shard].get();
+    ::std::lock_guard< ::std::mutex > shard_lock(current->mutex);
+    if (count != nullptr) {
+      *count = current->count;
+    }
+    if (readSample(current, input, label) == true) {
+      return true;
+    }
+    *shard = *shard + (step == 0 ? shards_.size() : step);
+  }
+  return false;
+}
+
+template < typename T >
+bool Data< T >::readSample(
+    Shard *shard, field_array *input, index_pair *label) {
+  bool success;
+  if (shard->shuffle_state == kShuffleOrder) {
+    success = readOrder(shard, input, label);
+  } else if (shard->shuffle_state == kShufflePool) {
+    success = readPool(shard, input, label);
+  } else {
+    success = readNext(shard, input, label);
+  }
+  if (success == true) {
+    shard->count = shard->count + 1;
+  }
+  return success;
+}
+
+template < typename T >
+bool Data< T >::readNext(
+    Shard *shard, field_array *input, index_pair *label) {
+  if (map_ != nullptr) {
+    return readBinary(shard, input, label);
+  }
+  if (shard->cache_state == kCacheFull) {
+    return readCache(shard, input, label);
+  }
+  return readFile(shard, input, label);
+}
+
+template < typename T >
+bool Data< T >::readFile(
+    Shard *shard, field_array *input, index_pair *label) {
+  long offset = tellShard(shard);
+  if (readText(shard, input, label) == false) {
+    if (shard->cache_state == kCacheFill) {
+      // The shard is read through, so later passes can use the cache
+      shard->cache_index.push_back(
+          ::std::make_pair(tellShard(shard), shard->cache.size()));
+      shard->cache_record = shard->cache_index.size() - 1;
+      shard->cache_state = kCacheFull;
+    }
+    return false;
+  }
+  if (shard->cache_state == kCacheFill) {
+    cacheSample(shard, offset, *input, label);
+  }
+  return true;
+}
+
+template < typename T >
+bool Data< T >::readText(
+    Shard *shard, field_array *input, index_pair *label) {
+  // Fields are filled in place to reuse their storage
+  input->resize(format_.size());
+  // Stop at the end of the shard
+  if (shard->end >= 0) {
+    skipSpace(shard);
+    if (tellShard(shard) >= shard->end) {
+      return false;
+    }
+  }
   size_type index;
   double weight;
-  char separator[2];
-  char hex[3];
   for (size_type i = 0; i < format_.size(); ++i) {
     if (format_[i] == kIndex) {
-      indices_.clear();
-      // Read the first index
-      if (fscanf(fp_, "%lu", &index) != 1) {
-        return false;
-      }
-      weight = 1.0;
-      if (fscanf(fp_, " %1[:]", separator) == 1 && separator[0] == ':') {
-        // Saw a ':', the next value is weight
-        if (fscanf(fp_, "%lg", &weight) != 1) {
-          return false;
-        }
-      }
-      indices_.push_back(::std::make_pair(
-          index, static_cast< value_type >(weight)));
-      while (fscanf(fp_, " %1[,]", separator) == 1 && separator[0] == ',') {
-        // Saw a ',', read the next index
-        if (fscanf(fp_, "%lu", &index) != 1) {
+      index_array &indices = *resetField< index_array >(input, i);
+      do {
+        // Read an index and its optional weight after a ':'
+        if (readIndex(shard, &index) == false) {
           return false;
         }
         weight = 1.0;
-        if (fscanf(fp_, " %1[:]", separator) == 1 && separator[0] == ':') {
-          // Saw a ':', the next value is weight
-          if (fscanf(fp_, "%lg", &weight) != 1) {
-            return false;
-          }
+        if (readChar(shard, ':') == true &&
+            readWeight(shard, &weight) == false) {
+          return false;
         }
-        indices_.push_back(::std::make_pair(
+        indices.push_back(::std::make_pair(
             index, static_cast< value_type >(weight)));
-      }
-      input->push_back(indices_);
+        // Saw a ',', read the next index
+      } while (readChar(shard, ',') == true);
     } else if (format_[i] == kBytes) {
-      bytes_.clear();
-      // Skip the beginning white spaces and read the first hex
-      if (fscanf(fp_, " %2[0123456789ABCDEFabcdef]", hex) != 1 ||
-          hex[0] == '\0' || hex[1] == '\0') {
+      byte_array &bytes = *resetField< byte_array >(input, i);
+      // Skip the beginning white spaces and read hex pairs
+      skipSpace(shard);
+      if (readHex(shard, &bytes) == false) {
         return false;
       }
-      bytes_.push_back(
-          static_cast< uint8_t >(::std::strtoul(hex, nullptr, 16)));
-      // No skipping of beginning white spaces for the second hex and after
-      while (fscanf(fp_, "%2[0123456789ABCDEFabcdef]", hex) == 1 &&
-             hex[0] != '\0' && hex[1] != '\0') {
-        bytes_.push_back(
-            static_cast< uint8_t >(::std::strtoul(hex, nullptr, 16)));
-      }
-      input->push_back(bytes_);
     }
   }
 
   // Read label if the pointer is not nullptr
   if (label != nullptr) {
-    if (fscanf(fp_, "%lu", &index) != 1) {
+    if (readIndex(shard, &index) == false) {
       return false;
     }
     weight = 1.0;
-    if (fscanf(fp_, " %1[:]", separator) == 1 && separator[0] == ':') {
-      // Saw a ':', the next value is weight
-      if (fscanf(fp_, "%lg", &weight) != 1) {
+    if (readChar(shard, ':') == true && readWeight(shard, &weight) == false) {
+      return false;
+    }
+    label->first = index;
+    label->second = static_cast< value_type >(weight);
+  }
+
+  return true;
+}
+
+template < typename T >
+bool Data< T >::readBinary(
+    Shard *shard, field_array *input, index_pair *label) {
+  long cursor = shard->buffer_offset;
+  if (cursor < 0 || cursor >= shard->end ||
+      map_size_ - static_cast< size_type >(cursor) < sizeof(uint64_t)) {
+    return false;
+  }
+  uint64_t length;
+  ::std::memcpy(&length, map_ + cursor, sizeof(uint64_t));
+  const uint8_t *position = map_ + cursor + sizeof(uint64_t);
+  if (length > static_cast< uint64_t >(map_ + map_size_ - position)) {
+    return false;
+  }
+  const uint8_t *limit = position + length;
+  if (readRecord(position, limit, (map_flags_ & kLabelFlag) != 0, input,
+                 label) == false) {
+    return false;
+  }
+
+  shard->buffer_offset = static_cast< long >(limit - map_);
+  return true;
+}
+
+template < typename T >
+bool Data< T >::readCache(
+    Shard *shard, field_array *input, index_pair *label) {
+  if (shard->cache_record + 1 >= shard->cache_index.size()) {
+    return false;
+  }
+  const uint8_t *position =
+      shard->cache.data() + shard->cache_index[shard->cache_record].second;
+  const uint8_t *limit =
+      shard->cache.data() + shard->cache_index[shard->cache_record + 1].second;
+  if (readRecord(position + sizeof(uint64_t), limit, true, input, label) ==
+      false) {
+    return false;
+  }
+  shard->cache_record = shard->cache_record + 1;
+  return true;
+}
+
+template < typename T >
+bool Data< T >::readRecord(
+    const uint8_t *position, const uint8_t *limit, bool labeled,
+    field_array *input, index_pair *label) {
+  input->resize(format_.size());
+  // Each index pair is stored as an index and a double weight
+  const size_type pair_size = sizeof(uint64_t) + sizeof(double);
+  uint64_t size;
+  uint64_t index;
+  double weight;
+  for (size_type i = 0; i < format_.size(); ++i) {
+    if (static_cast< size_type >(limit - position) < sizeof(uint64_t)) {
+      return false;
+    }
+    ::std::memcpy(&size, position, sizeof(uint64_t));
+    position = position + sizeof(uint64_t);
+    if (format_[i] == kIndex) {
+      if (size > static_cast< size_type >(limit - position) / pair_size) {
+        return false;
+      }
+      index_array &indices = *resetField< index_array >(input, i);
+      indices.resize(size);
+      for (size_type j = 0; j < size; ++j) {
+        ::std::memcpy(&index, position, sizeof(uint64_t));
+        ::std::memcpy(&weight, position + sizeof(uint64_t), sizeof(double));
+        indices[j].first = static_cast< size_type >(index);
+        indices[j].second = static_cast< value_type >(weight);
+        position = position + pair_size;
+      }
+    } else if (format_[i] == kBytes) {
+      if (size > static_cast< size_type >(limit - position)) {
         return false;
       }
+      // The only copy of the bytes, straight from the mapping or cache
+      resetField< byte_array >(input, i)->assign(position, position + size);
+      position = position + size;
     }
-    label->first = index;
+  }
+
+  // Read label if the pointer is not nullptr
+  if (label != nullptr) {
+    if (labeled == false ||
+        static_cast< size_type >(limit - position) < pair_size) {
+      return false;
+    }
+    ::std::memcpy(&index, position, sizeof(uint64_t));
+    ::std::memcpy(&weight, position + sizeof(uint64_t), sizeof(double));
+    label->first = static_cast< size_type >(index);
     label->second = static_cast< value_type >(weight);
   }
 
-  if (count != nullptr) {
-    *count = count_;
+  return true;
+}
+
+template < typename T >
+void Data< T >::appendRecord(
+    const field_array &input, const index_pair *label, byte_array *record) {
+  size_type begin = record->size();
+  auto append = [record](const void *value, size_type n) -> void {
+    const uint8_t *bytes = static_cast< const uint8_t * >(value);
+    record->insert(record->end(), bytes, bytes + n);
+  };
+  // Leave space for the length
+  uint64_t size = 0;
+  append(&size, sizeof(uint64_t));
+  uint64_t index;
+  double weight;
+  for (const field_variant &field : input) {
+    const index_array *field_index;
+    const byte_array *field_bytes;
+    if ((field_index = ::std::get_if< index_array >(&field)) != nullptr) {
+      size = field_index->size();
+      append(&size, sizeof(uint64_t));
+      for (const index_pair &index_weight : *field_index) {
+        index = index_weight.first;
+        weight = index_weight.second;
+        append(&index, sizeof(uint64_t));
+        append(&weight, sizeof(double));
+      }
+    } else if ((field_bytes = ::std::get_if< byte_array >(&field)) !=
+               nullptr) {
+      size = field_bytes->size();
+      append(&size, sizeof(uint64_t));
+      append(field_bytes->data(), field_bytes->size());
+    }
+  }
+  if (label != nullptr) {
+    index = label->first;
+    weight = label->second;
+    append(&index, sizeof(uint64_t));
+    append(&weight, sizeof(double));
+  }
+  size = record->size() - begin - sizeof(uint64_t);
+  ::std::memcpy(record->data() + begin, &size, sizeof(uint64_t));
+}
+
+template < typename T >
+void Data< T >::cacheSample(Shard *shard, long os, const field_array &input,
+                            const index_pair *label) {
+  // Records are read back with their labels
+  if (label == nullptr) {
+    dropCache(shard, kCacheOff);
+    return;
+  }
+  // Count the capacity, which is what the cache holds on to
+  size_type capacity = cacheCapacity(shard);
+  shard->cache_index.push_back(::std::make_pair(os, shard->cache.size()));
+  appendRecord(input, label, &shard->cache);
+  size_type growth = cacheCapacity(shard) - capacity;
+  if (growth > 0 && cache_usage_.fetch_add(growth) + growth > cache_size_) {
+    dropCache(shard, kCacheOver);
+  }
+}
+
+template < typename T >
+void Data< T >::dropCache(Shard *shard, CacheState state) {
+  cache_usage_.fetch_sub(cacheCapacity(shard));
+  byte_array().swap(shard->cache);
+  ::std::vector< cache_entry >().swap(shard->cache_index);
+  shard->cache_record = 0;
+  shard->cache_state = state;
+}
+
+template < typename T >
+typename Data< T >::size_type Data< T >::cacheCapacity(const Shard *shard) {
+  return shard->cache.capacity() +
+      shard->cache_index.capacity() * sizeof(cache_entry);
+}
+
+template < typename T >
+void Data< T >::shuffleShard(Shard *shard, size_type i) {
+  shard->order_record = 0;
+  shard->pool_size = 0;
+  shard->pool_end = false;
+  if (shuffle_size_ == 0) {
+    shard->shuffle_state = kShuffleOff;
+    ::std::vector< size_type >().swap(shard->order);
+    ::std::vector< sample_pair >().swap(shard->pool);
+    return;
+  }
+  // Each pass of each shard has its own order
+  ::std::seed_seq sequence({
+      static_cast< uint32_t >(shuffle_seed_),
+      static_cast< uint32_t >(shuffle_seed_ >> 32),
+      static_cast< uint32_t >(pass_), static_cast< uint32_t >(i)});
+  shard->generator.seed(sequence);
+  if (map_ != nullptr || shard->cache_state == kCacheFull) {
+    shard->shuffle_state = kShuffleOrder;
+    shard->order.resize(map_ != nullptr ?
+                        shard->record_end - shard->record_begin :
+                        shard->cache_index.size() - 1);
+    ::std::iota(shard->order.begin(), shard->order.end(), 0);
+    ::std::shuffle(shard->order.begin(), shard->order.end(), shard->generator);
+  } else {
+    shard->shuffle_state = kShufflePool;
+    shard->order.clear();
+  }
+}
+
+template < typename T >
+bool Data< T >::readOrder(
+    Shard *shard, field_array *input, index_pair *label) {
+  if (shard->order_record >= shard->order.size()) {
+    return false;
+  }
+  size_type record = shard->order[shard->order_record];
+  shard->order_record = shard->order_record + 1;
+  if (map_ != nullptr) {
+    shard->buffer_offset = recordOffset(shard->record_begin + record);
+    return readBinary(shard, input, label);
+  }
+  shard->cache_record = record;
+  return readCache(shard, input, label);
+}
+
+template < typename T >
+bool Data< T >::readPool(
+    Shard *shard, field_array *input, index_pair *label) {
+  // Keep the pool full and draw a sample from it
+  while (shard->pool_end == false && shard->pool_size < shuffle_size_) {
+    if (shard->pool.size() == shard->pool_size) {
+      shard->pool.emplace_back();
+    }
+    sample_pair &sample = shard->pool[shard->pool_size];
+    if (readNext(shard, &sample.first,
+                 label == nullptr ? nullptr : &sample.second) == false) {
+      shard->pool_end = true;
+    } else {
+      shard->pool_size = shard->pool_size + 1;
+    }
+  }
+  if (shard->pool_size == 0) {
+    return false;
+  }
+  ::std::uniform_int_distribution< size_type > distribution(
+      0, shard->pool_size - 1);
+  sample_pair &sample = shard->pool[distribution(shard->generator)];
+  // Swap so that the buffers of input are reused for the next sample
+  ::std::swap(*input, sample.first);
+  if (label != nullptr) {
+    *label = sample.second;
+  }
+  shard->pool_size = shard->pool_size - 1;
+  ::std::swap(sample, shard->pool[shard->pool_size]);
+  return true;
+}
+
+template < typename T >
+long Data< T >::recordOffset(size_type record) const {
+  uint64_t offset;
+  ::std::memcpy(&offset, map_ + map_index_ + record * sizeof(uint64_t),
+                sizeof(uint64_t));
+  return static_cast< long >(offset);
+}
+
+template < typename T >
+bool Data< T >::convert(const ::std::string &fn, bool label) {
+  if (rewind() == false) {
+    return false;
+  }
+  FILE *fp = ::std::fopen(fn.c_str(), "wb");
+  if (fp == nullptr) {
+    return false;
+  }
+  // The record count and index offset are filled in at the end
+  uint64_t header[5] = {0, format_.size(), 0, 0, label ? kLabelFlag : 0};
+  ::std::memcpy(header, kMagic, sizeof(kMagic));
+  byte_array fields;
+  for (const FieldFormat &field : format_) {
+    fields.push_back(static_cast< uint8_t >(field));
+  }
+  bool success = ::std::fwrite(header, sizeof(header), 1, fp) == 1 &&
+      ::std::fwrite(fields.data(), 1, fields.size(), fp) == fields.size();
+
+  ::std::vector< uint64_t > offsets;
+  uint64_t offset = sizeof(header) + fields.size();
+  byte_array record;
+  field_array input;
+  index_pair pair;
+  while (success == true &&
+         getSample(&input, label ? &pair : nullptr) == true) {
+    record.clear();
+    appendRecord(input, label ? &pair : nullptr, &record);
+    success = ::std::fwrite(record.data(), 1, record.size(), fp) ==
+        record.size();
+    offsets.push_back(offset);
+    offset = offset + record.size();
+  }
+
+  // Write the index and go back to complete the header
+  header[2] = offsets.size();
+  header[3] = offset;
+  success = success && ::std::fwrite(
+      offsets.data(), sizeof(uint64_t), offsets.size(), fp) ==
+      offsets.size() && ::std::fseek(fp, 0, SEEK_SET) == 0 &&
+      ::std::fwrite(header, sizeof(header), 1, fp) == 1;
+  success = ::std::fclose(fp) == 0 && success;
+  return rewind() && success;
+}
+
+template < typename T >
+bool Data< T >::seekShard(Shard *shard, long os) {
+  // Binary shards read from the mapping and only keep the offset
+  if (shard->fp == nullptr) {
+    shard->position = 0;
+    shard->limit = 0;
+    shard->buffer_offset = os;
+    return true;
+  }
+  if (::std::fseek(shard->fp, os, SEEK_SET) != 0) {
+    return false;
   }
-  ++count_;
+  shard->position = 0;
+  shard->limit = 0;
+  shard->buffer_offset = os;
   return true;
 }
 
+template < typename T >
+long Data< T >::tellShard(const Shard *shard) {
+  return shard->buffer_offset + static_cast< long >(shard->position);
+}
+
+template < typename T >
+bool Data< T >::fillShard(Shard *shard, size_type n) {
+  if (shard->limit - shard->position >= n) {
+    return true;
+  }
+  // Move the unparsed bytes to the front and read a new block after them
+  const size_type block = 1 << 20;
+  ::std::vector< char > &buffer = shard->buffer;
+  size_type remain = shard->limit - shard->position;
+  if (buffer.size() < block + n) {
+    buffer.resize(block + n);
+  }
+  ::std::memmove(buffer.data(), buffer.data() + shard->position, remain);
+  shard->buffer_offset =
+      shard->buffer_offset + static_cast< long >(shard->position);
+  shard->position = 0;
+  shard->limit = remain + ::std::fread(
+      buffer.data() + remain, 1, buffer.size() - remain, shard->fp);
+  return shard->limit >= n;
+}
+
+template < typename T >
+void Data< T >::skipSpace(Shard *shard) {
+  do {
+    const char *buffer = shard->buffer.data();
+    while (shard->position < shard->limit &&
+           ::std::isspace(static_cast< unsigned char >(
+               buffer[shard->position]))) {
+      shard->position = shard->position + 1;
+    }
+  } while (shard->position == shard->limit && fillShard(shard, 1));
+}
+
+template < typename T >
+bool Data< T >::readIndex(Shard *shard, size_type *index) {
+  skipSpace(shard);
+  // An index has at most 20 digits
+  fillShard(shard, 24);
+  const char *buffer = shard->buffer.data();
+  size_type position = shard->position;
+  if (position < shard->limit && buffer[position] == '+') {
+    position = position + 1;
+  }
+  const size_type max = ::std::numeric_limits< size_type >::max();
+  size_type value = 0;
+  size_type digits = 0;
+  while (position < shard->limit &&
+         static_cast< unsigned char >(buffer[position] - '0') < 10) {
+    size_type digit = static_cast< size_type >(buffer[position] - '0');
+    // Reject an index that does not fit instead of wrapping around
+    if (value > (max - digit) / 10) {
+      return false;
+    }
+    value = value * 10 + digit;
+    position = position + 1;
+    digits = digits + 1;
+  }
+  if (digits == 0) {
+    return false;
+  }
+  *index = value;
+  shard->position = position;
+  return true;
+}
+
+template < typename T >
+bool Data< T >::readWeight(Shard *shard, double *weight) {
+  static const double power[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  skipSpace(shard);
+  fillShard(shard, 64);
+  const char *buffer = shard->buffer.data();
+  size_type begin = shard->position;
+  size_type position = begin;
+  bool negative = false;
+  if (position < shard->limit &&
+      (buffer[position] == '-' || buffer[position] == '+')) {
+    negative = buffer[position] == '-';
+    position = position + 1;
+  }
+  // Fast path for plain decimals whose mantissa and power of ten are exact
+  uint64_t mantissa = 0;
+  size_type digits = 0;
+  size_type fraction = 0;
+  while (position < shard->limit &&
+         static_cast< unsigned char >(buffer[position] - '0') < 10) {
+    mantissa = mantissa * 10 + static_cast< uint64_t >(buffer[position] - '0');
+    position = position + 1;
+    digits = digits + 1;
+  }
+  if (position < shard->limit && buffer[position] == '.') {
+    position = position + 1;
+    while (position < shard->limit &&
+           static_cast< unsigned char >(buffer[position] - '0') < 10) {
+      mantissa = mantissa * 10 +
+          static_cast< uint64_t >(buffer[position] - '0');
+      position = position + 1;
+      digits = digits + 1;
+      fraction = fraction + 1;
+    }
+  }
+  bool plain = position == shard->limit || (
+      buffer[position] != 'e' && buffer[position] != 'E' &&
+      ::std::isalpha(static_cast< unsigned char >(buffer[position])) == 0);
+  if (digits > 0 && digits <= 15 && plain == true) {
+    *weight = static_cast< double >(mantissa) / power[fraction];
+    *weight = negative ? -*weight : *weight;
+    shard->position = position;
+    return true;
+  }
+  // Fall back to strtod for exponents, long mantissas, inf and nan
+  char token[65];
+  size_type length = ::std::min< size_type >(shard->limit - begin, 64);
+  ::std::memcpy(token, buffer + begin, length);
+  token[length] = '\0';
+  char *end;
+  *weight = ::std::strtod(token, &end);
+  if (end == token) {
+    return false;
+  }
+  shard->position = begin + static_cast< size_type >(end - token);
+  return true;
+}
+
+template < typename T >
+bool Data< T >::readHex(Shard *shard, byte_array *bytes) {
+  // Value of each character as a hex digit, or -1
+  static const ::std::array< int8_t, 256 > table = [] {
+    ::std::array< int8_t, 256 > t;
+    t.fill(-1);
+    for (int c = 0; c < 10; ++c) {
+      t['0' + c] = static_cast< int8_t >(c);
+    }
+    for (int c = 0; c < 6; ++c) {
+      t['a' + c] = static_cast< int8_t >(c + 10);
+      t['A' + c] = static_cast< int8_t >(c + 10);
+    }
+    return t;
+  }();
+  size_type size = bytes->size();
+  // Decode whole pairs, refilling the buffer when less than a pair remains
+  while (fillShard(shard, 2) == true) {
+    const unsigned char *buffer = reinterpret_cast< const unsigned char * >(
+        shard->buffer.data());
+    size_type position = shard->position;
+    size_type limit = shard->limit;
+    while (position + 1 < limit &&
+           (table[buffer[position]] | table[buffer[position + 1]]) >= 0) {
+      bytes->push_back(static_cast< uint8_t >(
+          (table[buffer[position]] << 4) | table[buffer[position + 1]]));
+      position = position + 2;
+    }
+    shard->position = position;
+    if (position + 1 < limit) {
+      // Stopped at a pair that is not all hex
+      break;
+    }
+  }
+  // A single trailing hex digit is consumed and ignored, as the scanf
+  // pattern this parser replaces did
+  if (shard->position < shard->limit && table[static_cast< unsigned char >(
+          shard->buffer[shard->position])] >= 0) {
+    shard->position = shard->position + 1;
+  }
+  return bytes->size() > size;
+}
+
+template < typename T >
+bool Data< T >::readChar(Shard *shard, char c) {
+  skipSpace(shard);
+  if (fillShard(shard, 1) == true && shard->buffer[shard->position] == c) {
+    shard->position = shard->position + 1;
+    return true;
+  }
+  return false;
+}
+
 template < typename T >
 void Data< T >::lock() {
   file_mutex_.lock();
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    shard->mutex.lock();
+  }
 }
 
 template < typename T >
 void Data< T >::unlock() {
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    shard->mutex.unlock();
+  }
   file_mutex_.unlock();
 }
 
@@ -178,14 +991,112 @@ void Data< T >::set_format(const format_array &ft) {
   format_ = ft;
 }
 
+template < typename T >
+typename Data< T >::size_type Data< T >::shard_size() const {
+  return shards_.size();
+}
+
+template < typename T >
+bool Data< T >::binary() const {
+  return map_ != nullptr;
+}
+
+template < typename T >
+typename Data< T >::size_type Data< T >::cache_size() const {
+  return cache_size_;
+}
+
+template < typename T >
+void Data< T >::set_cache_size(size_type s) {
+  lock();
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    // A shard read from the cache continues at the same place in the file
+    if (shard->cache_state == kCacheFull) {
+      seekShard(shard.get(),
+                shard->cache_index[shard->cache_record].first);
+    }
+    dropCache(shard.get(), kCacheOff);
+  }
+  cache_size_ = s;
+  unlock();
+}
+
+template < typename T >
+typename Data< T >::size_type Data< T >::cache_usage() const {
+  return cache_usage_.load();
+}
+
+template < typename T >
+bool Data< T >::cached() const {
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    if (shard->cache_state != kCacheFull) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template < typename T >
+typename Data< T >::size_type Data< T >::shuffle_size() const {
+  return shuffle_size_;
+}
+
+template < typename T >
+void Data< T >::set_shuffle_size(size_type s) {
+  shuffle_size_ = s;
+}
+
+template < typename T >
+uint64_t Data< T >::shuffle_seed() const {
+  return shuffle_seed_;
+}
+
+template < typename T >
+void Data< T >::set_shuffle_seed(uint64_t sd) {
+  shuffle_seed_ = sd;
+}
+
+template < typename T >
+typename Data< T >::size_type Data< T >::pass() const {
+  return pass_;
+}
+
+template < typename T >
+void Data< T >::set_pass(size_type p) {
+  pass_ = p;
+}
+
+template < typename T >
+bool Data< T >::ordered(size_type shard) const {
+  return shards_[shard]->shuffle_state == kShuffleOrder;
+}
+
 template < typename T >
 typename Data< T >::size_type Data< T >::count() const {
-  return count_;
+  size_type total = 0;
+  for (const ::std::unique_ptr< Shard > &shard : shards_) {
+    total = total + shard->count;
+  }
+  return total;
+}
+
+template < typename T >
+typename Data< T >::size_type Data< T >::count(size_type shard) const {
+  return shards_[shard]->count;
 }
 
 template < typename T >
 long Data< T >::offset() const {
-  return ::std::ftell(fp_);
+  return offset(current_);
+}
+
+template < typename T >
+long Data< T >::offset(size_type shard) const {
+  const Shard *current = shards_[shard].get();
+  if (current->cache_state == kCacheFull) {
+    return current->cache_index[current->cache_record].first;
+  }
+  return tellShard(current);
 }
 
 }  // namespace bytesteady
@@ -14,8 +14,11 @@
 #ifndef BYTESTEADY_DATA_HPP_
 #define BYTESTEADY_DATA_HPP_
 
+#include <atomic>
 #include <cstdio>
+#include <memory>
 #include <mutex>
+#include <random>
 #include <string>
 #include <utility>
 #include <variant>
@@ -40,19 +43,45 @@ class Data {
   typedef ::std::vector< field_variant > field_array;
   typedef ::std::vector< FieldFormat > format_array;
 
-  // File name and format
-  Data(const ::std::string &fn, const format_array &ft = {kIndex});
+  // File name, format and number of shards. Shards are byte ranges of the
+  // file aligned to line boundaries, each with its own file cursor, so that
+  // threads reading different shards do not contend with each other. A file
+  // produced by convert() is detected by its magic and memory-mapped instead,
+  // with shards split at record boundaries.
+  Data(const ::std::string &fn, const format_array &ft = {kIndex},
+       size_type s = 1);
   // Close the file
   ~Data();
 
-  // Rewind the file position and reset counter
+  // Rewind the file position and reset counter, starting a new pass
   bool rewind();
-  // Set the position of file and counter
+  // Set the position of file and counter. Without a shard, the position is
+  // for the sequential reader starting at the first shard. When shuffling,
+  // the shard restarts its pass and skips ct samples, ignoring the offset.
   bool seek(long os, size_type ct);
+  bool seek(size_type shard, long os, size_type ct);
+  // Seek a shard whose pass was read in a permutation if ordered is set, as
+  // given by ordered(shard) then. A text shard read so from memory is read
+  // through into the cache again to index the same records, so that the
+  // replay does not depend on what the cache holds now. Returns false if the
+  // shard cannot be cached for that.
+  bool seek(size_type shard, long os, size_type ct, bool ordered);
 
-  // Get a sample. Returns false if there is a read error
+  // Get a sample. Returns false if there is a read error. Shards are read
+  // one after another, so samples come in file order. The fields of input are
+  // overwritten in place, so reusing input makes no allocation once it has
+  // held samples as large.
   bool getSample(field_array *input, index_pair *label = nullptr,
                  size_type *count = nullptr);
+  // Get a sample from shard, moving shard forward by step each time it is
+  // exhausted. Returns false if there are no more shards to read. The count
+  // is the index of the sample in its shard.
+  bool getSample(size_type *shard, size_type step, field_array *input,
+                 index_pair *label = nullptr, size_type *count = nullptr);
+
+  // Convert all samples to the binary format and write them to fn. The
+  // label is stored only if the text data has one. Rewinds the data.
+  bool convert(const ::std::string &fn, bool label = true);
 
   void lock();
   void unlock();
@@ -63,20 +92,168 @@ class Data {
   const format_array &format() const;
   void set_format(const format_array &ft);
 
+  size_type shard_size() const;
+  // Whether the file is in the memory-mapped binary format
+  bool binary() const;
+
+  // Maximum bytes of parsed samples kept in memory, with 0 to disable. A text
+  // shard read through from its beginning after a rewind is kept in the binary
+  // record format, and later passes read it from memory instead of parsing the
+  // file again. Shards that do not fit in the rest of the budget are read from
+  // the file. Setting the size drops all cached samples.
+  size_type cache_size() const;
+  void set_cache_size(size_type s);
+  // Bytes of memory used by cached samples
+  size_type cache_usage() const;
+  // Whether all shards are read from memory
+  bool cached() const;
+
+  // Number of samples to shuffle text shards with, with 0 to disable. Each
+  // pass draws samples at random from a buffer of that many samples read
+  // ahead from the shard. Binary files and cached shards have their records
+  // indexed, and are read in a random permutation of the whole shard instead.
+  // Shuffling takes effect from the next rewind or seek.
+  size_type shuffle_size() const;
+  void set_shuffle_size(size_type s);
+  // The order of each shard is determined by the seed and the pass
+  uint64_t shuffle_seed() const;
+  void set_shuffle_seed(uint64_t sd);
+  // Number of rewinds so far
+  size_type pass() const;
+  void set_pass(size_type p);
+  // Whether the shard is read in a permutation of its records in this pass,
+  // rather than through the shuffle buffer
+  bool ordered(size_type shard) const;
+
+  // Total count of samples read from all shards
   size_type count() const;
+  size_type count(size_type shard) const;
+  // Offset of the sequential reader, or of the given shard
   long offset() const;
+  long offset(size_type shard) const;
 
  private:
+  typedef ::std::pair< long, size_type > cache_entry;
+  typedef ::std::pair< field_array, index_pair > sample_pair;
+  enum CacheState {
+    kCacheOff = 0,
+    kCacheFill = 1,
+    kCacheFull = 2,
+    kCacheOver = 3,
+  };
+  enum ShuffleState {
+    kShuffleOff = 0,
+    kShuffleOrder = 1,
+    kShufflePool = 2,
+  };
+
+  struct Shard {
+    FILE *fp = nullptr;
+    long begin = 0;
+    // End of the shard, or -1 for the end of file
+    long end = -1;
+    size_type count = 0;
+    ::std::mutex mutex;
+    // Read buffer. Bytes in [position, limit) are not parsed yet, and
+    // buffer[0] is at file offset buffer_offset.
+    ::std::vector< char > buffer;
+    size_type position = 0;
+    size_type limit = 0;
+    long buffer_offset = 0;
+    // Cached samples as binary records, with the file offset and the cache
+    // position of each record followed by those of the shard end
+    CacheState cache_state = kCacheOff;
+    byte_array cache;
+    ::std::vector< cache_entry > cache_index;
+    size_type cache_record = 0;
+    // Records of a binary file in the shard
+    size_type record_begin = 0;
+    size_type record_end = 0;
+    // Shuffled order of indexed records and the next one to read, or the
+    // samples read ahead from a text shard of which the first pool_size are
+    // to be drawn
+    ShuffleState shuffle_state = kShuffleOff;
+    ::std::mt19937_64 generator;
+    ::std::vector< size_type > order;
+    size_type order_record = 0;
+    ::std::vector< sample_pair > pool;
+    size_type pool_size = 0;
+    bool pool_end = false;
+  };
+
   ::std::string file_;
   format_array format_;
 
+  // Mutex for the sequential reader and opening of the file
   ::std::mutex file_mutex_;
-  size_type count_;
-  FILE *fp_;
+  size_type current_;
+  ::std::vector< ::std::unique_ptr< Shard > > shards_;
+
+  // Binary format layout, all integers are 64-bit in host byte order:
+  //   header: magic, field count, record count, index offset, flags, then
+  //           one byte of FieldFormat for each field
+  //   record: byte length of the rest of the record, then for each field an
+  //           element count followed by the raw bytes or (index, double
+  //           weight) pairs, and an (index, double weight) label if flagged
+  //   index:  offset of each record at the index offset
+  // Memory mapping of a binary file, with nullptr for text files. Shards do
+  // not own a file pointer in this case and use buffer_offset as cursor.
+  static constexpr char kMagic[8] = {'B', 'S', 'T', 'D', 'A', 'T', 'A', '1'};
+  static constexpr uint64_t kLabelFlag = 1;
+  const uint8_t *map_;
+  size_type map_size_;
+  uint64_t map_flags_;
+  size_type map_index_;
+
+  // Cache budget and usage in bytes
+  size_type cache_size_;
+  ::std::atomic< size_type > cache_usage_;
+
+  size_type shuffle_size_;
+  uint64_t shuffle_seed_;
+  size_type pass_;
+
+  // Open the shards and find their boundaries
+  bool open();
+  bool openBinary();
+  bool readSample(Shard *shard, field_array *input, index_pair *label);
+  // Read the next sample in the order of the file
+  bool readNext(Shard *shard, field_array *input, index_pair *label);
+  bool readFile(Shard *shard, field_array *input, index_pair *label);
+  bool readText(Shard *shard, field_array *input, index_pair *label);
+  bool readBinary(Shard *shard, field_array *input, index_pair *label);
+  bool readCache(Shard *shard, field_array *input, index_pair *label);
+  // Read the fields and label of a binary record in [position, limit)
+  bool readRecord(const uint8_t *position, const uint8_t *limit,
+                  bool labeled, field_array *input, index_pair *label);
+  // Append a binary record of input and label to record
+  static void appendRecord(const field_array &input, const index_pair *label,
+                           byte_array *record);
+
+  // Add a sample read at file offset os to the cache of shard, or stop
+  // caching the shard if it does not fit
+  void cacheSample(Shard *shard, long os, const field_array &input,
+                   const index_pair *label);
+  void dropCache(Shard *shard, CacheState state);
+  static size_type cacheCapacity(const Shard *shard);
+
+  // Start the pass of shard i in the shuffling mode, and read shuffled
+  // samples from it
+  void shuffleShard(Shard *shard, size_type i);
+  bool readOrder(Shard *shard, field_array *input, index_pair *label);
+  bool readPool(Shard *shard, field_array *input, index_pair *label);
+  // Offset of a record in the binary file
+  long recordOffset(size_type record) const;
 
-  // Scratch space for reading data
-  byte_array bytes_;
-  index_array indices_;
+  // Buffered parsing primitives
+  static bool seekShard(Shard *shard, long os);
+  static long tellShard(const Shard *shard);
+  static bool fillShard(Shard *shard, size_type n);
+  static void skipSpace(Shard *shard);
+  static bool readIndex(Shard *shard, size_type *index);
+  static bool readWeight(Shard *shard, double *weight);
+  static bool readHex(Shard *shard, byte_array *bytes);
+  static bool readChar(Shard *shard, char c);
 };
 
 typedef Data< ::thunder::DoubleTensor > DoubleData;
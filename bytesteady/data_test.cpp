@@ -13,8 +13,15 @@
 
 #include "bytesteady/data.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <mutex>
+#include <new>
+#include <random>
 #include <string>
 #include <sstream>
 #include <thread>
@@ -22,8 +29,29 @@
 #include <variant>
 
 #include "bytesteady/integer.hpp"
+#include "bytesteady/universum.hpp"
 #include "gtest/gtest.h"
 
+// Count heap allocations to check that reading samples makes none
+::std::atomic< ::std::size_t > allocation_count(0);
+
+void *operator new(::std::size_t size) {
+  allocation_count.fetch_add(1, ::std::memory_order_relaxed);
+  void *pointer = ::std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw ::std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void *pointer) noexcept {
+  ::std::free(pointer);
+}
+
+void operator delete(void *pointer, ::std::size_t) noexcept {
+  ::std::free(pointer);
+}
+
 namespace bytesteady {
 namespace {
 
@@ -98,5 +126,700 @@ TEST(DataTest, getSampleTest) {
   getSampleTest< DoubleData >();
 }
 
+template < typename D >
+void shardTest() {
+  typedef typename D::byte_array byte_array;
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+
+  ::std::string file = "bytesteady/unittest_train.txt";
+  format_array format = {kBytes, kIndex};
+
+  // Read all samples in file order without sharding
+  D data(file, format);
+  EXPECT_TRUE(data.rewind());
+  ::std::vector< byte_array > expected;
+  field_array input;
+  index_pair label;
+  while (data.getSample(&input, &label) == true) {
+    expected.push_back(::std::get< byte_array >(input[0]));
+  }
+  EXPECT_EQ(20, expected.size());
+
+  for (size_type shard_size : {2, 3, 7, 64}) {
+    D sharded_data(file, format, shard_size);
+    EXPECT_EQ(shard_size, sharded_data.shard_size());
+    // Sequential reading goes through the shards in file order
+    EXPECT_TRUE(sharded_data.rewind());
+    size_type count = 0;
+    size_type index = 0;
+    while (sharded_data.getSample(&input, &label, &index) == true) {
+      EXPECT_EQ(count, index);
+      EXPECT_EQ(expected[count], ::std::get< byte_array >(input[0]));
+      count = count + 1;
+    }
+    EXPECT_EQ(20, count);
+    EXPECT_EQ(20, sharded_data.count());
+    // Reading each shard gives every sample exactly once, in order
+    EXPECT_TRUE(sharded_data.rewind());
+    count = 0;
+    size_type shard = 0;
+    while (sharded_data.getSample(&shard, 1, &input, &label) == true) {
+      EXPECT_EQ(expected[count], ::std::get< byte_array >(input[0]));
+      count = count + 1;
+    }
+    EXPECT_EQ(shard_size, shard);
+    EXPECT_EQ(20, count);
+    size_type shard_count = 0;
+    for (size_type i = 0; i < shard_size; ++i) {
+      shard_count = shard_count + sharded_data.count(i);
+    }
+    EXPECT_EQ(20, shard_count);
+  }
+}
+
+TEST(DataTest, shardTest) {
+  shardTest< DoubleData >();
+}
+
+template < typename D >
+void resumeTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+
+  ::std::string file = "bytesteady/unittest_train.txt";
+  format_array format = {kBytes, kIndex};
+  field_array input;
+  index_pair label;
+
+  for (size_type shard_size : {2, 3, 7}) {
+    // Samples of each shard in order
+    D data(file, format, shard_size);
+    EXPECT_TRUE(data.rewind());
+    ::std::vector< ::std::vector< field_array > > expected(shard_size);
+    size_type shard = 0;
+    while (data.getSample(&shard, 1, &input, &label) == true) {
+      expected[shard].push_back(input);
+    }
+
+    // Read half of every shard and record the positions
+    EXPECT_TRUE(data.rewind());
+    ::std::vector< long > offset(shard_size);
+    ::std::vector< size_type > count(shard_size);
+    for (size_type i = 0; i < shard_size; ++i) {
+      for (size_type j = 0; j < expected[i].size() / 2; ++j) {
+        shard = i;
+        EXPECT_TRUE(data.getSample(&shard, 1, &input, &label));
+      }
+      offset[i] = data.offset(i);
+      count[i] = data.count(i);
+      EXPECT_EQ(expected[i].size() / 2, count[i]);
+    }
+
+    // Seeking every shard in turn leaves the others where they were
+    D resume_data(file, format, shard_size);
+    EXPECT_TRUE(resume_data.rewind());
+    for (size_type i = 0; i < shard_size; ++i) {
+      EXPECT_TRUE(resume_data.seek(i, offset[i], count[i]));
+    }
+    for (size_type i = 0; i < shard_size; ++i) {
+      EXPECT_EQ(count[i], resume_data.count(i));
+      if (count[i] == expected[i].size()) {
+        continue;
+      }
+      shard = i;
+      size_type index = 0;
+      EXPECT_TRUE(resume_data.getSample(&shard, 1, &input, &label, &index));
+      EXPECT_EQ(i, shard);
+      EXPECT_EQ(count[i], index);
+      EXPECT_TRUE(expected[i][count[i]] == input);
+    }
+  }
+}
+
+TEST(DataTest, resumeTest) {
+  resumeTest< DoubleData >();
+}
+
+template < typename D >
+void binaryTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+
+  ::std::string file = "bytesteady/unittest_train.txt";
+  ::std::string binary_file = "bytesteady/unittest_train.bin";
+  format_array format = {kBytes, kIndex};
+
+  // Read all samples from the text file and convert it
+  D data(file, format);
+  EXPECT_FALSE(data.binary());
+  ::std::vector< field_array > expected_input;
+  ::std::vector< index_pair > expected_label;
+  field_array input;
+  index_pair label;
+  while (data.getSample(&input, &label) == true) {
+    expected_input.push_back(input);
+    expected_label.push_back(label);
+  }
+  EXPECT_EQ(20, expected_input.size());
+  EXPECT_TRUE(data.convert(binary_file));
+
+  for (size_type shard_size : {1, 3, 64}) {
+    D binary_data(binary_file, format, shard_size);
+    EXPECT_TRUE(binary_data.binary());
+    // Sequential reading gives the samples in file order
+    EXPECT_TRUE(binary_data.rewind());
+    size_type count = 0;
+    size_type index = 0;
+    while (binary_data.getSample(&input, &label, &index) == true) {
+      EXPECT_EQ(count, index);
+      EXPECT_TRUE(expected_input[count] == input);
+      EXPECT_EQ(expected_label[count], label);
+      count = count + 1;
+    }
+    EXPECT_EQ(20, count);
+    // Reading each shard gives every sample exactly once, in order
+    EXPECT_TRUE(binary_data.rewind());
+    count = 0;
+    size_type shard = 0;
+    while (binary_data.getSample(&shard, 1, &input, &label) == true) {
+      EXPECT_TRUE(expected_input[count] == input);
+      count = count + 1;
+    }
+    EXPECT_EQ(20, count);
+    // Seeking back to a saved offset resumes from the same sample
+    if (shard_size > 1) {
+      continue;
+    }
+    EXPECT_TRUE(binary_data.rewind());
+    for (size_type i = 0; i < 5; ++i) {
+      EXPECT_TRUE(binary_data.getSample(&input, &label));
+    }
+    long offset = binary_data.offset();
+    EXPECT_TRUE(binary_data.rewind());
+    EXPECT_TRUE(binary_data.seek(offset, 5));
+    EXPECT_TRUE(binary_data.getSample(&input, &label, &index));
+    EXPECT_EQ(5, index);
+    EXPECT_TRUE(expected_input[5] == input);
+  }
+
+  // A format that does not match the file is rejected
+  D mismatch_data(binary_file, {kIndex});
+  EXPECT_FALSE(mismatch_data.rewind());
+  ::std::remove(binary_file.c_str());
+}
+
+TEST(DataTest, binaryTest) {
+  binaryTest< DoubleData >();
+}
+
+template < typename D >
+void cacheTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+
+  ::std::string file = "bytesteady/unittest_train.txt";
+  ::std::string cache_file = "bytesteady/unittest_cache.txt";
+  format_array format = {kBytes, kIndex};
+
+  // Read all samples and their offsets from the file
+  D data(file, format);
+  ::std::vector< field_array > expected_input;
+  ::std::vector< index_pair > expected_label;
+  ::std::vector< long > expected_offset;
+  field_array input;
+  index_pair label;
+  expected_offset.push_back(data.offset());
+  while (data.getSample(&input, &label) == true) {
+    expected_input.push_back(input);
+    expected_label.push_back(label);
+    expected_offset.push_back(data.offset());
+  }
+  EXPECT_EQ(20, expected_input.size());
+
+  for (size_type shard_size : {1, 3}) {
+    // Make a copy of the file to truncate after it is cached
+    FILE *source = ::std::fopen(file.c_str(), "r");
+    FILE *destination = ::std::fopen(cache_file.c_str(), "w");
+    ASSERT_NE(nullptr, source);
+    ASSERT_NE(nullptr, destination);
+    for (int c = ::std::fgetc(source); c != EOF; c = ::std::fgetc(source)) {
+      ::std::fputc(c, destination);
+    }
+    ::std::fclose(source);
+    ::std::fclose(destination);
+
+    // The first pass after a rewind fills the cache
+    D cache_data(cache_file, format, shard_size);
+    cache_data.set_cache_size(1 << 20);
+    EXPECT_EQ(1 << 20, cache_data.cache_size());
+    EXPECT_TRUE(cache_data.rewind());
+    size_type count = 0;
+    while (cache_data.getSample(&input, &label) == true) {
+      EXPECT_TRUE(expected_input[count] == input);
+      count = count + 1;
+    }
+    EXPECT_EQ(20, count);
+    EXPECT_TRUE(cache_data.cached());
+    EXPECT_LT(0, cache_data.cache_usage());
+    EXPECT_GE(1 << 20, cache_data.cache_usage());
+
+    // Later passes do not read the file any more
+    destination = ::std::fopen(cache_file.c_str(), "w");
+    ::std::fclose(destination);
+    for (int pass = 0; pass < 2; ++pass) {
+      EXPECT_TRUE(cache_data.rewind());
+      count = 0;
+      size_type shard = 0;
+      while (cache_data.getSample(&shard, 1, &input, &label) == true) {
+        EXPECT_TRUE(expected_input[count] == input);
+        EXPECT_EQ(expected_label[count], label);
+        count = count + 1;
+      }
+      EXPECT_EQ(20, count);
+    }
+
+    // Offsets are those in the file, so that checkpoints stay valid
+    if (shard_size == 1) {
+      EXPECT_TRUE(cache_data.rewind());
+      for (size_type i = 0; i < 5; ++i) {
+        EXPECT_TRUE(cache_data.getSample(&input, &label));
+      }
+      EXPECT_EQ(expected_offset[5], cache_data.offset());
+      EXPECT_TRUE(cache_data.rewind());
+      EXPECT_TRUE(cache_data.seek(expected_offset[5], 5));
+      size_type index = 0;
+      EXPECT_TRUE(cache_data.getSample(&input, &label, &index));
+      EXPECT_EQ(5, index);
+      EXPECT_TRUE(expected_input[5] == input);
+    }
+    ::std::remove(cache_file.c_str());
+  }
+
+  // Data over the budget is read from the file every pass
+  D budget_data(file, format);
+  budget_data.set_cache_size(256);
+  for (int pass = 0; pass < 2; ++pass) {
+    EXPECT_TRUE(budget_data.rewind());
+    size_type count = 0;
+    while (budget_data.getSample(&input, &label) == true) {
+      EXPECT_TRUE(expected_input[count] == input);
+      count = count + 1;
+    }
+    EXPECT_EQ(20, count);
+    EXPECT_FALSE(budget_data.cached());
+    EXPECT_EQ(0, budget_data.cache_usage());
+  }
+}
+
+TEST(DataTest, cacheTest) {
+  cacheTest< DoubleData >();
+  cacheTest< FloatData >();
+}
+
+// Read a pass of samples from all shards
+template < typename D >
+::std::vector< typename D::field_array > readPass(D *data) {
+  typename D::field_array input;
+  typename D::index_pair label;
+  typename D::size_type shard = 0;
+  ::std::vector< typename D::field_array > samples;
+  while (data->getSample(&shard, 1, &input, &label) == true) {
+    samples.push_back(input);
+  }
+  return samples;
+}
+
+template < typename D >
+void shuffleTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::size_type size_type;
+
+  ::std::string file = "bytesteady/unittest_train.txt";
+  ::std::string binary_file = "bytesteady/unittest_shuffle.bin";
+  format_array format = {kBytes, kIndex};
+  D data(file, format);
+  ::std::vector< field_array > expected = readPass(&data);
+  EXPECT_EQ(20, expected.size());
+  EXPECT_TRUE(data.convert(binary_file));
+  ::std::sort(expected.begin(), expected.end());
+
+  // Text data is shuffled through a buffer, binary data by permutation, and
+  // cached data through a buffer in the first pass and by permutation after
+  for (int mode = 0; mode < 3; ++mode) {
+    for (size_type shard_size : {1, 3}) {
+      D shuffle_data(mode == 1 ? binary_file : file, format, shard_size);
+      D replay_data(mode == 1 ? binary_file : file, format, shard_size);
+      for (D *current : {&shuffle_data, &replay_data}) {
+        current->set_shuffle_size(8);
+        current->set_shuffle_seed(1946);
+        current->set_cache_size(mode == 2 ? 1 << 20 : 0);
+        EXPECT_EQ(8, current->shuffle_size());
+        EXPECT_EQ(1946, current->shuffle_seed());
+      }
+      ::std::vector< ::std::vector< field_array > > passes;
+      for (int pass = 0; pass < 3; ++pass) {
+        EXPECT_TRUE(shuffle_data.rewind());
+        passes.push_back(readPass(&shuffle_data));
+        // Every sample comes once per pass
+        ::std::vector< field_array > sorted = passes.back();
+        ::std::sort(sorted.begin(), sorted.end());
+        EXPECT_TRUE(expected == sorted);
+        // The same seed and pass give the same order
+        EXPECT_TRUE(replay_data.rewind());
+        EXPECT_TRUE(passes.back() == readPass(&replay_data));
+      }
+      EXPECT_FALSE(passes[1] == passes[2]);
+      EXPECT_EQ(mode == 2, shuffle_data.cached());
+
+      // Seeking replays the pass up to the count
+      EXPECT_EQ(3, shuffle_data.pass());
+      shuffle_data.set_pass(2);
+      for (size_type i = 0; i < shard_size; ++i) {
+        EXPECT_TRUE(shuffle_data.seek(i, 0, i == 0 ? 3 : 0));
+      }
+      EXPECT_EQ(3, shuffle_data.count(0));
+      ::std::vector< field_array > rest = readPass(&shuffle_data);
+      EXPECT_TRUE(::std::equal(passes[1].begin() + 3, passes[1].end(),
+                               rest.begin(), rest.end()));
+    }
+  }
+  ::std::remove(binary_file.c_str());
+}
+
+TEST(DataTest, shuffleTest) {
+  shuffleTest< DoubleData >();
+  shuffleTest< FloatData >();
+}
+
+template < typename D >
+void shuffleResumeTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+
+  ::std::string file = "bytesteady/unittest_train.txt";
+  format_array format = {kBytes, kIndex};
+  field_array input;
+  index_pair label;
+
+  // The first pass fills the cache through the shuffle buffer, and later
+  // passes read the cache in a permutation
+  for (size_type resume_pass : {1, 3}) {
+    for (size_type shard_size : {1, 3}) {
+      D data(file, format, shard_size);
+      data.set_cache_size(1 << 20);
+      data.set_shuffle_size(8);
+      data.set_shuffle_seed(1946);
+      for (size_type pass = 1; pass < resume_pass; ++pass) {
+        EXPECT_TRUE(data.rewind());
+        readPass(&data);
+      }
+      // Stop in the middle of the pass of every shard
+      EXPECT_TRUE(data.rewind());
+      ::std::vector< long > offset(shard_size);
+      ::std::vector< size_type > count(shard_size);
+      ::std::vector< bool > ordered(shard_size);
+      for (size_type i = 0; i < shard_size; ++i) {
+        for (size_type j = 0; j < 2; ++j) {
+          size_type shard = i;
+          EXPECT_TRUE(data.getSample(&shard, 1, &input, &label));
+        }
+        offset[i] = data.offset(i);
+        count[i] = data.count(i);
+        ordered[i] = data.ordered(i);
+        EXPECT_EQ(resume_pass > 1, data.ordered(i));
+      }
+      ::std::vector< field_array > expected = readPass(&data);
+
+      // A new reader has nothing cached but continues in the same order
+      D resume_data(file, format, shard_size);
+      resume_data.set_cache_size(1 << 20);
+      resume_data.set_shuffle_size(8);
+      resume_data.set_shuffle_seed(1946);
+      EXPECT_TRUE(resume_data.rewind());
+      resume_data.set_pass(resume_pass);
+      for (size_type i = 0; i < shard_size; ++i) {
+        EXPECT_TRUE(resume_data.seek(i, offset[i], count[i], ordered[i]));
+        EXPECT_EQ(count[i], resume_data.count(i));
+      }
+      EXPECT_TRUE(expected == readPass(&resume_data));
+    }
+  }
+}
+
+TEST(DataTest, shuffleResumeTest) {
+  shuffleResumeTest< DoubleData >();
+}
+
+template < typename D, typename U >
+void allocationTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+  typedef typename U::size_storage size_storage;
+
+  ::std::string file = "bytesteady/unittest_train.txt";
+  ::std::string binary_file = "bytesteady/unittest_allocation.bin";
+  format_array format = {kBytes, kIndex};
+  D data(file, format);
+  EXPECT_TRUE(data.convert(binary_file));
+  D binary_data(binary_file, format);
+  D cache_data(file, format);
+  cache_data.set_cache_size(1 << 20);
+  U universum;
+  size_storage input_size = {256, 1000};
+
+  for (D *current : {&data, &binary_data, &cache_data}) {
+    // The first pass grows the fields to the largest sample
+    field_array input;
+    index_pair label;
+    field_array universum_input;
+    index_pair universum_label;
+    EXPECT_TRUE(current->rewind());
+    while (current->getSample(&input, &label) == true) {
+      EXPECT_TRUE(universum.getSample(input_size, 10, input, label,
+                                      &universum_input, &universum_label));
+    }
+    // The second pass reuses them
+    EXPECT_TRUE(current->rewind());
+    size_type count = 0;
+    ::std::size_t allocations = allocation_count.load();
+    while (current->getSample(&input, &label) == true) {
+      universum.getSample(input_size, 10, input, label, &universum_input,
+                          &universum_label);
+      count = count + 1;
+    }
+    EXPECT_EQ(allocations, allocation_count.load());
+    EXPECT_EQ(20, count);
+  }
+  ::std::remove(binary_file.c_str());
+}
+
+TEST(DataTest, allocationTest) {
+  allocationTest< DoubleData, DoubleUniversum >();
+  allocationTest< FloatData, FloatUniversum >();
+}
+
+template < typename D >
+void overflowTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::index_array index_array;
+  typedef typename D::index_pair index_pair;
+
+  // The largest index is read, and one more is rejected
+  const char *file = "bytesteady/unittest_overflow.txt";
+  FILE *fp = ::std::fopen(file, "w");
+  ASSERT_NE(nullptr, fp);
+  ::std::fputs("18446744073709551615 1\n18446744073709551616 2\n", fp);
+  ::std::fclose(fp);
+  D data(file, {kIndex});
+  field_array input;
+  index_pair label;
+  ASSERT_TRUE(data.getSample(&input, &label));
+  const index_array &indices = ::std::get< index_array >(input[0]);
+  ASSERT_EQ(1, indices.size());
+  EXPECT_EQ(18446744073709551615ULL, indices[0].first);
+  EXPECT_EQ(1, label.first);
+  EXPECT_FALSE(data.getSample(&input, &label));
+  ::std::remove(file);
+}
+
+TEST(DataTest, overflowTest) {
+  overflowTest< DoubleData >();
+}
+
+// Reference parser with scanf, used by the benchmark for comparison
+template < typename D >
+bool scanfSample(FILE *fp, const typename D::format_array &format,
+                 typename D::field_array *input,
+                 typename D::index_pair *label) {
+  typedef typename D::byte_array byte_array;
+  typedef typename D::index_array index_array;
+  typedef typename D::size_type size_type;
+  typedef typename D::value_type value_type;
+  input->clear();
+  size_type index;
+  double weight;
+  char separator[2];
+  char hex[3];
+  for (size_type i = 0; i < format.size(); ++i) {
+    if (format[i] == kIndex) {
+      index_array indices;
+      do {
+        if (fscanf(fp, "%lu", &index) != 1) {
+          return false;
+        }
+        weight = 1.0;
+        if (fscanf(fp, " %1[:]", separator) == 1 && separator[0] == ':' &&
+            fscanf(fp, "%lg", &weight) != 1) {
+          return false;
+        }
+        indices.push_back(::std::make_pair(
+            index, static_cast< value_type >(weight)));
+      } while (fscanf(fp, " %1[,]", separator) == 1 && separator[0] == ',');
+      input->push_back(indices);
+    } else if (format[i] == kBytes) {
+      byte_array bytes;
+      if (fscanf(fp, " %2[0123456789ABCDEFabcdef]", hex) != 1 ||
+          hex[0] == '\0' || hex[1] == '\0') {
+        return false;
+      }
+      bytes.push_back(
+          static_cast< uint8_t >(::std::strtoul(hex, nullptr, 16)));
+      while (fscanf(fp, "%2[0123456789ABCDEFabcdef]", hex) == 1 &&
+             hex[0] != '\0' && hex[1] != '\0') {
+        bytes.push_back(
+            static_cast< uint8_t >(::std::strtoul(hex, nullptr, 16)));
+      }
+      input->push_back(bytes);
+    }
+  }
+  if (fscanf(fp, "%lu", &index) != 1) {
+    return false;
+  }
+  weight = 1.0;
+  if (fscanf(fp, " %1[:]", separator) == 1 && separator[0] == ':' &&
+      fscanf(fp, "%lg", &weight) != 1) {
+    return false;
+  }
+  label->first = index;
+  label->second = static_cast< value_type >(weight);
+  return true;
+}
+
+// Write synthetic data in the format of unittest_train.txt and return its
+// size in bytes
+template < typename D >
+long writeParseFile(const ::std::string &file, typename D::size_type lines) {
+  typedef typename D::size_type size_type;
+
+  ::std::mt19937 generator(1946);
+  FILE *fp = ::std::fopen(file.c_str(), "w");
+  if (fp == nullptr) {
+    return -1;
+  }
+  for (size_type i = 0; i < lines; ++i) {
+    size_type length = 1 + generator() % 2048;
+    for (size_type j = 0; j < length; ++j) {
+      ::std::fprintf(fp, j % 3 == 0 ? "%2.2X" : "%2.2x",
+                     static_cast< unsigned >(generator() % 256));
+    }
+    size_type indices = 1 + generator() % 4;
+    for (size_type j = 0; j < indices; ++j) {
+      ::std::fprintf(fp, j == 0 ? " %u" : ",%u",
+                     static_cast< unsigned >(generator() % 100));
+      if (generator() % 2 == 0) {
+        ::std::fprintf(fp, ":%g", static_cast< double >(generator() % 1000) /
+                       static_cast< double >(1 + generator() % 100));
+      }
+    }
+    ::std::fprintf(fp, " %u\n", static_cast< unsigned >(generator() % 10));
+  }
+  long size = ::std::ftell(fp);
+  ::std::fclose(fp);
+  return size;
+}
+
+template < typename D >
+void parseScanfTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+
+  ::std::string file = "bytesteady/unittest_parse.txt";
+  format_array format = {kBytes, kIndex};
+  ASSERT_LT(0, writeParseFile< D >(file, 4000));
+
+  // Parse with scanf
+  ::std::vector< field_array > expected_input;
+  ::std::vector< index_pair > expected_label;
+  field_array input;
+  index_pair label;
+  FILE *fp = ::std::fopen(file.c_str(), "r");
+  while (scanfSample< D >(fp, format, &input, &label) == true) {
+    expected_input.push_back(input);
+    expected_label.push_back(label);
+  }
+  ::std::fclose(fp);
+
+  // Parse with data
+  D data(file, format);
+  size_type count = 0;
+  while (data.getSample(&input, &label) == true) {
+    EXPECT_TRUE(expected_input[count] == input);
+    EXPECT_EQ(expected_label[count].first, label.first);
+    EXPECT_FLOAT_EQ(expected_label[count].second, label.second);
+    count = count + 1;
+  }
+  EXPECT_EQ(4000, count);
+  EXPECT_EQ(expected_input.size(), count);
+  ::std::remove(file.c_str());
+}
+
+TEST(DataTest, parseScanfTest) {
+  parseScanfTest< DoubleData >();
+}
+
+template < typename D >
+void parseBenchmarkTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+
+  ::std::string file = "bytesteady/unittest_parse.txt";
+  format_array format = {kBytes, kIndex};
+  long size = writeParseFile< D >(file, 4000);
+  ASSERT_LT(0, size);
+  field_array input;
+  index_pair label;
+
+  // Parse with scanf
+  FILE *fp = ::std::fopen(file.c_str(), "r");
+  size_type scanf_count = 0;
+  ::std::chrono::steady_clock::time_point start =
+      ::std::chrono::steady_clock::now();
+  while (scanfSample< D >(fp, format, &input, &label) == true) {
+    scanf_count = scanf_count + 1;
+  }
+  double scanf_time = ::std::chrono::duration< double >(
+      ::std::chrono::steady_clock::now() - start).count();
+  ::std::fclose(fp);
+
+  // Parse with data
+  D data(file, format);
+  size_type data_count = 0;
+  start = ::std::chrono::steady_clock::now();
+  while (data.getSample(&input, &label) == true) {
+    data_count = data_count + 1;
+  }
+  double data_time = ::std::chrono::duration< double >(
+      ::std::chrono::steady_clock::now() - start).count();
+  EXPECT_EQ(4000, scanf_count);
+  EXPECT_EQ(4000, data_count);
+
+  double megabytes = static_cast< double >(size) / 1048576.0;
+  printf("Parse size = %gMB, scanf = %gMB/s, data = %gMB/s\n", megabytes,
+         megabytes / scanf_time, megabytes / data_time);
+  ::std::remove(file.c_str());
+}
+
+TEST(DataTest, parseBenchmarkTest) {
+  parseBenchmarkTest< DoubleData >();
+}
+
 }  // namespace
 }  // namespace bytesteady
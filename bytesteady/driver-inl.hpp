@@ -13,7 +13,9 @@
 
 #include "bytesteady/driver.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <filesystem>
 #include <iomanip>
@@ -22,7 +24,9 @@
 #include <string>
 #include <system_error>
 #include <thread>
+#include <type_traits>
 #include <variant>
+#include <vector>
 
 #include "bytesteady/field_format.hpp"
 #include "bytesteady/flags.hpp"
@@ -34,10 +38,11 @@ namespace bytesteady {
 template < typename D, typename U, typename M, typename L, typename T,
            typename V, typename I >
 Driver< D, U, M, L, T, V, I >::Driver() :
-    data_(FLAGS_data_file, parseDataFormat()),
+    data_(FLAGS_data_file, parseDataFormat(), FLAGS_data_shard_size),
     universum_(),
     model_(parseModelInputSize(), FLAGS_model_output_size,
-           FLAGS_model_dimension, parseModelGram(), FLAGS_model_seed),
+           FLAGS_model_dimension, parseModelGram(), FLAGS_model_seed,
+           parseModelPlacement()),
     loss_(),
     train_(&data_, &universum_, &model_, &loss_,
           static_cast< value_type >(FLAGS_train_a),
@@ -48,24 +53,52 @@ Driver< D, U, M, L, T, V, I >::Driver() :
           FLAGS_train_thread_size),
     test_(&data_, &model_, &loss_, FLAGS_test_label_size,
           FLAGS_test_thread_size),
-    infer_(&data_, &model_, &loss_, FLAGS_infer_file, FLAGS_infer_label_size),
+    infer_(&data_, &model_, &loss_, FLAGS_infer_file, FLAGS_infer_label_size,
+           FLAGS_infer_thread_size),
     epoch_(0), log_interval_(FLAGS_driver_log_interval),
     log_time_point_(::std::chrono::steady_clock::now()),
     checkpoint_interval_(FLAGS_driver_checkpoint_interval),
     checkpoint_time_point_(::std::chrono::steady_clock::now()) {
-  if (data_.rewind() == false) {
+  // Only training reads the data file more than once
+  if (FLAGS_joe_task == "train" && FLAGS_data_cache == true) {
+    data_.set_cache_size(FLAGS_data_cache_size << 20);
+  }
+  if (FLAGS_joe_task == "train" && FLAGS_data_shuffle == true) {
+    data_.set_shuffle_size(FLAGS_data_shuffle_size);
+    data_.set_shuffle_seed(FLAGS_data_shuffle_seed);
+  }
+  // Serving reads requests instead of the data file
+  if (FLAGS_joe_task != "serve" && data_.rewind() == false) {
     LOG(FATAL) << "Data cannot open data file " << FLAGS_data_file;
   }
+  model_.set_coalesce(FLAGS_model_coalesce);
+  infer_.set_top_size(FLAGS_infer_top_size);
+  if (FLAGS_infer_score == "raw") {
+    infer_.set_score(kRawScore);
+  } else if (FLAGS_infer_score == "probability") {
+    infer_.set_score(kProbabilityScore);
+  }
+  infer_.set_binary(FLAGS_infer_binary);
+  train_.set_batch_size(FLAGS_train_batch_size);
+  train_.set_prefetch_size(FLAGS_train_prefetch_size);
+  train_.set_reader_size(FLAGS_train_reader_size);
+  train_.set_placement(parsePlacement());
   if (FLAGS_joe_task == "train") {
+    place(false);
     if (FLAGS_driver_resume == true) {
       LOG(INFO) << "Driver resume from checkpoint at "
                 << FLAGS_driver_location;
       resume();
     } else {
       LOG(INFO) << "Driver initialize model with mu = " << FLAGS_model_mu
-                << " and sigma = " << FLAGS_model_sigma;
+                << ", sigma = " << FLAGS_model_sigma << " and threads = "
+                << FLAGS_model_thread_size;
       model_.initialize(static_cast< value_type >(FLAGS_model_mu),
-                        static_cast< value_type >(FLAGS_model_sigma));
+                        static_cast< value_type >(FLAGS_model_sigma),
+                        FLAGS_model_thread_size);
+    }
+    if (model_.placed() == false) {
+      LOG(WARNING) << "Driver cannot place all input embeddings as requested";
     }
   }
 }
@@ -79,6 +112,10 @@ void Driver< D, U, M, L, T, V, I >::runTrain() {
     train_.join();
     LOG(INFO) << "Driver finish training for epoch " << (epoch_ + 1);
     data_.rewind();
+    if (data_.cache_size() > 0) {
+      LOG(INFO) << "Driver data cache usage = " << data_.cache_usage()
+                << ", cached = " << data_.cached();
+    }
     if (FLAGS_driver_save > 0 && (epoch_ + 1) % FLAGS_driver_save == 0) {
       LOG(INFO) << "Driver save model for epoch " << (epoch_ + 1);
       save();
@@ -91,15 +128,7 @@ void Driver< D, U, M, L, T, V, I >::runTrain() {
 template < typename D, typename U, typename M, typename L, typename T,
            typename V, typename I >
 void Driver< D, U, M, L, T, V, I >::runTest() {
-  using namespace ::std::filesystem;
-  using ::thunder::FileBinarySerializer;
-
-  path model_path = path(FLAGS_driver_location).append(
-      FLAGS_driver_model);
-  LOG(INFO) << "Driver load inference model from " << model_path.string();
-  FileBinarySerializer model_serializer(
-      model_path.string(), FileBinarySerializer::in);
-  model_serializer.load(&model_);
+  load();
 
   LOG(INFO) << "Driver start testing on file " << FLAGS_data_file;
   test_.test([&](const test_local &local) -> void {testCallback(local);});
@@ -111,15 +140,7 @@ void Driver< D, U, M, L, T, V, I >::runTest() {
 template < typename D, typename U, typename M, typename L, typename T,
            typename V, typename I >
 void Driver< D, U, M, L, T, V, I >::runInfer() {
-  using namespace ::std::filesystem;
-  using ::thunder::FileBinarySerializer;
-
-  path model_path = path(FLAGS_driver_location).append(
-      FLAGS_driver_model);
-  LOG(INFO) << "Driver load inference model from " << model_path.string();
-  FileBinarySerializer model_serializer(
-      model_path.string(), FileBinarySerializer::in);
-  model_serializer.load(&model_);
+  load();
 
   LOG(INFO) << "Driver start inference on " << FLAGS_data_file;
   LOG(INFO) << "Driver inference result is written to " << FLAGS_infer_file;
@@ -130,6 +151,220 @@ void Driver< D, U, M, L, T, V, I >::runInfer() {
   LOG(INFO) << "Driver finish inference";
 }
 
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+void Driver< D, U, M, L, T, V, I >::runConvert() {
+  LOG(INFO) << "Driver start converting " << FLAGS_data_file
+            << " to binary format at " << FLAGS_data_binary_file;
+  if (data_.convert(FLAGS_data_binary_file, FLAGS_data_binary_label) ==
+      false) {
+    LOG(FATAL) << "Driver conversion failure";
+  }
+  LOG(INFO) << "Driver finish converting";
+}
+
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+void Driver< D, U, M, L, T, V, I >::runServe() {
+  load();
+
+  Predictor< M > predictor(model_);
+  Server< Predictor< M > > server(
+      &predictor, FLAGS_serve_socket, FLAGS_serve_port,
+      FLAGS_serve_thread_size, FLAGS_serve_batch_size);
+  if (FLAGS_serve_socket.size() > 0) {
+    LOG(INFO) << "Driver serve requests on " << FLAGS_serve_socket;
+  } else {
+    LOG(INFO) << "Driver serve requests on loopback port " << FLAGS_serve_port;
+  }
+  if (server.run() == false) {
+    LOG(FATAL) << "Driver cannot listen for requests";
+  }
+  LOG(INFO) << "Driver finish serving " << server.count() << " requests";
+}
+
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+void Driver< D, U, M, L, T, V, I >::runQuantize() {
+  if constexpr (::std::is_same< embedding_type, QuantTensor >::value) {
+    // Quantize the input embeddings only, since the output embedding is a
+    // small dense matrix used by every sample
+    auto quantize = [&](dense_model_type *m) -> embedding_array {
+      embedding_array input_embedding;
+      size_type dense_size = 0;
+      size_type quantized_size = 0;
+      for (const tensor_type &embedding : m->input_embedding()) {
+        input_embedding.push_back(QuantTensor(
+            embedding.size(0), embedding.size(1), FLAGS_quantize_bits));
+        input_embedding.back().copy(embedding);
+        dense_size = dense_size + embedding.size(0) * embedding.size(1) *
+            sizeof(value_type);
+        quantized_size = quantized_size + embedding.size(0) *
+            input_embedding.back().stride(0);
+      }
+      LOG(INFO) << "Driver quantize input embeddings to "
+                << FLAGS_quantize_bits << " bits from " << dense_size
+                << " bytes to " << quantized_size << " bytes";
+      return input_embedding;
+    };
+    if (FLAGS_quantize_tensor == "double") {
+      convert< Model< ::thunder::DoubleTensor, hash_type > >(
+          quantize, "quantization", FLAGS_quantize_file);
+    } else {
+      convert< Model< ::thunder::FloatTensor, hash_type > >(
+          quantize, "quantization", FLAGS_quantize_file);
+    }
+  } else {
+    LOG(FATAL) << "Driver can only quantize into quantized models";
+  }
+}
+
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+void Driver< D, U, M, L, T, V, I >::runCompact() {
+  typedef typename dense_model_type::plan_array plan_array;
+  typedef typename dense_model_type::plan_entry plan_entry;
+
+  if constexpr (::std::is_same< embedding_type, SparseTensor >::value) {
+    auto compact = [&](dense_model_type *m) -> embedding_array {
+      // Count the uses of each input embedding row in the data, up to the
+      // count needed to keep it
+      ::std::vector< ::std::vector< uint64_t > > count(m->input_size());
+      for (size_type i = 0; i < m->input_size(); ++i) {
+        count[i].resize(
+            FLAGS_compact_count > 0 ? m->input_embedding_size(i) : 0, 0);
+      }
+      if (FLAGS_compact_count > 0) {
+        LOG(INFO) << "Driver count input embedding rows used in data";
+        field_array input;
+        index_pair label;
+        plan_array plan;
+        while (data_.getSample(&input, &label)) {
+          m->plan(input, &plan);
+          for (const plan_entry &entry : plan) {
+            if (entry.index >= count[entry.field].size()) {
+              continue;
+            }
+            uint64_t &field_count = count[entry.field][entry.index];
+            field_count = ::std::min< uint64_t >(
+                field_count + 1, FLAGS_compact_count);
+          }
+        }
+        data_.rewind();
+      }
+      // Keep the rows used enough whose norm is large enough
+      embedding_array input_embedding;
+      size_type dense_size = 0;
+      size_type compact_size = 0;
+      for (size_type i = 0; i < m->input_size(); ++i) {
+        const tensor_type &embedding = m->input_embedding()[i];
+        typename SparseTensor::index_array rows;
+        for (size_type j = 0; j < embedding.size(0); ++j) {
+          if (FLAGS_compact_count > 0 &&
+              count[i][j] < FLAGS_compact_count) {
+            continue;
+          }
+          const value_type *row = embedding.data() + j * embedding.stride(0);
+          double norm = 0.0;
+          for (size_type k = 0; k < embedding.size(1); ++k) {
+            norm = norm + static_cast< double >(row[k]) * row[k];
+          }
+          if (::std::sqrt(norm) > FLAGS_compact_norm) {
+            rows.push_back(j);
+          }
+        }
+        LOG(INFO) << "Driver compact input embedding " << i << " from "
+                  << embedding.size(0) << " rows to " << rows.size()
+                  << " rows";
+        input_embedding.push_back(SparseTensor(embedding, rows));
+        dense_size = dense_size + embedding.size(0) * embedding.size(1) *
+            sizeof(value_type);
+        compact_size = compact_size + rows.size() * (
+            embedding.size(1) * sizeof(float) + sizeof(uint64_t));
+      }
+      LOG(INFO) << "Driver compact input embeddings from " << dense_size
+                << " bytes to " << compact_size << " bytes";
+      return input_embedding;
+    };
+    if (FLAGS_compact_tensor == "double") {
+      convert< Model< ::thunder::DoubleTensor, hash_type > >(
+          compact, "compaction", FLAGS_compact_file);
+    } else {
+      convert< Model< ::thunder::FloatTensor, hash_type > >(
+          compact, "compaction", FLAGS_compact_file);
+    }
+  } else {
+    LOG(FATAL) << "Driver can only compact into sparse models";
+  }
+}
+
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+template < typename S, typename F >
+void Driver< D, U, M, L, T, V, I >::convert(
+    const F &f, const ::std::string &name, const ::std::string &file) {
+  using ::std::filesystem::path;
+  using ::thunder::FileBinarySerializer;
+  typedef Test< D, dense_model_type, L > dense_test;
+
+  S source({1}, 1, 1);
+  load(&source);
+  // Copy the trained model at the value type to test it before converting
+  auto dense = [](const auto &t) -> tensor_type {
+    tensor_type result(t.size(0), t.size(1));
+    for (size_type i = 0; i < t.size(0); ++i) {
+      for (size_type j = 0; j < t.size(1); ++j) {
+        result.data()[i * result.stride(0) + j * result.stride(1)] =
+            static_cast< value_type >(
+                t.data()[i * t.stride(0) + j * t.stride(1)]);
+      }
+    }
+    return result;
+  };
+  tensor_array dense_embedding;
+  for (const auto &embedding : source.input_embedding()) {
+    dense_embedding.push_back(dense(embedding));
+  }
+  dense_model_type model(dense_embedding, dense(source.output_embedding()),
+                         source.gram(), source.seed());
+  dense_test test(&data_, &model, &loss_, FLAGS_test_label_size,
+                  FLAGS_test_thread_size);
+  LOG(INFO) << "Driver start testing the model before " << name;
+  test.test([](const typename dense_test::local_type &) -> void {});
+  test.join();
+  LOG(INFO) << "Driver finish testing the model before " << name
+            << ", error = " << test.error() << ", objective = "
+            << test.objective();
+  data_.rewind();
+
+  model_.set_input_embedding(f(&model));
+  model_.set_output_embedding(model.output_embedding());
+  model_.set_gram(model.gram());
+  model_.set_seed(model.seed());
+
+  LOG(INFO) << "Driver start testing the model after " << name;
+  test_.test([&](const test_local &local) -> void {testCallback(local);});
+  test_.join();
+  LOG(INFO) << "Driver finish testing the model after " << name
+            << ", error = " << test_.error() << ", objective = "
+            << test_.objective();
+  LOG(INFO) << "Driver " << name << " changes error by "
+            << test_.error() - test.error() << " and objective by "
+            << test_.objective() - test.objective();
+
+  path model_path = path(FLAGS_driver_location).append(file);
+  LOG(INFO) << "Driver save model to " << model_path.string();
+  FileBinarySerializer model_serializer(
+      model_path.string(), FileBinarySerializer::out);
+  model_serializer.save(model_);
+  if (FLAGS_driver_map == true) {
+    path map_path = model_path.replace_extension(".bsm");
+    if (ModelMap< M >::save(model_, map_path.string()) == false) {
+      LOG(ERROR) << "Driver cannot save model to " << map_path.string();
+    }
+  }
+}
+
 template < typename D, typename U, typename M, typename L, typename T,
            typename V, typename I >
 void Driver< D, U, M, L, T, V, I >::checkpoint() {
@@ -153,6 +388,22 @@ void Driver< D, U, M, L, T, V, I >::checkpoint() {
   driver_serializer.save(data_.offset());
   driver_serializer.save(train_.step());
   driver_serializer.save(epoch_);
+  // Per-shard positions follow if the data is sharded
+  if (data_.shard_size() > 1) {
+    for (size_type i = 0; i < data_.shard_size(); ++i) {
+      driver_serializer.save(data_.count(i));
+      driver_serializer.save(data_.offset(i));
+    }
+  }
+  // The shuffled order follows if samples are shuffled, with whether each
+  // shard is read in a permutation, which depends on the cache
+  if (data_.shuffle_size() > 0) {
+    driver_serializer.save(data_.shuffle_seed());
+    driver_serializer.save(data_.pass());
+    for (size_type i = 0; i < data_.shard_size(); ++i) {
+      driver_serializer.save(static_cast< size_type >(data_.ordered(i)));
+    }
+  }
 
   // Serialize the model
   path model_path = path(FLAGS_driver_location).append("model.tdb");
@@ -182,6 +433,13 @@ void Driver< D, U, M, L, T, V, I >::save() {
   FileBinarySerializer model_serializer(
       model_path.string(), FileBinarySerializer::out);
   model_serializer.save(model_);
+  if (FLAGS_driver_map == true) {
+    path map_path = path(FLAGS_driver_location).append(
+        "model_" + ::std::to_string(epoch_ + 1) + ".bsm");
+    if (ModelMap< M >::save(model_, map_path.string()) == false) {
+      LOG(ERROR) << "Driver cannot save model to " << map_path.string();
+    }
+  }
 
   // Unlock the training process
   train_.unlock();
@@ -200,11 +458,44 @@ void Driver< D, U, M, L, T, V, I >::resume() {
   driver_serializer.load(&data_count);
   long data_offset;
   driver_serializer.load(&data_offset);
-  data_.seek(data_offset, data_count);
   size_type train_step;
   driver_serializer.load(&train_step);
   train_.set_step(train_step);
   driver_serializer.load(&epoch_);
+  ::std::vector< size_type > shard_count(data_.shard_size(), data_count);
+  ::std::vector< long > shard_offset(data_.shard_size(), data_offset);
+  if (data_.shard_size() > 1) {
+    for (size_type i = 0; i < data_.shard_size(); ++i) {
+      driver_serializer.load(&shard_count[i]);
+      driver_serializer.load(&shard_offset[i]);
+    }
+  }
+  // Restore the shuffled order before seeking, which replays it
+  if (data_.shuffle_size() > 0) {
+    uint64_t shuffle_seed;
+    driver_serializer.load(&shuffle_seed);
+    data_.set_shuffle_seed(shuffle_seed);
+    size_type data_pass;
+    driver_serializer.load(&data_pass);
+    data_.set_pass(data_pass);
+    // Each shard is positioned and replayed once on its own, in the order
+    // it was read whatever the cache holds now
+    for (size_type i = 0; i < data_.shard_size(); ++i) {
+      size_type ordered;
+      driver_serializer.load(&ordered);
+      if (data_.seek(i, shard_offset[i], shard_count[i], ordered != 0) ==
+          false) {
+        LOG(FATAL) << "Driver cannot replay shuffled data shard " << i;
+      }
+    }
+  } else if (data_.shard_size() == 1) {
+    data_.seek(data_offset, data_count);
+  } else {
+    // Each shard is positioned once on its own
+    for (size_type i = 0; i < data_.shard_size(); ++i) {
+      data_.seek(i, shard_offset[i], shard_count[i]);
+    }
+  }
 
   path model_path = path(FLAGS_driver_location).append("model.tdb");
   FileBinarySerializer model_serializer(
@@ -212,6 +503,60 @@ void Driver< D, U, M, L, T, V, I >::resume() {
   model_serializer.load(&model_);
 }
 
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+void Driver< D, U, M, L, T, V, I >::load() {
+  using ::std::filesystem::path;
+
+  path model_path = path(FLAGS_driver_location).append(FLAGS_driver_model);
+  place(ModelMap< M >::check(model_path.string()));
+  load(&model_);
+  if (model_.placed() == false) {
+    LOG(WARNING) << "Driver cannot place all input embeddings as requested";
+  }
+}
+
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+template < typename X >
+void Driver< D, U, M, L, T, V, I >::load(X *m) {
+  using ::std::filesystem::path;
+  using ::thunder::FileBinarySerializer;
+
+  path model_path = path(FLAGS_driver_location).append(FLAGS_driver_model);
+  if (ModelMap< X >::check(model_path.string()) == true) {
+    // Mapped models are read-only, which is fine for anything but training
+    LOG(INFO) << "Driver map model from " << model_path.string();
+    if (ModelMap< X >::load(model_path.string(), m) == false) {
+      LOG(FATAL) << "Driver cannot map model from " << model_path.string();
+    }
+    return;
+  }
+  LOG(INFO) << "Driver load model from " << model_path.string();
+  FileBinarySerializer model_serializer(
+      model_path.string(), FileBinarySerializer::in);
+  model_serializer.load(m);
+}
+
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+void Driver< D, U, M, L, T, V, I >::place(bool mapped) {
+  Placement placement = parsePlacement();
+  if (placement.page() == kDefaultPage &&
+      placement.policy() == kDefaultPolicy) {
+    return;
+  }
+  if (mapped == true) {
+    // Copying would turn pages shared with the page cache into private ones
+    LOG(INFO) << "Driver skip placement of input embeddings for mapped model";
+    return;
+  }
+  LOG(INFO) << "Driver place input embeddings with page = "
+            << FLAGS_model_page << ", policy = " << FLAGS_model_policy
+            << " and node = " << FLAGS_model_node;
+  model_.set_placement(placement);
+}
+
 template < typename D, typename U, typename M, typename L, typename T,
            typename V, typename I >
 void Driver< D, U, M, L, T, V, I >::trainCallback(const train_local &local) {
@@ -284,11 +629,16 @@ bool Driver< D, U, M, L, T, V, I >::checkCheckpoint() {
 template < typename D, typename U, typename M, typename L, typename T,
            typename V, typename I >
 void Driver< D, U, M, L, T, V, I >::trainLog(const train_local &local) {
+  // Ratio of unique activated embeddings to all activations
+  double dedupe_ratio = train_.activation_count() == 0 ? 1.0 :
+      static_cast< double >(train_.plan_count()) /
+      static_cast< double >(train_.activation_count());
   ::std::ostringstream message;
   message << ::std::setprecision(FLAGS_driver_log_precision)
           << "Train step = " << train_.step() << ", rate = " << train_.rate()
           << ", data_objective = " << local.data_objective
-          << ", universum_objective = " << local.universum_objective;
+          << ", universum_objective = " << local.universum_objective
+          << ", dedupe_ratio = " << dedupe_ratio;
   if (FLAGS_driver_debug == true) {
     // Log data
     const field_array &data_input = local.data_input;
@@ -310,7 +660,8 @@ void Driver< D, U, M, L, T, V, I >::trainLog(const train_local &local) {
     message << ", universum_label = " << universum_label.first
             << ":" << universum_label.second;
     // Log model and loss data
-    const tensor_array &input_embedding = local.model.input_embedding();
+    const embedding_array &input_embedding =
+        local.model.input_embedding();
     const tensor_type &output_embedding = local.model.output_embedding();
     const tensor_type &output = local.model.output();
     const tensor_type &grad_output = local.loss.grad_input();
@@ -350,7 +701,8 @@ void Driver< D, U, M, L, T, V, I >::testLog(const test_local &local) {
     message << ", data_label = " << data_label.first
             << ":" << data_label.second;
     // Log model and loss data
-    const tensor_array &input_embedding = local.model.input_embedding();
+    const embedding_array &input_embedding =
+        local.model.input_embedding();
     const tensor_type &output_embedding = local.model.output_embedding();
     const tensor_type &output = local.model.output();
     const tensor_type &feature = local.model.feature();
@@ -379,10 +731,11 @@ void Driver< D, U, M, L, T, V, I >::inferLog(const infer_local &local) {
       message << ", data_input[" << i << "] = " << fieldToString(data_input[i]);
     }
     // Log model and loss data
-    const tensor_array &input_embedding = model_.input_embedding();
-    const tensor_type &output_embedding = model_.output_embedding();
-    const tensor_type &output = model_.output();
-    const tensor_type &feature = model_.feature();
+    const embedding_array &input_embedding =
+        local.model.input_embedding();
+    const tensor_type &output_embedding = local.model.output_embedding();
+    const tensor_type &output = local.model.output();
+    const tensor_type &feature = local.model.feature();
     for (size_type i = 0; i < input_embedding.size(); ++i) {
       message << ", input_embedding[" << i << "] = " << tensorToString(
           input_embedding[i]);
@@ -430,6 +783,34 @@ Driver< D, U, M, L, T, V, I >::parseModelInputSize() {
   return input_size_storage;
 }
 
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+Placement Driver< D, U, M, L, T, V, I >::parsePlacement() {
+  Placement placement;
+  if (FLAGS_model_page == "huge") {
+    placement.set_page(kHugePage);
+  } else if (FLAGS_model_page == "hugetlb") {
+    placement.set_page(kHugetlbPage);
+  }
+  if (FLAGS_model_policy == "interleave") {
+    placement.set_policy(kInterleavePolicy);
+  } else if (FLAGS_model_policy == "bind") {
+    placement.set_policy(kBindPolicy);
+  }
+  placement.set_node(FLAGS_model_node);
+  return placement;
+}
+
+template < typename D, typename U, typename M, typename L, typename T,
+           typename V, typename I >
+Placement Driver< D, U, M, L, T, V, I >::parseModelPlacement() {
+  // Other tasks replace the constructed model by loading it
+  if (FLAGS_joe_task == "train" && FLAGS_driver_resume == false) {
+    return parsePlacement();
+  }
+  return Placement();
+}
+
 template < typename D, typename U, typename M, typename L, typename T,
            typename V, typename I >
 typename Driver< D, U, M, L, T, V, I >::gram_array
@@ -477,8 +858,8 @@ Driver< D, U, M, L, T, V, I >::parseModelGram() {
 
 template < typename D, typename U, typename M, typename L, typename T,
            typename V, typename I >
-::std::string Driver< D, U, M, L, T, V, I >::tensorToString(
-     const tensor_type &t) {
+template < typename X >
+::std::string Driver< D, U, M, L, T, V, I >::tensorToString(const X &t) {
   ::std::ostringstream stream;
   stream <<  ::std::setprecision(FLAGS_driver_log_precision)
          << "[" << t.size(0);
@@ -37,6 +37,12 @@ template class Driver<
 template class Driver<
   FloatData, FloatUniversum, FloatCityModel, FloatNLLLoss,
   FloatCityNLLTrain, FloatCityNLLTest, FloatCityNLLInfer >;
+template class Driver<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleNLLLoss,
+  DoubleRollingNLLTrain, DoubleRollingNLLTest, DoubleRollingNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, FloatRollingModel, FloatNLLLoss,
+  FloatRollingNLLTrain, FloatRollingNLLTest, FloatRollingNLLInfer >;
 template class Driver<
   DoubleData, DoubleUniversum, DoubleFNVModel, DoubleHingeLoss,
   DoubleFNVHingeTrain, DoubleFNVHingeTest, DoubleFNVHingeInfer >;
@@ -49,4 +55,64 @@ template class Driver<
 template class Driver<
   FloatData, FloatUniversum, FloatCityModel, FloatHingeLoss,
   FloatCityHingeTrain, FloatCityHingeTest, FloatCityHingeInfer >;
+template class Driver<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleHingeLoss,
+  DoubleRollingHingeTrain, DoubleRollingHingeTest, DoubleRollingHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, FloatRollingModel, FloatHingeLoss,
+  FloatRollingHingeTrain, FloatRollingHingeTest, FloatRollingHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, HalfFNVModel, FloatNLLLoss,
+  HalfFNVNLLTrain, HalfFNVNLLTest, HalfFNVNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, HalfCityModel, FloatNLLLoss,
+  HalfCityNLLTrain, HalfCityNLLTest, HalfCityNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, HalfRollingModel, FloatNLLLoss,
+  HalfRollingNLLTrain, HalfRollingNLLTest, HalfRollingNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, HalfFNVModel, FloatHingeLoss,
+  HalfFNVHingeTrain, HalfFNVHingeTest, HalfFNVHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, HalfCityModel, FloatHingeLoss,
+  HalfCityHingeTrain, HalfCityHingeTest, HalfCityHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, HalfRollingModel, FloatHingeLoss,
+  HalfRollingHingeTrain, HalfRollingHingeTest, HalfRollingHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, QuantFNVModel, FloatNLLLoss,
+  QuantFNVNLLTrain, QuantFNVNLLTest, QuantFNVNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, QuantCityModel, FloatNLLLoss,
+  QuantCityNLLTrain, QuantCityNLLTest, QuantCityNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, QuantRollingModel, FloatNLLLoss,
+  QuantRollingNLLTrain, QuantRollingNLLTest, QuantRollingNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, QuantFNVModel, FloatHingeLoss,
+  QuantFNVHingeTrain, QuantFNVHingeTest, QuantFNVHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, QuantCityModel, FloatHingeLoss,
+  QuantCityHingeTrain, QuantCityHingeTest, QuantCityHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, QuantRollingModel, FloatHingeLoss,
+  QuantRollingHingeTrain, QuantRollingHingeTest, QuantRollingHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, SparseFNVModel, FloatNLLLoss,
+  SparseFNVNLLTrain, SparseFNVNLLTest, SparseFNVNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, SparseCityModel, FloatNLLLoss,
+  SparseCityNLLTrain, SparseCityNLLTest, SparseCityNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, SparseRollingModel, FloatNLLLoss,
+  SparseRollingNLLTrain, SparseRollingNLLTest, SparseRollingNLLInfer >;
+template class Driver<
+  FloatData, FloatUniversum, SparseFNVModel, FloatHingeLoss,
+  SparseFNVHingeTrain, SparseFNVHingeTest, SparseFNVHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, SparseCityModel, FloatHingeLoss,
+  SparseCityHingeTrain, SparseCityHingeTest, SparseCityHingeInfer >;
+template class Driver<
+  FloatData, FloatUniversum, SparseRollingModel, FloatHingeLoss,
+  SparseRollingHingeTrain, SparseRollingHingeTest, SparseRollingHingeInfer >;
 }  // namespace bytesteady
@@ -25,6 +25,10 @@
 #include "bytesteady/integer.hpp"
 #include "bytesteady/loss.hpp"
 #include "bytesteady/model.hpp"
+#include "bytesteady/model_map.hpp"
+#include "bytesteady/placement.hpp"
+#include "bytesteady/predictor.hpp"
+#include "bytesteady/server.hpp"
 #include "bytesteady/test.hpp"
 #include "bytesteady/train.hpp"
 #include "bytesteady/universum.hpp"
@@ -50,15 +54,19 @@ class Driver {
   typedef typename D::index_array index_array;
   typedef typename D::index_pair index_pair;
   typedef typename M::gram_array gram_array;
+  typedef typename M::hash_type hash_type;
   typedef typename M::size_array size_array;
   typedef typename M::size_storage size_storage;
   typedef typename M::size_type size_type;
+  typedef typename M::embedding_array embedding_array;
+  typedef typename M::embedding_type embedding_type;
   typedef typename M::tensor_array tensor_array;
   typedef typename M::tensor_type tensor_type;
   typedef typename M::value_type value_type;
   typedef typename T::local_type train_local;
   typedef typename V::local_type test_local;
   typedef typename I::local_type infer_local;
+  typedef Model< tensor_type, hash_type > dense_model_type;
   typedef typename ::std::chrono::duration< double > duration_type;
   typedef typename ::std::chrono::steady_clock::time_point time_point;
 
@@ -67,10 +75,30 @@ class Driver {
   void runTrain();
   void runTest();
   void runInfer();
+  void runConvert();
+  void runServe();
+  // Quantize a trained model and report testing results before and after
+  void runQuantize();
+  // Compact a trained model and report testing results before and after
+  void runCompact();
 
   void checkpoint();
   void save();
   void resume();
+  // Load the testing or inference model in either file layout
+  void load();
+  template < typename X >
+  void load(X *m);
+  // Allocate input embeddings from now on as placed by the flags, unless the
+  // model is mapped
+  void place(bool mapped);
+  // Convert a trained model of type S into the model. The trained model is
+  // loaded at the value type and given to f, which returns the input
+  // embeddings. Testing results before and after the conversion are logged
+  // and the model is saved to file.
+  template < typename S, typename F >
+  void convert(const F &f, const ::std::string &name,
+               const ::std::string &file);
 
   void trainCallback(const train_local &local);
   void testCallback(const test_local &local);
@@ -86,8 +114,13 @@ class Driver {
   static format_array parseDataFormat();
   static size_storage parseModelInputSize();
   static gram_array parseModelGram();
+  static Placement parsePlacement();
+  // Placement of the constructed model, which only training from scratch uses
+  static Placement parseModelPlacement();
 
-  static ::std::string tensorToString(const tensor_type &t);
+  // Summary of a tensor or an input embedding
+  template < typename X >
+  static ::std::string tensorToString(const X &t);
   static ::std::string fieldToString(const field_variant &f);
 
   const D &data();
@@ -132,6 +165,14 @@ DoubleCityNLLDriver;
 typedef Driver<
   FloatData, FloatUniversum, FloatCityModel, FloatNLLLoss,
   FloatCityNLLTrain, FloatCityNLLTest, FloatCityNLLInfer > FloatCityNLLDriver;
+typedef Driver<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleNLLLoss,
+  DoubleRollingNLLTrain, DoubleRollingNLLTest, DoubleRollingNLLInfer >
+DoubleRollingNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, FloatRollingModel, FloatNLLLoss,
+  FloatRollingNLLTrain, FloatRollingNLLTest, FloatRollingNLLInfer >
+FloatRollingNLLDriver;
 typedef Driver<
   DoubleData, DoubleUniversum, DoubleFNVModel, DoubleHingeLoss,
   DoubleFNVHingeTrain, DoubleFNVHingeTest, DoubleFNVHingeInfer >
@@ -148,6 +189,86 @@ typedef Driver<
   FloatData, FloatUniversum, FloatCityModel, FloatHingeLoss,
   FloatCityHingeTrain, FloatCityHingeTest, FloatCityHingeInfer >
 FloatCityHingeDriver;
+typedef Driver<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleHingeLoss,
+  DoubleRollingHingeTrain, DoubleRollingHingeTest, DoubleRollingHingeInfer >
+DoubleRollingHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, FloatRollingModel, FloatHingeLoss,
+  FloatRollingHingeTrain, FloatRollingHingeTest, FloatRollingHingeInfer >
+FloatRollingHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, HalfFNVModel, FloatNLLLoss,
+  HalfFNVNLLTrain, HalfFNVNLLTest, HalfFNVNLLInfer >
+HalfFNVNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, HalfCityModel, FloatNLLLoss,
+  HalfCityNLLTrain, HalfCityNLLTest, HalfCityNLLInfer >
+HalfCityNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, HalfRollingModel, FloatNLLLoss,
+  HalfRollingNLLTrain, HalfRollingNLLTest, HalfRollingNLLInfer >
+HalfRollingNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, HalfFNVModel, FloatHingeLoss,
+  HalfFNVHingeTrain, HalfFNVHingeTest, HalfFNVHingeInfer >
+HalfFNVHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, HalfCityModel, FloatHingeLoss,
+  HalfCityHingeTrain, HalfCityHingeTest, HalfCityHingeInfer >
+HalfCityHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, HalfRollingModel, FloatHingeLoss,
+  HalfRollingHingeTrain, HalfRollingHingeTest, HalfRollingHingeInfer >
+HalfRollingHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, QuantFNVModel, FloatNLLLoss,
+  QuantFNVNLLTrain, QuantFNVNLLTest, QuantFNVNLLInfer >
+QuantFNVNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, QuantCityModel, FloatNLLLoss,
+  QuantCityNLLTrain, QuantCityNLLTest, QuantCityNLLInfer >
+QuantCityNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, QuantRollingModel, FloatNLLLoss,
+  QuantRollingNLLTrain, QuantRollingNLLTest, QuantRollingNLLInfer >
+QuantRollingNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, QuantFNVModel, FloatHingeLoss,
+  QuantFNVHingeTrain, QuantFNVHingeTest, QuantFNVHingeInfer >
+QuantFNVHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, QuantCityModel, FloatHingeLoss,
+  QuantCityHingeTrain, QuantCityHingeTest, QuantCityHingeInfer >
+QuantCityHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, QuantRollingModel, FloatHingeLoss,
+  QuantRollingHingeTrain, QuantRollingHingeTest, QuantRollingHingeInfer >
+QuantRollingHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, SparseFNVModel, FloatNLLLoss,
+  SparseFNVNLLTrain, SparseFNVNLLTest, SparseFNVNLLInfer >
+SparseFNVNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, SparseCityModel, FloatNLLLoss,
+  SparseCityNLLTrain, SparseCityNLLTest, SparseCityNLLInfer >
+SparseCityNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, SparseRollingModel, FloatNLLLoss,
+  SparseRollingNLLTrain, SparseRollingNLLTest, SparseRollingNLLInfer >
+SparseRollingNLLDriver;
+typedef Driver<
+  FloatData, FloatUniversum, SparseFNVModel, FloatHingeLoss,
+  SparseFNVHingeTrain, SparseFNVHingeTest, SparseFNVHingeInfer >
+SparseFNVHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, SparseCityModel, FloatHingeLoss,
+  SparseCityHingeTrain, SparseCityHingeTest, SparseCityHingeInfer >
+SparseCityHingeDriver;
+typedef Driver<
+  FloatData, FloatUniversum, SparseRollingModel, FloatHingeLoss,
+  SparseRollingHingeTrain, SparseRollingHingeTest, SparseRollingHingeInfer >
+SparseRollingHingeDriver;
 
 }  // namespace bytesteady
 
@@ -165,6 +286,12 @@ extern template class Driver<
 extern template class Driver<
   FloatData, FloatUniversum, FloatCityModel, FloatNLLLoss,
   FloatCityNLLTrain, FloatCityNLLTest, FloatCityNLLInfer >;
+extern template class Driver<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleNLLLoss,
+  DoubleRollingNLLTrain, DoubleRollingNLLTest, DoubleRollingNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, FloatRollingModel, FloatNLLLoss,
+  FloatRollingNLLTrain, FloatRollingNLLTest, FloatRollingNLLInfer >;
 extern template class Driver<
   DoubleData, DoubleUniversum, DoubleFNVModel, DoubleHingeLoss,
   DoubleFNVHingeTrain, DoubleFNVHingeTest, DoubleFNVHingeInfer >;
@@ -177,6 +304,66 @@ extern template class Driver<
 extern template class Driver<
   FloatData, FloatUniversum, FloatCityModel, FloatHingeLoss,
   FloatCityHingeTrain, FloatCityHingeTest, FloatCityHingeInfer >;
+extern template class Driver<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleHingeLoss,
+  DoubleRollingHingeTrain, DoubleRollingHingeTest, DoubleRollingHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, FloatRollingModel, FloatHingeLoss,
+  FloatRollingHingeTrain, FloatRollingHingeTest, FloatRollingHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, HalfFNVModel, FloatNLLLoss,
+  HalfFNVNLLTrain, HalfFNVNLLTest, HalfFNVNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, HalfCityModel, FloatNLLLoss,
+  HalfCityNLLTrain, HalfCityNLLTest, HalfCityNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, HalfRollingModel, FloatNLLLoss,
+  HalfRollingNLLTrain, HalfRollingNLLTest, HalfRollingNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, HalfFNVModel, FloatHingeLoss,
+  HalfFNVHingeTrain, HalfFNVHingeTest, HalfFNVHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, HalfCityModel, FloatHingeLoss,
+  HalfCityHingeTrain, HalfCityHingeTest, HalfCityHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, HalfRollingModel, FloatHingeLoss,
+  HalfRollingHingeTrain, HalfRollingHingeTest, HalfRollingHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, QuantFNVModel, FloatNLLLoss,
+  QuantFNVNLLTrain, QuantFNVNLLTest, QuantFNVNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, QuantCityModel, FloatNLLLoss,
+  QuantCityNLLTrain, QuantCityNLLTest, QuantCityNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, QuantRollingModel, FloatNLLLoss,
+  QuantRollingNLLTrain, QuantRollingNLLTest, QuantRollingNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, QuantFNVModel, FloatHingeLoss,
+  QuantFNVHingeTrain, QuantFNVHingeTest, QuantFNVHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, QuantCityModel, FloatHingeLoss,
+  QuantCityHingeTrain, QuantCityHingeTest, QuantCityHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, QuantRollingModel, FloatHingeLoss,
+  QuantRollingHingeTrain, QuantRollingHingeTest, QuantRollingHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, SparseFNVModel, FloatNLLLoss,
+  SparseFNVNLLTrain, SparseFNVNLLTest, SparseFNVNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, SparseCityModel, FloatNLLLoss,
+  SparseCityNLLTrain, SparseCityNLLTest, SparseCityNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, SparseRollingModel, FloatNLLLoss,
+  SparseRollingNLLTrain, SparseRollingNLLTest, SparseRollingNLLInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, SparseFNVModel, FloatHingeLoss,
+  SparseFNVHingeTrain, SparseFNVHingeTest, SparseFNVHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, SparseCityModel, FloatHingeLoss,
+  SparseCityHingeTrain, SparseCityHingeTest, SparseCityHingeInfer >;
+extern template class Driver<
+  FloatData, FloatUniversum, SparseRollingModel, FloatHingeLoss,
+  SparseRollingHingeTrain, SparseRollingHingeTest, SparseRollingHingeInfer >;
 }  // namespace bytesteady
 
 #endif  // BYTESTEADY_DRIVER_HPP_
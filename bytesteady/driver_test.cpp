@@ -23,6 +23,11 @@ void setFlags() {
   // Data configuration
   FLAGS_data_file = "bytesteady/unittest_train.txt";
   FLAGS_data_format = "kBytes,kIndex";
+  FLAGS_data_cache = false;
+  FLAGS_data_cache_size = 16;
+  FLAGS_data_shuffle = false;
+  FLAGS_data_shuffle_size = 8;
+  FLAGS_data_shuffle_seed = 1946;
 
   // Model configuration
   FLAGS_model_input_size = "1024,16";
@@ -41,6 +46,9 @@ void setFlags() {
   FLAGS_train_n = 4;
   FLAGS_train_rho = 0.25;
   FLAGS_train_thread_size = 4;
+  FLAGS_train_batch_size = 1;
+  FLAGS_train_prefetch_size = 0;
+  FLAGS_train_reader_size = 2;
 
   // Test configuration
   FLAGS_test_thread_size = 2;
@@ -60,10 +68,12 @@ void setFlags() {
   FLAGS_driver_log_precision = 4;
   FLAGS_driver_checkpoint_interval = 5.0;
   FLAGS_driver_model = "model.tdb";
+  FLAGS_driver_map = true;
 }
 
 template < typename D >
-void trainTest() {
+void trainTest(uint64_t batch_size, uint64_t prefetch_size, bool cache,
+               bool shuffle) {
   typedef typename D::data_type data_type;
   typedef typename D::universum_type universum_type;
   typedef typename D::model_type model_type;
@@ -75,6 +85,10 @@ void trainTest() {
 
   // Create the driver object
   setFlags();
+  FLAGS_train_batch_size = batch_size;
+  FLAGS_train_prefetch_size = prefetch_size;
+  FLAGS_data_cache = cache;
+  FLAGS_data_shuffle = shuffle;
   D driver;
 
   // Check data properties
@@ -83,6 +97,8 @@ void trainTest() {
   EXPECT_EQ(2, data.format().size());
   EXPECT_EQ(kBytes, data.format()[0]);
   EXPECT_EQ(kIndex, data.format()[1]);
+  EXPECT_EQ(cache ? FLAGS_data_cache_size << 20 : 0, data.cache_size());
+  EXPECT_EQ(shuffle ? FLAGS_data_shuffle_size : 0, data.shuffle_size());
 
   const universum_type &universum = driver.universum();
 
@@ -107,6 +123,9 @@ void trainTest() {
   EXPECT_EQ(FLAGS_train_n, train.n());
   EXPECT_FLOAT_EQ(FLAGS_train_rho, train.rho());
   EXPECT_EQ(FLAGS_train_thread_size, train.thread_size());
+  EXPECT_EQ(FLAGS_train_batch_size, train.batch_size());
+  EXPECT_EQ(FLAGS_train_prefetch_size, train.prefetch_size());
+  EXPECT_EQ(FLAGS_train_reader_size, train.reader_size());
 
   const test_type &test = driver.test();
   EXPECT_EQ(FLAGS_test_label_size, test.label_size());
@@ -115,10 +134,25 @@ void trainTest() {
   EXPECT_EQ(FLAGS_infer_label_size, infer.label_size());
 
   driver.runTrain();
+  EXPECT_EQ(cache, data.cached());
+
+  // The checkpoint records the shuffled order
+  if (shuffle == true) {
+    typename data_type::size_type pass = data.pass();
+    EXPECT_EQ(FLAGS_driver_epoch_size + 1, pass);
+    driver.resume();
+    EXPECT_EQ(pass, data.pass());
+    EXPECT_EQ(FLAGS_data_shuffle_seed, data.shuffle_seed());
+  }
 }
 
 TEST(DriverTest, trainTest) {
-  trainTest< DoubleFNVNLLDriver >();
+  trainTest< DoubleFNVNLLDriver >(1, 0, false, false);
+  trainTest< DoubleFNVNLLDriver >(8, 0, false, false);
+  trainTest< DoubleFNVNLLDriver >(1, 16, false, false);
+  trainTest< DoubleFNVNLLDriver >(1, 0, true, false);
+  trainTest< DoubleFNVNLLDriver >(1, 16, false, true);
+  trainTest< DoubleFNVNLLDriver >(1, 0, true, true);
 }
 
 template < typename D >
@@ -166,6 +200,7 @@ void testTest() {
   EXPECT_EQ(FLAGS_train_n, train.n());
   EXPECT_FLOAT_EQ(FLAGS_train_rho, train.rho());
   EXPECT_EQ(FLAGS_train_thread_size, train.thread_size());
+  EXPECT_EQ(FLAGS_train_batch_size, train.batch_size());
 
   const test_type &test = driver.test();
   EXPECT_EQ(FLAGS_test_label_size, test.label_size());
@@ -222,6 +257,7 @@ void inferTest() {
   EXPECT_EQ(FLAGS_train_n, train.n());
   EXPECT_FLOAT_EQ(FLAGS_train_rho, train.rho());
   EXPECT_EQ(FLAGS_train_thread_size, train.thread_size());
+  EXPECT_EQ(FLAGS_train_batch_size, train.batch_size());
 
   const test_type &test = driver.test();
   EXPECT_EQ(FLAGS_test_label_size, test.label_size());
@@ -236,5 +272,90 @@ TEST(DriverTest, inferTest) {
   inferTest< DoubleFNVNLLDriver >();
 }
 
+template < typename D >
+void mapTest() {
+  // Test the model saved in both layouts at the last epoch
+  setFlags();
+  FLAGS_driver_model = "model_4.tdb";
+  D driver1;
+  driver1.runTest();
+  FLAGS_driver_model = "model_4.bsm";
+  D driver2;
+  driver2.runTest();
+  EXPECT_FLOAT_EQ(driver1.test().error(), driver2.test().error());
+  EXPECT_NEAR(driver1.test().objective(), driver2.test().objective(), 1e-6);
+}
+
+TEST(DriverTest, mapTest) {
+  mapTest< DoubleFNVNLLDriver >();
+}
+
+template < typename D, typename Q >
+void quantizeTest() {
+  // Quantized models stay close to the testing results of the trained model
+  setFlags();
+  FLAGS_driver_model = "model_4.tdb";
+  D driver1;
+  driver1.runTest();
+  for (int bits : {8, 4}) {
+    FLAGS_quantize_file = "model_quantized.tdb";
+    FLAGS_quantize_bits = bits;
+    FLAGS_quantize_tensor = "double";
+    Q driver2;
+    driver2.runQuantize();
+    EXPECT_NEAR(driver1.test().error(), driver2.test().error(), 0.1);
+    EXPECT_EQ(bits, driver2.model().input_embedding()[0].bits());
+
+    // The saved model tests the same in both layouts
+    FLAGS_driver_model = "model_quantized.tdb";
+    Q driver3;
+    driver3.runTest();
+    EXPECT_FLOAT_EQ(driver2.test().error(), driver3.test().error());
+    FLAGS_driver_model = "model_quantized.bsm";
+    Q driver4;
+    driver4.runTest();
+    EXPECT_FLOAT_EQ(driver2.test().error(), driver4.test().error());
+    FLAGS_driver_model = "model_4.tdb";
+  }
+}
+
+TEST(DriverTest, quantizeTest) {
+  quantizeTest< DoubleFNVNLLDriver, QuantFNVNLLDriver >();
+}
+
+template < typename D, typename C >
+void compactTest() {
+  // Compacted models keep the testing results of the trained model on the
+  // data used to count rows
+  setFlags();
+  FLAGS_driver_model = "model_4.tdb";
+  D driver1;
+  driver1.runTest();
+  FLAGS_compact_file = "model_compact.tdb";
+  FLAGS_compact_count = 1;
+  FLAGS_compact_norm = 0.0;
+  FLAGS_compact_tensor = "double";
+  C driver2;
+  driver2.runCompact();
+  EXPECT_FLOAT_EQ(driver1.test().error(), driver2.test().error());
+  EXPECT_NEAR(driver1.test().objective(), driver2.test().objective(), 1e-4);
+  EXPECT_LT(driver2.model().input_embedding()[0].retained(),
+            driver2.model().input_embedding()[0].size(0));
+
+  // The saved model tests the same in both layouts
+  FLAGS_driver_model = "model_compact.tdb";
+  C driver3;
+  driver3.runTest();
+  EXPECT_FLOAT_EQ(driver2.test().error(), driver3.test().error());
+  FLAGS_driver_model = "model_compact.bsm";
+  C driver4;
+  driver4.runTest();
+  EXPECT_FLOAT_EQ(driver2.test().error(), driver4.test().error());
+}
+
+TEST(DriverTest, compactTest) {
+  compactTest< DoubleFNVNLLDriver, SparseFNVNLLDriver >();
+}
+
 }  // namespace
 }  // namespace bytesteady
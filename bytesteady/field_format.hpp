@@ -14,6 +14,9 @@
 #ifndef BYTESTEADY_FIELD_FORMAT_HPP_
 #define BYTESTEADY_FIELD_FORMAT_HPP_
 
+#include <cstddef>
+#include <variant>
+
 namespace bytesteady {
 
 enum FieldFormat {
@@ -21,6 +24,22 @@ enum FieldFormat {
   kBytes = 1,
 };
 
+// Empty field i of input as an array of type A and return it. The field keeps
+// its capacity if it already holds an A, so that filling a sample array that
+// is reused across calls makes no allocation once the fields are large enough.
+template < typename A, typename F >
+A *resetField(F *input, ::std::size_t i) {
+  if (input->size() <= i) {
+    input->resize(i + 1);
+  }
+  A *field = ::std::get_if< A >(&(*input)[i]);
+  if (field == nullptr) {
+    field = &(*input)[i].template emplace< A >();
+  }
+  field->clear();
+  return field;
 }
 
+}  // namespace bytesteady
+
 #endif  // BYTESTEADY_FIELD_FORMAT_HPP_
@@ -19,6 +19,21 @@ DEFINE_string(data_file, "bytesteady/unittest_train.txt",
               "data input file name");
 DEFINE_string(data_format, "kBytes,kIndex", "a comma-separated list of kBytes"
               " or kIndex representing field types");
+DEFINE_uint64(data_shard_size, 1, "number of shards to split the data file"
+              " into for parallel reading by training and testing threads");
+DEFINE_string(data_binary_file, "bytesteady/unittest_train.bin", "output"
+              " file of the convert task in the memory-mapped binary format");
+DEFINE_bool(data_binary_label, true, "whether the data file has labels to"
+            " store in the binary format");
+DEFINE_bool(data_cache, false, "whether to keep parsed samples in memory after"
+            " the first training epoch instead of reading the file again");
+DEFINE_uint64(data_cache_size, 4096, "maximum megabytes of parsed samples to"
+              " keep in memory, beyond which shards are read from the file");
+DEFINE_bool(data_shuffle, false, "whether to shuffle training samples in every"
+            " epoch");
+DEFINE_uint64(data_shuffle_size, 65536, "number of samples read ahead in each"
+              " shard of a text file to draw shuffled samples from");
+DEFINE_uint64(data_shuffle_seed, 1946, "seed of the order of shuffled samples");
 
 DEFINE_string(model_input_size, "16,16", "a comma-seperated list of numbers"
               " representing input embedding size");
@@ -30,6 +45,17 @@ DEFINE_double(model_mu, 0.0, "mean of the Gaussian distribution used to"
               " initialize parameters");
 DEFINE_double(model_sigma, 1.0, "standard deviation of the Gaussian"
                " distribution used to initialize parameters");
+DEFINE_bool(model_coalesce, false, "whether to merge duplicated activated"
+            " embeddings of a sample before forward and update");
+DEFINE_uint64(model_thread_size, 1, "number of threads to initialize"
+              " parameters");
+DEFINE_string(model_page, "default", "pages of input embeddings, either"
+              " default, huge for transparent huge pages or hugetlb for"
+              " explicit huge pages");
+DEFINE_string(model_policy, "default", "NUMA policy of input embeddings and"
+              " training threads, either default, interleave over all nodes"
+              " or bind to -model_node");
+DEFINE_uint64(model_node, 0, "NUMA node used by the bind policy");
 
 DEFINE_double(train_a, 0.1, "initial learning rate");
 DEFINE_double(train_b, 0.0, "eventual learning rate");
@@ -38,6 +64,13 @@ DEFINE_double(train_lambda, 0.0, "weight decay");
 DEFINE_uint64(train_n, 0, "number of universum samples for every data sample");
 DEFINE_double(train_rho, 1.0, "universum learning rate factor");
 DEFINE_uint64(train_thread_size, 4, "number of threads for training");
+DEFINE_uint64(train_batch_size, 1, "number of samples each training thread"
+              " accumulates before updating the model");
+DEFINE_uint64(train_prefetch_size, 0, "number of samples read ahead for"
+              " training by reader threads, or 0 to read in training"
+              " threads");
+DEFINE_uint64(train_reader_size, 1, "number of reader threads when samples"
+              " are read ahead");
 
 DEFINE_uint64(test_label_size, 3, "size of label to consider during"
               " testing");
@@ -47,6 +80,37 @@ DEFINE_string(infer_file, "bytesteady/unittest_result.txt",
               "inference result file");
 DEFINE_uint64(infer_label_size, 3, "size of label to consider during"
               " inference");
+DEFINE_uint64(infer_thread_size, 1, "number of threads for inference");
+DEFINE_uint64(infer_top_size, 1, "number of top labels to write for each"
+              " sample during inference");
+DEFINE_string(infer_score, "none", "score to write after each inferred label,"
+              " can be none, raw or probability");
+DEFINE_bool(infer_binary, false, "whether to write inference results in"
+            " binary instead of text");
+
+DEFINE_string(serve_socket, "bytesteady/bytesteady.sock", "Unix domain socket"
+              " to serve requests on, or empty to use the TCP loopback");
+DEFINE_uint64(serve_port, 0, "TCP loopback port to serve requests on if the"
+              " socket is empty, 0 to choose one");
+DEFINE_uint64(serve_thread_size, 4, "number of worker threads for serving");
+DEFINE_uint64(serve_batch_size, 16, "maximum number of queued requests a"
+              " worker takes and scores together");
+
+DEFINE_string(quantize_file, "model_quantized.tdb", "quantized model file"
+              " relative to checkpoint location");
+DEFINE_uint64(quantize_bits, 8, "bits for each quantized value, can be 8 or"
+              " 4");
+DEFINE_string(quantize_tensor, "double", "type of tensor of the trained model"
+              " to quantize, can be double or float");
+
+DEFINE_string(compact_file, "model_compact.tdb", "compacted model file"
+              " relative to checkpoint location");
+DEFINE_uint64(compact_count, 1, "minimum number of times an input embedding"
+              " row is used in the data to be kept, 0 to keep unused rows");
+DEFINE_double(compact_norm, 0.0, "input embedding rows with a norm no"
+              " larger than this are dropped");
+DEFINE_string(compact_tensor, "double", "type of tensor of the trained model"
+              " to compact, can be double or float");
 
 DEFINE_uint64(driver_epoch_size, 1, "number of epoches for training");
 DEFINE_string(driver_location, "", "location to store model checkpoint");
@@ -61,8 +125,14 @@ DEFINE_double(driver_checkpoint_interval, 3600.0,
 DEFINE_string(
     driver_model, "model.tdb",
     "testing or inference model file relative to checkpoint location");
+DEFINE_bool(driver_map, false, "whether to also save models in the"
+            " memory-mapped layout as model_[epoch].bsm");
 
-DEFINE_string(joe_task, "train", "task to run, can be train, test or infer");
-DEFINE_string(joe_tensor, "double", "type of tensor, can be double or float");
-DEFINE_string(joe_hash, "fnv", "type of hash, can be fnv or city");
+DEFINE_string(joe_task, "train", "task to run, can be train, test, infer,"
+              " convert, serve, quantize or compact");
+DEFINE_string(joe_tensor, "double", "type of tensor, can be double, float,"
+              " half for float with bfloat16 input embeddings, quant for"
+              " float with quantized input embeddings or sparse for float"
+              " with compacted input embeddings");
+DEFINE_string(joe_hash, "fnv", "type of hash, can be fnv, city or rolling");
 DEFINE_string(joe_loss, "nll", "type of loss, can be nll or hinge");
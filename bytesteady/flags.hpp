@@ -18,6 +18,14 @@
 
 DECLARE_string(data_file);
 DECLARE_string(data_format);
+DECLARE_uint64(data_shard_size);
+DECLARE_string(data_binary_file);
+DECLARE_bool(data_binary_label);
+DECLARE_bool(data_cache);
+DECLARE_uint64(data_cache_size);
+DECLARE_bool(data_shuffle);
+DECLARE_uint64(data_shuffle_size);
+DECLARE_uint64(data_shuffle_seed);
 
 DECLARE_string(model_input_size);
 DECLARE_uint64(model_output_size);
@@ -26,6 +34,11 @@ DECLARE_string(model_gram);
 DECLARE_uint64(model_seed);
 DECLARE_double(model_mu);
 DECLARE_double(model_sigma);
+DECLARE_bool(model_coalesce);
+DECLARE_uint64(model_thread_size);
+DECLARE_string(model_page);
+DECLARE_string(model_policy);
+DECLARE_uint64(model_node);
 
 DECLARE_double(train_a);
 DECLARE_double(train_b);
@@ -34,12 +47,33 @@ DECLARE_double(train_lambda);
 DECLARE_uint64(train_n);
 DECLARE_double(train_rho);
 DECLARE_uint64(train_thread_size);
+DECLARE_uint64(train_batch_size);
+DECLARE_uint64(train_prefetch_size);
+DECLARE_uint64(train_reader_size);
 
 DECLARE_uint64(test_label_size);
 DECLARE_uint64(test_thread_size);
 
 DECLARE_string(infer_file);
 DECLARE_uint64(infer_label_size);
+DECLARE_uint64(infer_thread_size);
+DECLARE_uint64(infer_top_size);
+DECLARE_string(infer_score);
+DECLARE_bool(infer_binary);
+
+DECLARE_string(serve_socket);
+DECLARE_uint64(serve_port);
+DECLARE_uint64(serve_thread_size);
+DECLARE_uint64(serve_batch_size);
+
+DECLARE_string(quantize_file);
+DECLARE_uint64(quantize_bits);
+DECLARE_string(quantize_tensor);
+
+DECLARE_string(compact_file);
+DECLARE_uint64(compact_count);
+DECLARE_double(compact_norm);
+DECLARE_string(compact_tensor);
 
 DECLARE_uint64(driver_epoch_size);
 DECLARE_string(driver_location);
@@ -50,6 +84,7 @@ DECLARE_double(driver_log_interval);
 DECLARE_int64(driver_log_precision);
 DECLARE_double(driver_checkpoint_interval);
 DECLARE_string(driver_model);
+DECLARE_bool(driver_map);
 
 DECLARE_string(joe_task);
 DECLARE_string(joe_tensor);
@@ -30,4 +30,13 @@ uint64_t FNVHash::hash64(const uint8_t *s, uint64_t len, uint64_t seed) {
   return hash;
 }
 
+void FNVHash::reset(const uint8_t *s, uint64_t len, uint64_t seed) {
+  data_ = s;
+  seed_ = seed;
+}
+
+uint64_t FNVHash::gram64(uint64_t pos, uint64_t len) const {
+  return hash64(data_ + pos, len, seed_);
+}
+
 }  // namespace bytesteady
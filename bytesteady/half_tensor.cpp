@@ -0,0 +1,217 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/half_tensor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "bytesteady/integer.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/serializer/binary_protocol.hpp"
+#include "thunder/serializer/serializer.hpp"
+#include "thunder/serializer/static.hpp"
+#include "thunder/serializer/text_protocol.hpp"
+#include "thunder/tensor.hpp"
+
+#include "thunder/serializer/binary_protocol-inl.hpp"
+#include "thunder/serializer/serializer-inl.hpp"
+#include "thunder/serializer/static-inl.hpp"
+#include "thunder/serializer/text_protocol-inl.hpp"
+
+namespace bytesteady {
+
+namespace {
+
+HalfTensor::storage_pointer allocate(HalfTensor::size_type n) {
+  HalfTensor::storage_pointer storage(
+      new BFloat16[n == 0 ? 1 : n], ::std::default_delete< BFloat16[] >());
+  ::std::fill(storage.get(), storage.get() + n, BFloat16(0.0f));
+  return storage;
+}
+
+template < typename T >
+void copyRows(const HalfTensor &h, const T &t, HalfTensor::size_type r) {
+  typedef typename T::value_type value_type;
+  HalfTensor::size_type rows = ::std::min(t.size(0), h.size(0) - r);
+  HalfTensor::size_type columns = ::std::min(t.size(1), h.size(1));
+  for (HalfTensor::size_type i = 0; i < rows; ++i) {
+    const value_type *source = t.data() + i * t.stride(0);
+    BFloat16 *target = h.data() + (r + i) * h.stride(0);
+    for (HalfTensor::size_type j = 0; j < columns; ++j) {
+      target[j] = BFloat16(static_cast< float >(source[j * t.stride(1)]));
+    }
+  }
+}
+
+template < typename T >
+void getRows(const HalfTensor &h, const T &t, HalfTensor::size_type r) {
+  typedef typename T::value_type value_type;
+  HalfTensor::size_type rows = ::std::min(t.size(0), h.size(0) - r);
+  HalfTensor::size_type columns = ::std::min(t.size(1), h.size(1));
+  for (HalfTensor::size_type i = 0; i < rows; ++i) {
+    const BFloat16 *source = h.data() + (r + i) * h.stride(0);
+    value_type *target = t.data() + i * t.stride(0);
+    for (HalfTensor::size_type j = 0; j < columns; ++j) {
+      target[j * t.stride(1)] = static_cast< float >(source[j]);
+    }
+  }
+}
+
+}  // namespace
+
+HalfTensor::HalfTensor() : rows_(0), columns_(0), storage_(allocate(0)) {}
+
+HalfTensor::HalfTensor(size_type n, size_type m) :
+    rows_(n), columns_(m), storage_(allocate(n * m)) {}
+
+HalfTensor::HalfTensor(const size_storage &sz) :
+    rows_(sz.size() > 0 ? sz[0] : 0), columns_(sz.size() > 1 ? sz[1] : 1),
+    storage_(allocate(rows_ * columns_)) {}
+
+HalfTensor::HalfTensor(const size_storage &sz, const storage_pointer &s) :
+    rows_(sz.size() > 0 ? sz[0] : 0), columns_(sz.size() > 1 ? sz[1] : 1),
+    storage_(s) {}
+
+HalfTensor::size_type HalfTensor::dimension() const {
+  return 2;
+}
+
+HalfTensor::size_storage HalfTensor::size() const {
+  return size_storage{rows_, columns_};
+}
+
+HalfTensor::size_type HalfTensor::size(size_type d) const {
+  return d == 0 ? rows_ : columns_;
+}
+
+HalfTensor::difference_type HalfTensor::stride(size_type d) const {
+  return d == 0 ? columns_ : 1;
+}
+
+BFloat16 *HalfTensor::data() const {
+  return storage_.get();
+}
+
+const HalfTensor::storage_pointer &HalfTensor::storage() const {
+  return storage_;
+}
+
+const HalfTensor &HalfTensor::copy(const HalfTensor &t) const {
+  ::std::copy(t.data(), t.data() + ::std::min(
+      rows_ * columns_, t.size(0) * t.size(1)), data());
+  return *this;
+}
+
+const HalfTensor &HalfTensor::copy(
+    const ::thunder::DoubleTensor &t, size_type r) const {
+  copyRows(*this, t, r);
+  return *this;
+}
+
+const HalfTensor &HalfTensor::copy(
+    const ::thunder::FloatTensor &t, size_type r) const {
+  copyRows(*this, t, r);
+  return *this;
+}
+
+void HalfTensor::get(const ::thunder::DoubleTensor &t, size_type r) const {
+  getRows(*this, t, r);
+}
+
+void HalfTensor::get(const ::thunder::FloatTensor &t, size_type r) const {
+  getRows(*this, t, r);
+}
+
+double HalfTensor::mean() const {
+  double sum = 0.0;
+  for (size_type i = 0; i < rows_ * columns_; ++i) {
+    sum = sum + static_cast< float >(data()[i]);
+  }
+  return rows_ * columns_ == 0 ? 0.0 : sum / (rows_ * columns_);
+}
+
+double HalfTensor::std() const {
+  double mu = mean();
+  double sum = 0.0;
+  for (size_type i = 0; i < rows_ * columns_; ++i) {
+    double value = static_cast< float >(data()[i]);
+    sum = sum + (value - mu) * (value - mu);
+  }
+  return rows_ * columns_ == 0 ? 0.0 : ::std::sqrt(sum / (rows_ * columns_));
+}
+
+double HalfTensor::min() const {
+  double result = ::std::numeric_limits< double >::infinity();
+  for (size_type i = 0; i < rows_ * columns_; ++i) {
+    result = ::std::min(result, static_cast< double >(
+        static_cast< float >(data()[i])));
+  }
+  return result;
+}
+
+double HalfTensor::max() const {
+  double result = -::std::numeric_limits< double >::infinity();
+  for (size_type i = 0; i < rows_ * columns_; ++i) {
+    result = ::std::max(result, static_cast< double >(
+        static_cast< float >(data()[i])));
+  }
+  return result;
+}
+
+}  // namespace bytesteady
+
+namespace thunder {
+namespace serializer {
+
+template < typename S >
+void save(S *s, const ::bytesteady::HalfTensor &t) {
+  typedef ::bytesteady::HalfTensor::size_type size_type;
+  s->save(t.size(0));
+  s->save(t.size(1));
+  for (size_type i = 0; i < t.size(0) * t.size(1); ++i) {
+    s->save(t.data()[i].bits);
+  }
+}
+
+template < typename S >
+void load(S *s, ::bytesteady::HalfTensor *t) {
+  typedef ::bytesteady::HalfTensor::size_type size_type;
+  size_type rows;
+  size_type columns;
+  s->load(&rows);
+  s->load(&columns);
+  *t = ::bytesteady::HalfTensor(rows, columns);
+  for (size_type i = 0; i < rows * columns; ++i) {
+    s->load(&t->data()[i].bits);
+  }
+}
+
+// Template serializer instantiation
+#define BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(S)         \
+  template void save(S *s, const ::bytesteady::HalfTensor &t);  \
+  template void S::save(const ::bytesteady::HalfTensor &t);     \
+  template void load(S *s, ::bytesteady::HalfTensor *t);        \
+  template void S::load(::bytesteady::HalfTensor *t);
+
+BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(StringBinarySerializer);
+BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(FileBinarySerializer);
+BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(StringTextSerializer);
+BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(FileTextSerializer);
+
+#undef BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE
+
+}  // namespace serializer
+}  // namespace thunder
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_HALF_TENSOR_HPP_
+#define BYTESTEADY_HALF_TENSOR_HPP_
+
+#include <cstring>
+#include <memory>
+
+#include "bytesteady/integer.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+
+// Brain floating point number, the upper half of an IEEE single precision
+// number. It has the range of float with 8 bits of precision, so converting
+// from float is a rounding shift and converting to float is exact.
+struct BFloat16 {
+  uint16_t bits;
+
+  BFloat16() = default;
+  // Round to nearest even, keeping NaN a NaN
+  explicit BFloat16(float value) {
+    uint32_t x;
+    ::std::memcpy(&x, &value, sizeof(x));
+    if ((x & 0x7fffffffu) > 0x7f800000u) {
+      bits = static_cast< uint16_t >((x >> 16) | 0x0040u);
+    } else {
+      bits = static_cast< uint16_t >(
+          (x + 0x7fffu + ((x >> 16) & 1u)) >> 16);
+    }
+  }
+  // Round stochastically using 16 random bits, so that the rounded value
+  // equals the float value on average. Updates smaller than half a unit in
+  // the last place then move the value instead of being rounded away.
+  BFloat16(float value, uint16_t noise) {
+    uint32_t x;
+    ::std::memcpy(&x, &value, sizeof(x));
+    if ((x & 0x7fffffffu) > 0x7f800000u) {
+      bits = static_cast< uint16_t >((x >> 16) | 0x0040u);
+    } else {
+      bits = static_cast< uint16_t >((x + noise) >> 16);
+    }
+  }
+  explicit operator float() const {
+    uint32_t x = static_cast< uint32_t >(bits) << 16;
+    float value;
+    ::std::memcpy(&value, &x, sizeof(value));
+    return value;
+  }
+};
+
+/*
+ * Matrix of bfloat16 values used to store input embeddings at half the size
+ * of float. Only storage is in half precision: kernels widen rows to the
+ * value type of the model for accumulation and round the results back. Like
+ * thunder tensors, copies share the same storage and the const methods
+ * modify the values.
+ */
+class HalfTensor {
+ public:
+  typedef BFloat16 value_type;
+  typedef ::std::size_t size_type;
+  typedef ::std::ptrdiff_t difference_type;
+  typedef ::thunder::SizeStorage size_storage;
+  typedef ::std::shared_ptr< BFloat16 > storage_pointer;
+
+  HalfTensor();
+  // Matrix of n rows and m columns, initialized to zero
+  HalfTensor(size_type n, size_type m);
+  explicit HalfTensor(const size_storage &sz);
+  // Matrix viewing existing values that are kept alive by the pointer
+  HalfTensor(const size_storage &sz, const storage_pointer &s);
+
+  size_type dimension() const;
+  size_storage size() const;
+  size_type size(size_type d) const;
+  difference_type stride(size_type d) const;
+  BFloat16 *data() const;
+  const storage_pointer &storage() const;
+
+  // Copy values from a matrix of the same size
+  const HalfTensor &copy(const HalfTensor &t) const;
+  // Round the rows of t into rows starting at r
+  const HalfTensor &copy(const ::thunder::DoubleTensor &t,
+                         size_type r = 0) const;
+  const HalfTensor &copy(const ::thunder::FloatTensor &t,
+                         size_type r = 0) const;
+  // Widen rows starting at r into t
+  void get(const ::thunder::DoubleTensor &t, size_type r = 0) const;
+  void get(const ::thunder::FloatTensor &t, size_type r = 0) const;
+
+  // Statistics for logging, computed in double precision
+  double mean() const;
+  double std() const;
+  double min() const;
+  double max() const;
+
+ private:
+  size_type rows_;
+  size_type columns_;
+  storage_pointer storage_;
+};
+
+}  // namespace bytesteady
+
+namespace thunder {
+namespace serializer {
+
+template < typename S >
+void save(S *s, const ::bytesteady::HalfTensor &t);
+
+template < typename S >
+void load(S *s, ::bytesteady::HalfTensor *t);
+
+// Pre-compiled template serializer instantiation
+#define BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(S)         \
+  extern template void save(                                    \
+      S *s, const ::bytesteady::HalfTensor &t);                 \
+  extern template void S::save(const ::bytesteady::HalfTensor &t); \
+  extern template void load(S *s, ::bytesteady::HalfTensor *t); \
+  extern template void S::load(::bytesteady::HalfTensor *t);
+
+BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(StringBinarySerializer);
+BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(FileBinarySerializer);
+BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(StringTextSerializer);
+BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE(FileTextSerializer);
+
+#undef BYTESTEADY_HALF_TENSOR_INSTANTIATE_SERIALIZE
+
+}  // namespace serializer
+}  // namespace thunder
+
+#endif  // BYTESTEADY_HALF_TENSOR_HPP_
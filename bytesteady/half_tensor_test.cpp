@@ -0,0 +1,132 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/half_tensor.hpp"
+
+#include <cmath>
+#include <limits>
+
+#include "gtest/gtest.h"
+#include "thunder/random.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+namespace {
+
+TEST(HalfTensorTest, bfloat16Test) {
+  // Rounding a rounded value does not change it
+  for (float value : {0.0f, 1.0f, -2.5f, 0.15625f, 65280.0f, 1e-30f}) {
+    EXPECT_EQ(static_cast< float >(BFloat16(value)),
+              static_cast< float >(BFloat16(
+                  static_cast< float >(BFloat16(value)))));
+  }
+  EXPECT_EQ(1.0f, static_cast< float >(BFloat16(1.0f)));
+  EXPECT_EQ(-2.5f, static_cast< float >(BFloat16(-2.5f)));
+  // Ties round to even
+  EXPECT_EQ(1.0f, static_cast< float >(BFloat16(1.0f + 1.0f / 256)));
+  EXPECT_EQ(1.0f + 1.0f / 64,
+            static_cast< float >(BFloat16(1.0f + 3.0f / 256)));
+  // Relative error is at most 2^-8
+  ::thunder::Random< ::thunder::FloatTensor > random;
+  ::thunder::FloatTensor values = random.normal(
+      ::thunder::FloatTensor(1000), 0.0, 100.0);
+  for (::std::size_t i = 0; i < values.size(0); ++i) {
+    float value = values.data()[i];
+    EXPECT_LE(::std::abs(static_cast< float >(BFloat16(value)) - value),
+              ::std::abs(value) / 256);
+  }
+  // Range and special values are kept
+  EXPECT_EQ(::std::numeric_limits< float >::infinity(),
+            static_cast< float >(BFloat16(
+                ::std::numeric_limits< float >::infinity())));
+  EXPECT_TRUE(::std::isnan(static_cast< float >(BFloat16(
+      ::std::numeric_limits< float >::quiet_NaN()))));
+  EXPECT_NEAR(3e38f, static_cast< float >(BFloat16(3e38f)), 3e38f / 256);
+  // Stochastic rounding goes to either neighbour and is exact on average
+  for (float value : {1.0f + 1.0f / 1024, -2.5f - 3.0f / 1024, 1e-30f}) {
+    float lower = static_cast< float >(BFloat16(value, 0));
+    float upper = static_cast< float >(BFloat16(value, 0xffff));
+    double sum = 0.0;
+    for (uint32_t noise = 0; noise <= 0xffff; ++noise) {
+      float rounded = static_cast< float >(
+          BFloat16(value, static_cast< uint16_t >(noise)));
+      EXPECT_TRUE(rounded == lower || rounded == upper);
+      sum = sum + rounded;
+    }
+    EXPECT_FLOAT_EQ(value, static_cast< float >(sum / 65536));
+  }
+}
+
+template < typename T >
+void copyGetTest() {
+  typedef typename T::size_type size_type;
+  ::thunder::Random< T > random;
+
+  T t = random.uniform(T(7, 5), -2.0, 2.0);
+  HalfTensor h(10, 5);
+  EXPECT_EQ(2, h.dimension());
+  EXPECT_EQ(10, h.size(0));
+  EXPECT_EQ(5, h.size(1));
+  EXPECT_EQ(5, h.stride(0));
+  EXPECT_EQ(0.0, h.mean());
+
+  // Copy rows starting at 2 and widen them back
+  h.copy(t, 2);
+  T u(7, 5);
+  u.fill(0.0);
+  h.get(u, 2);
+  for (size_type i = 0; i < 7; ++i) {
+    for (size_type j = 0; j < 5; ++j) {
+      EXPECT_NEAR(t(i, j), u(i, j), ::std::abs(t(i, j)) / 256);
+      EXPECT_EQ(static_cast< float >(BFloat16(static_cast< float >(t(i, j)))),
+                static_cast< float >(h.data()[(i + 2) * 5 + j]));
+    }
+  }
+  // Rows outside the copy are still zero
+  for (size_type j = 0; j < 10; ++j) {
+    EXPECT_EQ(0.0f, static_cast< float >(h.data()[j]));
+  }
+
+  // Copies share storage while copy() duplicates values
+  HalfTensor shared = h;
+  HalfTensor duplicate = HalfTensor(h.size()).copy(h);
+  h.data()[0] = BFloat16(3.0f);
+  EXPECT_EQ(3.0f, static_cast< float >(shared.data()[0]));
+  EXPECT_EQ(0.0f, static_cast< float >(duplicate.data()[0]));
+  EXPECT_EQ(3.0, h.max());
+}
+
+TEST(HalfTensorTest, copyGetTest) {
+  copyGetTest< ::thunder::DoubleTensor >();
+  copyGetTest< ::thunder::FloatTensor >();
+}
+
+TEST(HalfTensorTest, saveLoadTest) {
+  ::thunder::Random< ::thunder::FloatTensor > random;
+  HalfTensor h1(9, 4);
+  h1.copy(random.normal(::thunder::FloatTensor(9, 4), 0.0, 1.0));
+
+  ::thunder::StringBinarySerializer serializer;
+  serializer.save(h1);
+  HalfTensor h2;
+  serializer.load(&h2);
+  ASSERT_EQ(h1.size(0), h2.size(0));
+  ASSERT_EQ(h1.size(1), h2.size(1));
+  for (::std::size_t i = 0; i < 36; ++i) {
+    EXPECT_EQ(h1.data()[i].bits, h2.data()[i].bits);
+  }
+}
+
+}  // namespace
+}  // namespace bytesteady
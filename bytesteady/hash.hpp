@@ -16,5 +16,6 @@
 
 #include "bytesteady/city_hash.hpp"
 #include "bytesteady/fnv_hash.hpp"
+#include "bytesteady/rolling_hash.hpp"
 
 #endif  // BYTESTEADY_HASH_HPP_
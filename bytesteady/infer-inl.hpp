@@ -13,17 +13,25 @@
 
 #include "bytesteady/infer.hpp"
 
-#include <cstdio>
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 
 namespace bytesteady {
 
 template < typename D, typename M, typename L >
 Infer< D, M, L >::Infer(
-    D *d, M *m, L *l, const ::std::string &fn, size_type label_size_val) :
+    D *d, M *m, L *l, const ::std::string &fn, size_type label_size_val,
+    size_type t) :
     data_(d), model_(m), loss_(l), file_(fn), label_size_(label_size_val),
-    size_(m->input_embedding_size()), fp_(nullptr) {}
+    size_(m->input_embedding_size()), thread_size_(t == 0 ? 1 : t),
+    top_size_(1), score_(kNoScore), binary_(false), fp_(nullptr) {}
 
 template < typename D, typename M, typename L >
 bool Infer< D, M, L >::infer(const callback_type &callback) {
@@ -32,29 +40,160 @@ bool Infer< D, M, L >::infer(const callback_type &callback) {
   if (fp_ == nullptr) {
     return false;
   }
+  ::std::setvbuf(fp_, nullptr, _IOFBF, 1 << 20);
+
+  // Results are indexed by the position of samples in data
+  count_ = 0;
+  index_ = data_->count();
+  window_.assign(kWindowSize, ::std::string());
+  ready_.assign(kWindowSize, 0);
+  failed_ = false;
+  threads_.clear();
+  results_.assign(thread_size_, 1);
+  for (size_type i = 0; i < thread_size_; ++i) {
+    threads_.push_back(::std::thread(&Infer::job, this, callback, i));
+  }
+  bool result = true;
+  for (size_type i = 0; i < thread_size_; ++i) {
+    threads_[i].join();
+    result = result && results_[i] != 0;
+  }
+
+  // Close file and check
+  if (::std::fclose(fp_) != 0) {
+    result = false;
+  }
+  fp_ = nullptr;
+
+  return result;
+}
 
-  Local local;
+template < typename D, typename M, typename L >
+void Infer< D, M, L >::job(const callback_type &callback, size_type thread) {
+  Local local{model_->clone(), field_array(), size_tensor(1)};
+  M &model = local.model;
   field_array &data_input = local.data_input;
   size_tensor &data_position = local.data_position;
 
-  count_ = 0;
-  while (data_->getSample(&data_input, nullptr) == true) {
-    const tensor_type &data_output = model_->forward(data_input);
-    data_output.narrow(0, 0, ::std::min(label_size_, data_output.size(0))).max(
-        &data_position);
-    // Write to file and check
-    if (::std::fprintf(fp_, "%lu\n", data_position(0)) <= 0) {
-      return false;
+  size_type data_index;
+  ::std::vector< size_type > labels;
+  ::std::string result;
+  while (data_->getSample(&data_input, nullptr, &data_index) == true) {
+    const tensor_type &data_output = model.forward(data_input);
+    // Format the result before taking the write lock
+    format(data_output, &labels, &result);
+    data_position(0) = labels.size() > 0 ? labels[0] : 0;
+    if (write(data_index, &result) == false) {
+      results_[thread] = 0;
+      return;
     }
-    ++count_;
     callback(local);
   }
+}
 
-  // Close file and check
-  if (::std::fclose(fp_) != 0) {
+template < typename D, typename M, typename L >
+void Infer< D, M, L >::format(
+    const tensor_type &output, ::std::vector< size_type > *labels,
+    ::std::string *result) const {
+  size_type label_size = ::std::min(label_size_, output.size(0));
+  size_type top_size = ::std::min(top_size_, label_size);
+  const value_type *value = output.data();
+  size_type stride = output.stride(0);
+
+  // Partial selection of the top labels, with ties going to smaller labels
+  labels->resize(label_size);
+  for (size_type i = 0; i < label_size; ++i) {
+    (*labels)[i] = i;
+  }
+  ::std::partial_sort(
+      labels->begin(), labels->begin() + top_size, labels->end(),
+      [&](size_type a, size_type b) -> bool {
+        return value[a * stride] > value[b * stride] ||
+            (value[a * stride] == value[b * stride] && a < b);
+      });
+  labels->resize(top_size);
+
+  // Softmax normalizer over all labels within label size
+  double max = top_size > 0 ? value[(*labels)[0] * stride] : 0.0;
+  double sum = 0.0;
+  if (score_ == kProbabilityScore) {
+    for (size_type i = 0; i < label_size; ++i) {
+      sum = sum + ::std::exp(value[i * stride] - max);
+    }
+  }
+  auto scoreOf = [&](size_type label) -> double {
+    double x = value[label * stride];
+    return score_ == kProbabilityScore ? ::std::exp(x - max) / sum : x;
+  };
+
+  result->clear();
+  if (binary_ == true) {
+    auto append = [result](const void *data, size_type n) -> void {
+      result->append(static_cast< const char * >(data), n);
+    };
+    uint64_t count = top_size;
+    append(&count, sizeof(uint64_t));
+    for (size_type label : *labels) {
+      uint64_t binary_label = label;
+      append(&binary_label, sizeof(uint64_t));
+    }
+    if (score_ != kNoScore) {
+      for (size_type label : *labels) {
+        double score = scoreOf(label);
+        append(&score, sizeof(double));
+      }
+    }
+  } else {
+    char buffer[32];
+    for (size_type i = 0; i < top_size; ++i) {
+      if (i > 0) {
+        result->push_back(',');
+      }
+      char *end = ::std::to_chars(
+          buffer, buffer + sizeof(buffer), (*labels)[i]).ptr;
+      result->append(buffer, end - buffer);
+      if (score_ != kNoScore) {
+        int length = ::std::snprintf(
+            buffer, sizeof(buffer), ":%g", scoreOf((*labels)[i]));
+        result->append(buffer, length);
+      }
+    }
+    result->push_back('\n');
+  }
+}
+
+template < typename D, typename M, typename L >
+bool Infer< D, M, L >::write(size_type index, ::std::string *result) {
+  ::std::unique_lock< ::std::mutex > lock(write_mutex_);
+
+  // Wait until the result fits in the window
+  write_condition_.wait(lock, [&]() -> bool {
+      return failed_ || index - index_ < kWindowSize; });
+  if (failed_ == true) {
     return false;
   }
-  fp_ = nullptr;
+  size_type slot = index % kWindowSize;
+  window_[slot].swap(*result);
+  ready_[slot] = 1;
+
+  // Write results that are next in order
+  bool advanced = false;
+  while (ready_[slot = index_ % kWindowSize] != 0) {
+    const ::std::string &line = window_[slot];
+    // Write to file and check
+    if (::std::fwrite(line.data(), 1, line.size(), fp_) != line.size()) {
+      failed_ = true;
+      write_condition_.notify_all();
+      return false;
+    }
+    ready_[slot] = 0;
+    ++index_;
+    ++count_;
+    advanced = true;
+  }
+  if (advanced == true) {
+    write_condition_.notify_all();
+  }
 
   return true;
 }
@@ -74,4 +213,34 @@ void Infer< D, M, L >::set_label_size(size_type label_size_val) {
   label_size_ = label_size_val;
 }
 
+template < typename D, typename M, typename L >
+typename Infer< D, M, L >::size_type Infer< D, M, L >::top_size() const {
+  return top_size_;
+}
+
+template < typename D, typename M, typename L >
+void Infer< D, M, L >::set_top_size(size_type top_size_val) {
+  top_size_ = top_size_val;
+}
+
+template < typename D, typename M, typename L >
+InferScore Infer< D, M, L >::score() const {
+  return score_;
+}
+
+template < typename D, typename M, typename L >
+void Infer< D, M, L >::set_score(InferScore score_val) {
+  score_ = score_val;
+}
+
+template < typename D, typename M, typename L >
+bool Infer< D, M, L >::binary() const {
+  return binary_;
+}
+
+template < typename D, typename M, typename L >
+void Infer< D, M, L >::set_binary(bool binary_val) {
+  binary_ = binary_val;
+}
+
 }  // namespace bytesteady
@@ -26,9 +26,31 @@ template class Infer< DoubleData, DoubleFNVModel, DoubleNLLLoss >;
 template class Infer< FloatData, FloatFNVModel, FloatNLLLoss >;
 template class Infer< DoubleData, DoubleCityModel, DoubleNLLLoss >;
 template class Infer< FloatData, FloatCityModel, FloatNLLLoss >;
+template class Infer< DoubleData, DoubleRollingModel, DoubleNLLLoss >;
+template class Infer< FloatData, FloatRollingModel, FloatNLLLoss >;
 template class Infer< DoubleData, DoubleFNVModel, DoubleHingeLoss >;
 template class Infer< FloatData, FloatFNVModel, FloatHingeLoss >;
 template class Infer< DoubleData, DoubleCityModel, DoubleHingeLoss >;
 template class Infer< FloatData, FloatCityModel, FloatHingeLoss >;
+template class Infer< DoubleData, DoubleRollingModel, DoubleHingeLoss >;
+template class Infer< FloatData, FloatRollingModel, FloatHingeLoss >;
+template class Infer< FloatData, HalfFNVModel, FloatNLLLoss >;
+template class Infer< FloatData, HalfCityModel, FloatNLLLoss >;
+template class Infer< FloatData, HalfRollingModel, FloatNLLLoss >;
+template class Infer< FloatData, HalfFNVModel, FloatHingeLoss >;
+template class Infer< FloatData, HalfCityModel, FloatHingeLoss >;
+template class Infer< FloatData, HalfRollingModel, FloatHingeLoss >;
+template class Infer< FloatData, QuantFNVModel, FloatNLLLoss >;
+template class Infer< FloatData, QuantCityModel, FloatNLLLoss >;
+template class Infer< FloatData, QuantRollingModel, FloatNLLLoss >;
+template class Infer< FloatData, QuantFNVModel, FloatHingeLoss >;
+template class Infer< FloatData, QuantCityModel, FloatHingeLoss >;
+template class Infer< FloatData, QuantRollingModel, FloatHingeLoss >;
+template class Infer< FloatData, SparseFNVModel, FloatNLLLoss >;
+template class Infer< FloatData, SparseCityModel, FloatNLLLoss >;
+template class Infer< FloatData, SparseRollingModel, FloatNLLLoss >;
+template class Infer< FloatData, SparseFNVModel, FloatHingeLoss >;
+template class Infer< FloatData, SparseCityModel, FloatHingeLoss >;
+template class Infer< FloatData, SparseRollingModel, FloatHingeLoss >;
 
 }  // namespace bytesteady
@@ -14,18 +14,31 @@
 #ifndef BYTESTEADY_INFER_HPP_
 #define BYTESTEADY_INFER_HPP_
 
+#include <condition_variable>
 #include <cstdio>
 #include <functional>
 #include <limits>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "bytesteady/data.hpp"
+#include "bytesteady/integer.hpp"
 #include "bytesteady/loss.hpp"
 #include "bytesteady/model.hpp"
 #include "thunder/tensor.hpp"
 
 namespace bytesteady {
 
+// Score written after each label of inference results
+enum InferScore {
+  kNoScore = 0,
+  kRawScore = 1,
+  kProbabilityScore = 2,
+};
+
 template < typename D = Data<>, typename M = Model<>, typename L = NLLLoss<> >
 class Infer {
  public:
@@ -36,28 +49,52 @@ class Infer {
   typedef typename M::size_storage size_storage;
   typedef typename M::size_type size_type;
   typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
   typedef ::thunder::SizeTensor size_tensor;
 
   struct Local {
+    M model;
     field_array data_input;
     size_tensor data_position;
   };
   typedef Local local_type;
   typedef ::std::function< void (const Local &) > callback_type;
 
+  // Number of results that can wait for those before them. A thread with a
+  // result further ahead blocks until the window catches up.
+  static constexpr size_type kWindowSize = 1024;
+
   Infer(D *d, M *m, L *l, const ::std::string &fn, size_type label_size_val =
-        ::std::numeric_limits< size_type >::max());
+        ::std::numeric_limits< size_type >::max(), size_type t = 1);
 
   /*
-   * Returns false if file cannot be opened or witten to.
+   * Returns false if file cannot be opened or witten to. Samples are read in
+   * order by all threads, forwarded with a model clone for each thread, and
+   * the results are written in the order of the input.
+   *
+   * Each result has the top labels within label size, best first. As text,
+   * it is a line of comma-separated labels, each followed by ":" and the
+   * score unless the score is kNoScore. As binary, it is a 64-bit count,
+   * the 64-bit labels, and then the double scores unless the score is
+   * kNoScore.
    */
   bool infer(const callback_type &callback);
+  void job(const callback_type &callback, size_type thread);
 
   size_type count() const;
 
   size_type label_size() const;
   void set_label_size(size_type label_size_val);
 
+  size_type top_size() const;
+  void set_top_size(size_type top_size_val);
+
+  InferScore score() const;
+  void set_score(InferScore score_val);
+
+  bool binary() const;
+  void set_binary(bool binary_val);
+
  private:
   D *data_;
   M *model_;
@@ -65,21 +102,89 @@ class Infer {
   ::std::string file_;
   size_type label_size_;
   size_storage size_;
+  size_type thread_size_;
+  size_type top_size_;
+  InferScore score_;
+  bool binary_;
 
   size_type count_;
   FILE *fp_;
+
+  // Thread and result container
+  ::std::vector< ::std::thread > threads_;
+  ::std::vector< uint8_t > results_;
+
+  // Select the top labels from output and format them to result
+  void format(const tensor_type &output, ::std::vector< size_type > *labels,
+              ::std::string *result) const;
+
+  // Move the result into the window and write those next in order. The
+  // string given back holds a buffer for the next result.
+  bool write(size_type index, ::std::string *result);
+  ::std::mutex write_mutex_;
+  ::std::condition_variable write_condition_;
+  // Results at their index modulo window size, whether each slot is filled,
+  // the next index to write and whether writing has failed
+  ::std::vector< ::std::string > window_;
+  ::std::vector< uint8_t > ready_;
+  size_type index_;
+  bool failed_;
 };
 
 typedef Infer< DoubleData, DoubleFNVModel, DoubleNLLLoss > DoubleFNVNLLInfer;
 typedef Infer< FloatData, FloatFNVModel, FloatNLLLoss > FloatFNVNLLInfer;
 typedef Infer< DoubleData, DoubleCityModel, DoubleNLLLoss > DoubleCityNLLInfer;
 typedef Infer< FloatData, FloatCityModel, FloatNLLLoss > FloatCityNLLInfer;
+typedef Infer< DoubleData, DoubleRollingModel, DoubleNLLLoss >
+DoubleRollingNLLInfer;
+typedef Infer< FloatData, FloatRollingModel, FloatNLLLoss >
+FloatRollingNLLInfer;
 typedef Infer< DoubleData, DoubleFNVModel, DoubleHingeLoss >
 DoubleFNVHingeInfer;
 typedef Infer< FloatData, FloatFNVModel, FloatHingeLoss > FloatFNVHingeInfer;
 typedef Infer< DoubleData, DoubleCityModel, DoubleHingeLoss >
 DoubleCityHingeInfer;
 typedef Infer< FloatData, FloatCityModel, FloatHingeLoss > FloatCityHingeInfer;
+typedef Infer< DoubleData, DoubleRollingModel, DoubleHingeLoss >
+DoubleRollingHingeInfer;
+typedef Infer< FloatData, FloatRollingModel, FloatHingeLoss >
+FloatRollingHingeInfer;
+typedef Infer< FloatData, HalfFNVModel, FloatNLLLoss >
+HalfFNVNLLInfer;
+typedef Infer< FloatData, HalfCityModel, FloatNLLLoss >
+HalfCityNLLInfer;
+typedef Infer< FloatData, HalfRollingModel, FloatNLLLoss >
+HalfRollingNLLInfer;
+typedef Infer< FloatData, HalfFNVModel, FloatHingeLoss >
+HalfFNVHingeInfer;
+typedef Infer< FloatData, HalfCityModel, FloatHingeLoss >
+HalfCityHingeInfer;
+typedef Infer< FloatData, HalfRollingModel, FloatHingeLoss >
+HalfRollingHingeInfer;
+typedef Infer< FloatData, QuantFNVModel, FloatNLLLoss >
+QuantFNVNLLInfer;
+typedef Infer< FloatData, QuantCityModel, FloatNLLLoss >
+QuantCityNLLInfer;
+typedef Infer< FloatData, QuantRollingModel, FloatNLLLoss >
+QuantRollingNLLInfer;
+typedef Infer< FloatData, QuantFNVModel, FloatHingeLoss >
+QuantFNVHingeInfer;
+typedef Infer< FloatData, QuantCityModel, FloatHingeLoss >
+QuantCityHingeInfer;
+typedef Infer< FloatData, QuantRollingModel, FloatHingeLoss >
+QuantRollingHingeInfer;
+typedef Infer< FloatData, SparseFNVModel, FloatNLLLoss >
+SparseFNVNLLInfer;
+typedef Infer< FloatData, SparseCityModel, FloatNLLLoss >
+SparseCityNLLInfer;
+typedef Infer< FloatData, SparseRollingModel, FloatNLLLoss >
+SparseRollingNLLInfer;
+typedef Infer< FloatData, SparseFNVModel, FloatHingeLoss >
+SparseFNVHingeInfer;
+typedef Infer< FloatData, SparseCityModel, FloatHingeLoss >
+SparseCityHingeInfer;
+typedef Infer< FloatData, SparseRollingModel, FloatHingeLoss >
+SparseRollingHingeInfer;
 
 }  // namespace bytesteady
 
@@ -90,10 +195,33 @@ extern template class Infer< DoubleData, DoubleFNVModel, DoubleNLLLoss >;
 extern template class Infer< FloatData, FloatFNVModel, FloatNLLLoss >;
 extern template class Infer< DoubleData, DoubleCityModel, DoubleNLLLoss >;
 extern template class Infer< FloatData, FloatCityModel, FloatNLLLoss >;
+extern template class Infer< DoubleData, DoubleRollingModel, DoubleNLLLoss >;
+extern template class Infer< FloatData, FloatRollingModel, FloatNLLLoss >;
 extern template class Infer< DoubleData, DoubleFNVModel, DoubleHingeLoss >;
 extern template class Infer< FloatData, FloatFNVModel, FloatHingeLoss >;
 extern template class Infer< DoubleData, DoubleCityModel, DoubleHingeLoss >;
 extern template class Infer< FloatData, FloatCityModel, FloatHingeLoss >;
+extern template class Infer<
+  DoubleData, DoubleRollingModel, DoubleHingeLoss >;
+extern template class Infer< FloatData, FloatRollingModel, FloatHingeLoss >;
+extern template class Infer< FloatData, HalfFNVModel, FloatNLLLoss >;
+extern template class Infer< FloatData, HalfCityModel, FloatNLLLoss >;
+extern template class Infer< FloatData, HalfRollingModel, FloatNLLLoss >;
+extern template class Infer< FloatData, HalfFNVModel, FloatHingeLoss >;
+extern template class Infer< FloatData, HalfCityModel, FloatHingeLoss >;
+extern template class Infer< FloatData, HalfRollingModel, FloatHingeLoss >;
+extern template class Infer< FloatData, QuantFNVModel, FloatNLLLoss >;
+extern template class Infer< FloatData, QuantCityModel, FloatNLLLoss >;
+extern template class Infer< FloatData, QuantRollingModel, FloatNLLLoss >;
+extern template class Infer< FloatData, QuantFNVModel, FloatHingeLoss >;
+extern template class Infer< FloatData, QuantCityModel, FloatHingeLoss >;
+extern template class Infer< FloatData, QuantRollingModel, FloatHingeLoss >;
+extern template class Infer< FloatData, SparseFNVModel, FloatNLLLoss >;
+extern template class Infer< FloatData, SparseCityModel, FloatNLLLoss >;
+extern template class Infer< FloatData, SparseRollingModel, FloatNLLLoss >;
+extern template class Infer< FloatData, SparseFNVModel, FloatHingeLoss >;
+extern template class Infer< FloatData, SparseCityModel, FloatHingeLoss >;
+extern template class Infer< FloatData, SparseRollingModel, FloatHingeLoss >;
 
 }  // namespace bytesteady
 
@@ -13,6 +13,13 @@
 
 #include "bytesteady/infer.hpp"
 
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include "bytesteady/integer.hpp"
 #include "gtest/gtest.h"
 
@@ -94,10 +101,10 @@ void inferTest() {
           }
         }
         // Print model and loss
-        const tensor_array &input_embedding = model.input_embedding();
-        const tensor_type &output_embedding = model.output_embedding();
-        const tensor_type &output = model.output();
-        const tensor_type &feature = model.feature();
+        const tensor_array &input_embedding = local.model.input_embedding();
+        const tensor_type &output_embedding = local.model.output_embedding();
+        const tensor_type &output = local.model.output();
+        const tensor_type &feature = local.model.feature();
         for (size_type i = 0; i < input_embedding.size(); ++i) {
           printf(", input_embedding[%lu] = [%lu, %lu, %.8g, %.8g, %.8g, %.8g]",
                  i, input_embedding[i].size(0), input_embedding[i].size(1),
@@ -118,6 +125,75 @@ void inferTest() {
   EXPECT_TRUE(infer.infer(callback));
   EXPECT_EQ(20, data.count());
   EXPECT_EQ(20, infer.count());
+
+  // Multi-threaded inference writes the same results in the same order
+  ::std::ifstream infer_stream(infer_file);
+  ::std::string result((::std::istreambuf_iterator< char >(infer_stream)),
+                       ::std::istreambuf_iterator< char >());
+  data_type thread_data(data_file, data_format, 3);
+  T thread_infer(&thread_data, &model, &loss, infer_file, label_size, 4);
+  EXPECT_TRUE(thread_infer.infer([](const local_type &local) -> void {}));
+  EXPECT_EQ(20, thread_data.count());
+  EXPECT_EQ(20, thread_infer.count());
+  ::std::ifstream thread_stream(infer_file);
+  ::std::string thread_result(
+      (::std::istreambuf_iterator< char >(thread_stream)),
+      ::std::istreambuf_iterator< char >());
+  EXPECT_EQ(result, thread_result);
+
+  // Top labels with probabilities, best first
+  data.rewind();
+  infer.set_label_size(4);
+  infer.set_top_size(3);
+  infer.set_score(kProbabilityScore);
+  EXPECT_TRUE(infer.infer([](const local_type &local) -> void {}));
+  ::std::ifstream top_stream(infer_file);
+  ::std::string line;
+  size_type count = 0;
+  ::std::vector< size_type > top_labels;
+  while (::std::getline(top_stream, line)) {
+    ::std::istringstream line_stream(line);
+    ::std::string pair;
+    double sum = 0.0;
+    double last = 1.0;
+    size_type size = 0;
+    while (::std::getline(line_stream, pair, ',')) {
+      size_type label = ::std::stoul(pair.substr(0, pair.find(':')));
+      double probability = ::std::stod(pair.substr(pair.find(':') + 1));
+      EXPECT_LT(label, 4);
+      EXPECT_LE(probability, last);
+      if (size == 0) {
+        top_labels.push_back(label);
+      }
+      sum = sum + probability;
+      last = probability;
+      size = size + 1;
+    }
+    EXPECT_EQ(3, size);
+    EXPECT_LT(sum, 1.0 + 1e-5);
+    count = count + 1;
+  }
+  EXPECT_EQ(20, count);
+
+  // Binary results hold the same labels
+  data.rewind();
+  infer.set_binary(true);
+  EXPECT_TRUE(infer.infer([](const local_type &local) -> void {}));
+  FILE *fp = ::std::fopen(infer_file.c_str(), "rb");
+  uint64_t binary_size;
+  uint64_t binary_label[3];
+  double binary_score[3];
+  for (size_type i = 0; i < 20; ++i) {
+    EXPECT_EQ(1, ::std::fread(&binary_size, sizeof(uint64_t), 1, fp));
+    EXPECT_EQ(3, binary_size);
+    EXPECT_EQ(3, ::std::fread(binary_label, sizeof(uint64_t), 3, fp));
+    EXPECT_EQ(3, ::std::fread(binary_score, sizeof(double), 3, fp));
+    EXPECT_EQ(top_labels[i], binary_label[0]);
+    EXPECT_GE(binary_score[0], binary_score[1]);
+    EXPECT_GE(binary_score[1], binary_score[2]);
+  }
+  EXPECT_EQ(EOF, ::std::fgetc(fp));
+  ::std::fclose(fp);
 }
 
 TEST(InferTest, inferTest) {
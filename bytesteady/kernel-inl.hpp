@@ -0,0 +1,447 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/kernel.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTESTEADY_KERNEL_X86
+#endif
+
+namespace bytesteady {
+
+template < typename T >
+Kernel< T >::Kernel(size_type d) :
+    dimension_(d), axpy_(&Kernel::axpyGeneric),
+    widen_axpy_(&Kernel::widenAxpyGeneric),
+    code_axpy_(&Kernel::codeAxpyGeneric),
+    packed_axpy_(&Kernel::packedAxpyGeneric) {
+#ifdef BYTESTEADY_KERNEL_X86
+  // Widening bfloat16 and codes converts to 8 floats at a time, so it only
+  // pays off with float accumulation
+  if (::std::is_same< value_type, float >::value &&
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    switch (d) {
+      case 8:
+        widen_axpy_ = &Kernel::widenAxpyAVX2< 8 >;
+        code_axpy_ = &Kernel::codeAxpyAVX2< 8 >;
+        packed_axpy_ = &Kernel::packedAxpyAVX2< 8 >;
+        break;
+      case 16:
+        widen_axpy_ = &Kernel::widenAxpyAVX2< 16 >;
+        code_axpy_ = &Kernel::codeAxpyAVX2< 16 >;
+        packed_axpy_ = &Kernel::packedAxpyAVX2< 16 >;
+        break;
+      case 32:
+        widen_axpy_ = &Kernel::widenAxpyAVX2< 32 >;
+        code_axpy_ = &Kernel::codeAxpyAVX2< 32 >;
+        packed_axpy_ = &Kernel::packedAxpyAVX2< 32 >;
+        break;
+      case 64:
+        widen_axpy_ = &Kernel::widenAxpyAVX2< 64 >;
+        code_axpy_ = &Kernel::codeAxpyAVX2< 64 >;
+        packed_axpy_ = &Kernel::packedAxpyAVX2< 64 >;
+        break;
+    }
+  }
+#endif  // BYTESTEADY_KERNEL_X86
+  switch (d) {
+    case 8:
+      axpy_ = &Kernel::axpyFixed< 8 >;
+      break;
+    case 16:
+      axpy_ = &Kernel::axpyFixed< 16 >;
+      break;
+    case 32:
+      axpy_ = &Kernel::axpyFixed< 32 >;
+      break;
+    case 64:
+      axpy_ = &Kernel::axpyFixed< 64 >;
+      break;
+    default:
+      return;
+  }
+#ifdef BYTESTEADY_KERNEL_X86
+  // A 512-bit register holds 64 bytes, so it is only useful for long rows
+  if (__builtin_cpu_supports("avx512f") && d * sizeof(value_type) >= 64) {
+    switch (d) {
+      case 8:
+        axpy_ = &Kernel::axpyAVX512< 8 >;
+        break;
+      case 16:
+        axpy_ = &Kernel::axpyAVX512< 16 >;
+        break;
+      case 32:
+        axpy_ = &Kernel::axpyAVX512< 32 >;
+        break;
+      case 64:
+        axpy_ = &Kernel::axpyAVX512< 64 >;
+        break;
+    }
+  } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    switch (d) {
+      case 8:
+        axpy_ = &Kernel::axpyAVX2< 8 >;
+        break;
+      case 16:
+        axpy_ = &Kernel::axpyAVX2< 16 >;
+        break;
+      case 32:
+        axpy_ = &Kernel::axpyAVX2< 32 >;
+        break;
+      case 64:
+        axpy_ = &Kernel::axpyAVX2< 64 >;
+        break;
+    }
+  }
+#endif  // BYTESTEADY_KERNEL_X86
+}
+
+template < typename T >
+void Kernel< T >::axpy(const value_type *x, value_type *y, value_type a) const {
+  axpy_(dimension_, x, y, a);
+}
+
+template < typename T >
+void Kernel< T >::axpy(const BFloat16 *x, value_type *y, value_type a) const {
+  widen_axpy_(dimension_, x, y, a);
+}
+
+template < typename T >
+void Kernel< T >::axpy(const value_type *x, BFloat16 *y, value_type a) const {
+  // Round stochastically, since learning rate times gradient is often below
+  // half a unit in the last place and rounding to nearest would drop it
+  for (size_type i = 0; i < dimension_; ++i) {
+    float value = static_cast< float >(static_cast< float >(y[i]) + a * x[i]);
+    y[i] = BFloat16(value, static_cast< uint16_t >(noise()));
+  }
+}
+
+template < typename T >
+void Kernel< T >::axpy(const int8_t *x, value_type *y, value_type a) const {
+  code_axpy_(dimension_, x, y, a);
+}
+
+template < typename T >
+void Kernel< T >::axpyPacked(
+    const int8_t *x, value_type *y, value_type a) const {
+  packed_axpy_(dimension_, x, y, a);
+}
+
+template < typename T >
+void Kernel< T >::scal(value_type *x, value_type a) const {
+  for (size_type i = 0; i < dimension_; ++i) {
+    x[i] = a * x[i];
+  }
+}
+
+template < typename T >
+void Kernel< T >::scal(BFloat16 *x, value_type a) const {
+  // Weight decay factors close to 1 would also be rounded away
+  for (size_type i = 0; i < dimension_; ++i) {
+    float value = static_cast< float >(a * static_cast< float >(x[i]));
+    x[i] = BFloat16(value, static_cast< uint16_t >(noise()));
+  }
+}
+
+template < typename T >
+void Kernel< T >::axpy(
+    const T &x, size_type r, value_type *y, value_type a) const {
+  axpy(x.data() + r * x.stride(0), y, a);
+}
+
+template < typename T >
+void Kernel< T >::axpy(
+    const HalfTensor &x, size_type r, value_type *y, value_type a) const {
+  axpy(x.data() + r * x.stride(0), y, a);
+}
+
+template < typename T >
+void Kernel< T >::axpy(
+    const QuantTensor &x, size_type r, value_type *y, value_type a) const {
+  if (x.bits() == 4) {
+    axpyPacked(x.codes(r), y, a * *x.scale(r));
+  } else {
+    axpy(x.codes(r), y, a * *x.scale(r));
+  }
+}
+
+template < typename T >
+void Kernel< T >::axpy(
+    const SparseTensor &x, size_type r, value_type *y, value_type a) const {
+  const float *row = x.row(r);
+  if (row == nullptr) {
+    return;
+  }
+  if constexpr (::std::is_same< value_type, float >::value) {
+    axpy(row, y, a);
+  } else {
+    for (size_type i = 0; i < dimension_; ++i) {
+      y[i] = y[i] + a * row[i];
+    }
+  }
+}
+
+template < typename T >
+void Kernel< T >::axpy(
+    const value_type *x, const T &y, size_type r, value_type a) const {
+  axpy(x, y.data() + r * y.stride(0), a);
+}
+
+template < typename T >
+void Kernel< T >::axpy(
+    const value_type *x, const HalfTensor &y, size_type r,
+    value_type a) const {
+  axpy(x, y.data() + r * y.stride(0), a);
+}
+
+template < typename T >
+void Kernel< T >::axpy(
+    const value_type *x, const QuantTensor &y, size_type r,
+    value_type a) const {
+  // Scratch row kept by each thread, since models and predictors share kernels
+  static thread_local ::std::vector< value_type > row;
+  row.resize(dimension_);
+  y.dequantize(r, row.data());
+  axpy(x, row.data(), a);
+  y.quantize(r, row.data());
+}
+
+template < typename T >
+void Kernel< T >::axpy(
+    const value_type *x, const SparseTensor &y, size_type r,
+    value_type a) const {
+  float *row = y.row(r);
+  if (row == nullptr) {
+    return;
+  }
+  if constexpr (::std::is_same< value_type, float >::value) {
+    axpy(x, row, a);
+  } else {
+    for (size_type i = 0; i < dimension_; ++i) {
+      row[i] = static_cast< float >(row[i] + a * x[i]);
+    }
+  }
+}
+
+template < typename T >
+void Kernel< T >::scal(const T &x, size_type r, value_type a) const {
+  scal(x.data() + r * x.stride(0), a);
+}
+
+template < typename T >
+void Kernel< T >::scal(const HalfTensor &x, size_type r, value_type a) const {
+  scal(x.data() + r * x.stride(0), a);
+}
+
+template < typename T >
+void Kernel< T >::scal(const QuantTensor &x, size_type r, value_type a) const {
+  *x.scale(r) = static_cast< float >(a * *x.scale(r));
+}
+
+template < typename T >
+void Kernel< T >::scal(const SparseTensor &x, size_type r, value_type a) const {
+  float *row = x.row(r);
+  if (row == nullptr) {
+    return;
+  }
+  for (size_type i = 0; i < dimension_; ++i) {
+    row[i] = static_cast< float >(a * row[i]);
+  }
+}
+
+template < typename T >
+typename Kernel< T >::size_type Kernel< T >::dimension() const {
+  return dimension_;
+}
+
+template < typename T >
+uint32_t Kernel< T >::noise() {
+  // Xorshift per thread, seeded by the order in which threads first round
+  static ::std::atomic< uint32_t > count(0);
+  thread_local uint32_t state = (count.fetch_add(1) + 1) * 0x9e3779b9u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+template < typename T >
+void Kernel< T >::axpyGeneric(
+    size_type n, const value_type *x, value_type *y, value_type a) {
+  for (size_type i = 0; i < n; ++i) {
+    y[i] = y[i] + a * x[i];
+  }
+}
+
+template < typename T >
+template < typename Kernel< T >::size_type D >
+void Kernel< T >::axpyFixed(
+    size_type, const value_type *x, value_type *y, value_type a) {
+  // Constant trip count lets the compiler unroll and vectorize the loop
+  for (size_type i = 0; i < D; ++i) {
+    y[i] = y[i] + a * x[i];
+  }
+}
+
+template < typename T >
+void Kernel< T >::widenAxpyGeneric(
+    size_type n, const BFloat16 *x, value_type *y, value_type a) {
+  for (size_type i = 0; i < n; ++i) {
+    y[i] = y[i] + a * static_cast< float >(x[i]);
+  }
+}
+
+template < typename T >
+void Kernel< T >::codeAxpyGeneric(
+    size_type n, const int8_t *x, value_type *y, value_type a) {
+  for (size_type i = 0; i < n; ++i) {
+    y[i] = y[i] + a * x[i];
+  }
+}
+
+template < typename T >
+void Kernel< T >::packedAxpyGeneric(
+    size_type n, const int8_t *x, value_type *y, value_type a) {
+  for (size_type i = 0; i < n; ++i) {
+    // Sign-extend the lower or upper nibble
+    int nibble = (static_cast< uint8_t >(x[i / 2]) >> (i % 2 * 4)) & 0x0f;
+    y[i] = y[i] + a * ((nibble ^ 0x08) - 0x08);
+  }
+}
+
+#ifdef BYTESTEADY_KERNEL_X86
+
+template < typename T >
+template < typename Kernel< T >::size_type D >
+__attribute__((target("avx2,fma")))
+void Kernel< T >::axpyAVX2(
+    size_type, const value_type *x, value_type *y, value_type a) {
+  if constexpr (::std::is_same< value_type, float >::value) {
+    static_assert(D % 8 == 0, "dimension must be a multiple of 8");
+    __m256 va = _mm256_set1_ps(a);
+    for (size_type i = 0; i < D; i += 8) {
+      _mm256_storeu_ps(y + i, _mm256_fmadd_ps(
+          va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+  } else if constexpr (::std::is_same< value_type, double >::value) {
+    static_assert(D % 4 == 0, "dimension must be a multiple of 4");
+    __m256d va = _mm256_set1_pd(a);
+    for (size_type i = 0; i < D; i += 4) {
+      _mm256_storeu_pd(y + i, _mm256_fmadd_pd(
+          va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+  } else {
+    axpyFixed< D >(D, x, y, a);
+  }
+}
+
+template < typename T >
+template < typename Kernel< T >::size_type D >
+__attribute__((target("avx512f")))
+void Kernel< T >::axpyAVX512(
+    size_type, const value_type *x, value_type *y, value_type a) {
+  if constexpr (::std::is_same< value_type, float >::value && D % 16 == 0) {
+    __m512 va = _mm512_set1_ps(a);
+    for (size_type i = 0; i < D; i += 16) {
+      _mm512_storeu_ps(y + i, _mm512_fmadd_ps(
+          va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+  } else if constexpr (::std::is_same< value_type, double >::value &&
+                       D % 8 == 0) {
+    __m512d va = _mm512_set1_pd(a);
+    for (size_type i = 0; i < D; i += 8) {
+      _mm512_storeu_pd(y + i, _mm512_fmadd_pd(
+          va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+  } else {
+    axpyFixed< D >(D, x, y, a);
+  }
+}
+
+template < typename T >
+template < typename Kernel< T >::size_type D >
+__attribute__((target("avx2,fma")))
+void Kernel< T >::widenAxpyAVX2(
+    size_type, const BFloat16 *x, value_type *y, value_type a) {
+  if constexpr (::std::is_same< value_type, float >::value) {
+    // Widen 8 values at a time by shifting them into the upper half
+    __m256 va = _mm256_set1_ps(a);
+    for (size_type i = 0; i < D; i += 8) {
+      __m256i vx = _mm256_slli_epi32(_mm256_cvtepu16_epi32(
+          _mm_loadu_si128(reinterpret_cast< const __m128i * >(x + i))), 16);
+      _mm256_storeu_ps(y + i, _mm256_fmadd_ps(
+          va, _mm256_castsi256_ps(vx), _mm256_loadu_ps(y + i)));
+    }
+  } else {
+    widenAxpyGeneric(D, x, y, a);
+  }
+}
+
+template < typename T >
+template < typename Kernel< T >::size_type D >
+__attribute__((target("avx2,fma")))
+void Kernel< T >::codeAxpyAVX2(
+    size_type, const int8_t *x, value_type *y, value_type a) {
+  if constexpr (::std::is_same< value_type, float >::value) {
+    // Sign-extend 8 codes to integers and convert them to float
+    __m256 va = _mm256_set1_ps(a);
+    for (size_type i = 0; i < D; i += 8) {
+      __m256i vx = _mm256_cvtepi8_epi32(
+          _mm_loadl_epi64(reinterpret_cast< const __m128i * >(x + i)));
+      _mm256_storeu_ps(y + i, _mm256_fmadd_ps(
+          va, _mm256_cvtepi32_ps(vx), _mm256_loadu_ps(y + i)));
+    }
+  } else {
+    codeAxpyGeneric(D, x, y, a);
+  }
+}
+
+template < typename T >
+template < typename Kernel< T >::size_type D >
+__attribute__((target("avx2,fma")))
+void Kernel< T >::packedAxpyAVX2(
+    size_type, const int8_t *x, value_type *y, value_type a) {
+  if constexpr (::std::is_same< value_type, float >::value) {
+    // Split 4 bytes into 8 nibbles in order, then sign-extend each nibble by
+    // flipping and subtracting its sign bit
+    __m256 va = _mm256_set1_ps(a);
+    __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i sign = _mm_set1_epi8(0x08);
+    for (size_type i = 0; i < D; i += 8) {
+      int32_t bytes;
+      ::std::memcpy(&bytes, x + i / 2, sizeof(bytes));
+      __m128i vb = _mm_cvtsi32_si128(bytes);
+      __m128i vn = _mm_unpacklo_epi8(
+          _mm_and_si128(vb, mask),
+          _mm_and_si128(_mm_srli_epi16(vb, 4), mask));
+      vn = _mm_sub_epi8(_mm_xor_si128(vn, sign), sign);
+      _mm256_storeu_ps(y + i, _mm256_fmadd_ps(
+          va, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(vn)),
+          _mm256_loadu_ps(y + i)));
+    }
+  } else {
+    packedAxpyGeneric(D, x, y, a);
+  }
+}
+
+#endif  // BYTESTEADY_KERNEL_X86
+
+}  // namespace bytesteady
+
+#undef BYTESTEADY_KERNEL_X86
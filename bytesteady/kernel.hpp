@@ -0,0 +1,140 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_KERNEL_HPP_
+#define BYTESTEADY_KERNEL_HPP_
+
+#include "bytesteady/half_tensor.hpp"
+#include "bytesteady/integer.hpp"
+#include "bytesteady/quant_tensor.hpp"
+#include "bytesteady/sparse_tensor.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+
+// Vector kernels over raw embedding rows of a fixed dimension. Dimensions 8,
+// 16, 32 and 64 use unrolled implementations chosen at construction from the
+// instruction sets supported by the processor (AVX-512, AVX2 with FMA, or
+// plain C++). Other dimensions use a generic loop. Rows stored in bfloat16
+// are widened and quantized rows are dequantized, both accumulating at the
+// value type. Results stored in bfloat16 are rounded stochastically. Rows not
+// retained in a sparse matrix are zero.
+template < typename T = ::thunder::DoubleTensor >
+class Kernel {
+ public:
+  typedef T tensor_type;
+  typedef typename T::value_type value_type;
+  typedef typename T::size_type size_type;
+  typedef void (*axpy_function)(
+      size_type n, const value_type *x, value_type *y, value_type a);
+  typedef void (*widen_axpy_function)(
+      size_type n, const BFloat16 *x, value_type *y, value_type a);
+  typedef void (*code_axpy_function)(
+      size_type n, const int8_t *x, value_type *y, value_type a);
+
+  explicit Kernel(size_type d = 0);
+
+  // y = y + a * x for vectors of the kernel dimension
+  void axpy(const value_type *x, value_type *y, value_type a) const;
+  // y = y + a * x for a bfloat16 vector x
+  void axpy(const BFloat16 *x, value_type *y, value_type a) const;
+  // y = y + a * x for a bfloat16 vector y, rounding the result stochastically
+  void axpy(const value_type *x, BFloat16 *y, value_type a) const;
+  // y = y + a * x for a vector x of 8-bit codes
+  void axpy(const int8_t *x, value_type *y, value_type a) const;
+  // y = y + a * x for a vector x of 4-bit codes packed two to a byte
+  void axpyPacked(const int8_t *x, value_type *y, value_type a) const;
+  // x = a * x
+  void scal(value_type *x, value_type a) const;
+  void scal(BFloat16 *x, value_type a) const;
+
+  // y = y + a * x for row r of an embedding matrix x
+  void axpy(const T &x, size_type r, value_type *y, value_type a) const;
+  void axpy(const HalfTensor &x, size_type r, value_type *y,
+            value_type a) const;
+  void axpy(const QuantTensor &x, size_type r, value_type *y,
+            value_type a) const;
+  void axpy(const SparseTensor &x, size_type r, value_type *y,
+            value_type a) const;
+  // y = y + a * x for row r of an embedding matrix y. Quantized rows are
+  // requantized with a new scale, and rows not retained in a sparse matrix
+  // are left unchanged.
+  void axpy(const value_type *x, const T &y, size_type r, value_type a) const;
+  void axpy(const value_type *x, const HalfTensor &y, size_type r,
+            value_type a) const;
+  void axpy(const value_type *x, const QuantTensor &y, size_type r,
+            value_type a) const;
+  void axpy(const value_type *x, const SparseTensor &y, size_type r,
+            value_type a) const;
+  // x = a * x for row r of an embedding matrix x. Quantized rows only change
+  // their scale.
+  void scal(const T &x, size_type r, value_type a) const;
+  void scal(const HalfTensor &x, size_type r, value_type a) const;
+  void scal(const QuantTensor &x, size_type r, value_type a) const;
+  void scal(const SparseTensor &x, size_type r, value_type a) const;
+
+  size_type dimension() const;
+
+ private:
+  size_type dimension_;
+  axpy_function axpy_;
+  widen_axpy_function widen_axpy_;
+  code_axpy_function code_axpy_;
+  code_axpy_function packed_axpy_;
+
+  // Random bits for stochastic rounding from a generator per thread
+  static uint32_t noise();
+
+  static void axpyGeneric(
+      size_type n, const value_type *x, value_type *y, value_type a);
+  static void widenAxpyGeneric(
+      size_type n, const BFloat16 *x, value_type *y, value_type a);
+  static void codeAxpyGeneric(
+      size_type n, const int8_t *x, value_type *y, value_type a);
+  static void packedAxpyGeneric(
+      size_type n, const int8_t *x, value_type *y, value_type a);
+  template < size_type D >
+  static void axpyFixed(
+      size_type n, const value_type *x, value_type *y, value_type a);
+  template < size_type D >
+  static void axpyAVX2(
+      size_type n, const value_type *x, value_type *y, value_type a);
+  template < size_type D >
+  static void axpyAVX512(
+      size_type n, const value_type *x, value_type *y, value_type a);
+  template < size_type D >
+  static void widenAxpyAVX2(
+      size_type n, const BFloat16 *x, value_type *y, value_type a);
+  template < size_type D >
+  static void codeAxpyAVX2(
+      size_type n, const int8_t *x, value_type *y, value_type a);
+  template < size_type D >
+  static void packedAxpyAVX2(
+      size_type n, const int8_t *x, value_type *y, value_type a);
+};
+
+typedef Kernel< ::thunder::DoubleTensor > DoubleKernel;
+typedef Kernel< ::thunder::FloatTensor > FloatKernel;
+// Already exists: typedef DoubleKernel Kernel;
+
+}  // namespace bytesteady
+
+namespace bytesteady {
+
+// Pre-compiled template class instantiation
+extern template class Kernel< ::thunder::DoubleTensor >;
+extern template class Kernel< ::thunder::FloatTensor >;
+
+}  // namespace bytesteady
+
+#endif  // BYTESTEADY_KERNEL_HPP_
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/kernel.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "thunder/random.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+namespace {
+
+template < typename K >
+void axpyTest() {
+  typedef typename K::size_type size_type;
+  typedef typename K::tensor_type tensor_type;
+  typedef typename K::value_type value_type;
+
+  ::thunder::Random< tensor_type > random;
+  for (size_type d : {1, 3, 8, 16, 24, 32, 64, 100}) {
+    K kernel(d);
+    EXPECT_EQ(d, kernel.dimension());
+    tensor_type x = random.normal(tensor_type(d), 0.0, 1.0);
+    tensor_type y = random.normal(tensor_type(d), 0.0, 1.0);
+    ::std::vector< value_type > expected(d);
+    for (size_type i = 0; i < d; ++i) {
+      expected[i] = y(i) + static_cast< value_type >(0.37) * x(i);
+    }
+    kernel.axpy(x.data(), y.data(), 0.37);
+    for (size_type i = 0; i < d; ++i) {
+      EXPECT_NEAR(expected[i], y(i), 1e-5);
+    }
+  }
+}
+
+TEST(KernelTest, axpyTest) {
+  axpyTest< DoubleKernel >();
+  axpyTest< FloatKernel >();
+}
+
+template < typename K >
+void halfTest() {
+  typedef typename K::size_type size_type;
+  typedef typename K::tensor_type tensor_type;
+  typedef typename K::value_type value_type;
+
+  ::thunder::Random< tensor_type > random;
+  for (size_type d : {1, 3, 8, 16, 24, 32, 64, 100}) {
+    K kernel(d);
+    tensor_type x = random.normal(tensor_type(d), 0.0, 1.0);
+    tensor_type y = random.normal(tensor_type(d), 0.0, 1.0);
+    ::std::vector< BFloat16 > h(d);
+    for (size_type i = 0; i < d; ++i) {
+      h[i] = BFloat16(static_cast< float >(x(i)));
+    }
+
+    // Widened bfloat16 rows accumulate at the value type
+    ::std::vector< value_type > expected(d);
+    for (size_type i = 0; i < d; ++i) {
+      expected[i] = y(i) + static_cast< value_type >(0.37) *
+          static_cast< value_type >(static_cast< float >(h[i]));
+    }
+    kernel.axpy(h.data(), y.data(), 0.37);
+    for (size_type i = 0; i < d; ++i) {
+      EXPECT_NEAR(expected[i], y(i), 1e-5);
+    }
+
+    // Updates to bfloat16 rows are rounded stochastically, to within one
+    // unit in the last place
+    for (size_type i = 0; i < d; ++i) {
+      expected[i] = static_cast< float >(h[i]) +
+          static_cast< value_type >(-0.5) * y(i);
+    }
+    kernel.axpy(y.data(), h.data(), -0.5);
+    for (size_type i = 0; i < d; ++i) {
+      EXPECT_NEAR(expected[i], static_cast< float >(h[i]),
+                  ::std::abs(expected[i]) / 128 + 1e-6);
+    }
+
+    // Scaling both kinds of rows
+    kernel.scal(y.data(), 2.0);
+    kernel.scal(h.data(), 2.0);
+    for (size_type i = 0; i < d; ++i) {
+      EXPECT_NEAR(2 * expected[i], static_cast< float >(h[i]),
+                  ::std::abs(expected[i]) / 64 + 1e-6);
+    }
+  }
+}
+
+TEST(KernelTest, halfTest) {
+  halfTest< DoubleKernel >();
+  halfTest< FloatKernel >();
+}
+
+template < typename K >
+void quantTest() {
+  typedef typename K::size_type size_type;
+  typedef typename K::tensor_type tensor_type;
+  typedef typename K::value_type value_type;
+
+  ::thunder::Random< tensor_type > random;
+  for (size_type d : {1, 3, 8, 16, 24, 32, 64, 100}) {
+    K kernel(d);
+    for (size_type bits : {8, 4}) {
+      tensor_type x = random.normal(tensor_type(2, d), 0.0, 1.0);
+      tensor_type y = random.normal(tensor_type(d), 0.0, 1.0);
+      QuantTensor q(2, d, bits);
+      q.copy(x);
+      ::std::vector< value_type > row(d);
+      q.dequantize(1, row.data());
+
+      // Dequantized rows accumulate at the value type
+      ::std::vector< value_type > expected(d);
+      for (size_type i = 0; i < d; ++i) {
+        expected[i] = y(i) + static_cast< value_type >(0.37) * row[i];
+      }
+      kernel.axpy(q, 1, y.data(), 0.37);
+      for (size_type i = 0; i < d; ++i) {
+        EXPECT_NEAR(expected[i], y(i), 1e-5);
+      }
+
+      // Updates to quantized rows are requantized
+      for (size_type i = 0; i < d; ++i) {
+        expected[i] = row[i] + static_cast< value_type >(-0.5) * y(i);
+      }
+      kernel.axpy(y.data(), q, 1, -0.5);
+      q.dequantize(1, row.data());
+      for (size_type i = 0; i < d; ++i) {
+        EXPECT_NEAR(expected[i], row[i], *q.scale(1) / 2 + 1e-6);
+      }
+
+      // Scaling a quantized row only changes its scale
+      float scale = *q.scale(1);
+      kernel.scal(q, 1, 2.0);
+      EXPECT_FLOAT_EQ(2 * scale, *q.scale(1));
+      ::std::vector< value_type > scaled(d);
+      q.dequantize(1, scaled.data());
+      for (size_type i = 0; i < d; ++i) {
+        EXPECT_NEAR(2 * row[i], scaled[i], 1e-5);
+      }
+    }
+  }
+}
+
+TEST(KernelTest, quantTest) {
+  quantTest< DoubleKernel >();
+  quantTest< FloatKernel >();
+}
+
+}  // namespace
+}  // namespace bytesteady
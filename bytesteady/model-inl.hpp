@@ -13,8 +13,14 @@
 
 #include "bytesteady/model.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "bytesteady/integer.hpp"
 #include "thunder/random.hpp"
@@ -22,56 +28,200 @@
 
 namespace bytesteady{
 
-template < typename T, typename H >
-Model< T, H >::Model(
+template < typename T, typename H, typename E >
+Model< T, H, E >::Model(
     const size_storage &s, size_type c, size_type d, const gram_array &g,
-    uint64_t sd) :
-    input_embedding_(s.size()), output_embedding_(c, d), gram_(g), seed_(sd) {
+    uint64_t sd, const Placement &p) :
+    input_embedding_(s.size()), output_embedding_(c, d), gram_(g), seed_(sd),
+    placement_(p) {
   for (size_type i = 0; i < s.size(); ++i) {
-    input_embedding_[i] = T(s[i], d);
+    input_embedding_[i] = allocate(s[i], d);
   }
+  resetKernel();
+  resetScale();
 }
 
-template < typename T, typename H >
-Model< T, H >::Model(
-    const tensor_array &ie, const T &oe, const gram_array &g, uint64_t sd) :
-    input_embedding_(ie), output_embedding_(oe), gram_(g), seed_(sd) {}
+template < typename T, typename H, typename E >
+Model< T, H, E >::Model(
+    const embedding_array &ie, const T &oe, const gram_array &g,
+    uint64_t sd) :
+    input_embedding_(ie), output_embedding_(oe), gram_(g), seed_(sd) {
+  resetKernel();
+  resetScale();
+}
 
-template < typename T, typename H >
-void Model< T, H >::initialize(value_type mu, value_type sigma) const {
-  ::thunder::Random< T > random;
-  for (const T &e : input_embedding_) {
-    random.normal(e, mu, sigma);
+template < typename T, typename H, typename E >
+void Model< T, H, E >::initialize(
+    value_type mu, value_type sigma, size_type threads) const {
+  // Rows are split into shards of fixed size, and each shard draws from its
+  // own generator seeded by the model seed, field and shard. The values are
+  // then the same for any number of threads.
+  const size_type shard = 16384;
+  ::std::vector< ::std::pair< size_type, size_type > > shards;
+  for (size_type i = 0; i <= input_embedding_.size(); ++i) {
+    size_type rows = i < input_embedding_.size() ?
+        input_embedding_[i].size(0) : output_embedding_.size(0);
+    for (size_type j = 0; j < rows; j += shard) {
+      shards.push_back(::std::make_pair(i, j));
+    }
+  }
+  ::std::atomic< size_type > next(0);
+  auto generate = [&]() {
+    // Rows stored at another type are generated in a buffer for each thread
+    T buffer;
+    for (size_type k = next++; k < shards.size(); k = next++) {
+      size_type i = shards[k].first;
+      size_type j = shards[k].second;
+      ::std::seed_seq sequence{
+        static_cast< uint32_t >(seed_), static_cast< uint32_t >(seed_ >> 32),
+        static_cast< uint32_t >(i), static_cast< uint32_t >(j / shard)};
+      uint32_t shard_seed;
+      sequence.generate(&shard_seed, &shard_seed + 1);
+      // Seeding the generator costs little next to drawing a whole shard
+      ::thunder::Random< T > random(shard_seed);
+      if (i == input_embedding_.size()) {
+        size_type n = ::std::min(shard, output_embedding_.size(0) - j);
+        random.normal(output_embedding_.narrow(0, j, n), mu, sigma);
+        continue;
+      }
+      const E &e = input_embedding_[i];
+      size_type n = ::std::min(shard, e.size(0) - j);
+      if constexpr (::std::is_same< E, T >::value) {
+        random.normal(e.narrow(0, j, n), mu, sigma);
+      } else {
+        // Generate the rows at the value type and round them
+        buffer.resize(n, e.size(1));
+        e.copy(random.normal(buffer, mu, sigma), j);
+      }
+    }
+  };
+  ::std::vector< ::std::thread > workers;
+  for (size_type t = 1; t < threads; ++t) {
+    workers.push_back(::std::thread(generate));
+  }
+  generate();
+  for (::std::thread &worker : workers) {
+    worker.join();
+  }
+  for (const T &scale : input_scale_) {
+    scale.fill(1.0);
+  }
+  output_scale_.fill(1.0);
+  pending_->store(false);
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::normalize() const {
+  if (pending() == false) {
+    return;
+  }
+  for (size_type i = 0; i < input_scale_.size(); ++i) {
+    const T &scale = input_scale_[i];
+    for (size_type j = 0; j < scale.size(0); ++j) {
+      if (scale(j) != 1.0) {
+        kernel_.scal(input_embedding_[i], j, scale(j));
+        scale(j) = 1.0;
+      }
+    }
+  }
+  if (output_scale_(0) != 1.0) {
+    linalg_.scal(output_embedding_, output_scale_(0));
+    output_scale_(0) = 1.0;
   }
-  random.normal(output_embedding_, mu, sigma);
+  pending_->store(false);
+  fold_->store(false);
 }
 
-template < typename T, typename H >
-Model< T, H > Model< T, H >::clone(bool share) const {
+template < typename T, typename H, typename E >
+bool Model< T, H, E >::lazy_decay() const {
+  return lazy_decay_;
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_lazy_decay(bool l) {
+  if (l != lazy_decay_) {
+    normalize();
+    lazy_decay_ = l;
+    resetScale();
+  }
+}
+
+template < typename T, typename H, typename E >
+bool Model< T, H, E >::folding() const {
+  return fold_->load(::std::memory_order_relaxed);
+}
+
+template < typename T, typename H, typename E >
+bool Model< T, H, E >::pending() const {
+  return pending_->load(::std::memory_order_relaxed);
+}
+
+template < typename T, typename H, typename E >
+Model< T, H, E > Model< T, H, E >::clone(bool share) const {
   if (share == true) {
-    return Model(input_embedding_, output_embedding_, gram_, seed_);
+    Model model(input_embedding_, output_embedding_, gram_, seed_);
+    // Share pending weight decay scales together with the parameters
+    model.lazy_decay_ = lazy_decay_;
+    model.input_scale_ = input_scale_;
+    model.output_scale_ = output_scale_;
+    model.fold_ = fold_;
+    model.pending_ = pending_;
+    model.coalesce_ = coalesce_;
+    model.placement_ = placement_;
+    model.placed_ = placed_;
+    return model;
   } else {
+    if (fold_.use_count() == 1) {
+      normalize();
+    }
     Model model(input_embedding_size(), output_embedding_size(), dimension(),
-                gram_, seed_);
+                gram_, seed_, placement_);
     for (size_type i = 0; i < input_embedding_.size(); ++i) {
       model.input_embedding_[i].copy(input_embedding_[i]);
     }
     model.output_embedding_.copy(output_embedding_);
+    // Copy the scales still pending if clones prevented folding them
+    model.set_lazy_decay(lazy_decay_);
+    for (size_type i = 0; i < input_scale_.size(); ++i) {
+      model.input_scale_[i].copy(input_scale_[i]);
+    }
+    model.output_scale_.copy(output_scale_);
+    model.pending_->store(pending());
+    model.coalesce_ = coalesce_;
     return model;
   }
 }
 
-template < typename T, typename H >
-const T &Model< T, H >::forward(const field_array &input) {
+template < typename T, typename H, typename E >
+E Model< T, H, E >::place(const E &e) {
+  if (placement_.page() == kDefaultPage &&
+      placement_.policy() == kDefaultPolicy) {
+    return e;
+  }
+  if constexpr (::std::is_same< E, T >::value ||
+                ::std::is_same< E, HalfTensor >::value) {
+    E placed_embedding = allocate(e.size(0), e.size(1));
+    placed_embedding.copy(e);
+    return placed_embedding;
+  } else {
+    // Quantized and compacted embeddings keep their own storage
+    placed_ = false;
+    return e;
+  }
+}
+
+template < typename T, typename H, typename E >
+typename Model< T, H, E >::size_type Model< T, H, E >::plan(
+    const field_array &input, plan_array *p) {
   const index_array *field_index;
   const byte_array *field_bytes;
-  feature_.resize(output_embedding_.size(1)).zero();
-  // Loop over input fields to update the feature
+  p->clear();
+  // Loop over input fields to collect activated embeddings
   for (size_type i = 0; i < input.size(); ++i) {
     if ((field_index = ::std::get_if< index_array >(&input[i])) != nullptr) {
       // The field is an index array
       for (const index_pair &pair : *field_index) {
-        linalg_.axpy(input_embedding_[i][pair.first], feature_, pair.second);
+        p->push_back(plan_entry{i, pair.first, pair.second});
       }
     } else if ((field_bytes = ::std::get_if< byte_array >(
         &input[i])) != nullptr) {
@@ -83,92 +233,331 @@ const T &Model< T, H >::forward(const field_array &input) {
             field_bytes->size() >= g ? (field_bytes->size() - g + 1) : 0);
       }
       value_type weight = 1.0 / static_cast< value_type >(field_size);
+      hash_.reset(field_bytes->data(), field_bytes->size(), seed_);
       for (const size_type &g : field_gram) {
         for (size_type j = 0; field_bytes->size() >= g &&
                  j < field_bytes->size() - g + 1; ++j) {
-          size_type index = hash_.hash64(&(*field_bytes)[j], g, seed_) %
-              input_embedding_[i].size(0);
-          linalg_.axpy(input_embedding_[i][index], feature_, weight);
+          size_type index = hash_.gram64(j, g) % input_embedding_[i].size(0);
+          p->push_back(plan_entry{i, index, weight});
         }
       }
     }
   }
+  size_type activation = p->size();
+  if (coalesce_ == true && p->size() > 1) {
+    // Sort by field and index so that duplicated rows become adjacent
+    ::std::sort(p->begin(), p->end(),
+                [](const plan_entry &a, const plan_entry &b) {
+                  return a.field < b.field ||
+                      (a.field == b.field && a.index < b.index);
+                });
+    size_type k = 0;
+    for (size_type j = 1; j < p->size(); ++j) {
+      if ((*p)[j].field == (*p)[k].field && (*p)[j].index == (*p)[k].index) {
+        (*p)[k].weight = (*p)[k].weight + (*p)[j].weight;
+      } else {
+        k = k + 1;
+        (*p)[k] = (*p)[j];
+      }
+    }
+    p->resize(k + 1);
+  }
+  return activation;
+}
+
+template < typename T, typename H, typename E >
+const T &Model< T, H, E >::forward(const field_array &input) {
+  plan(input, &plan_);
+  return forward(plan_);
+}
+
+template < typename T, typename H, typename E >
+const T &Model< T, H, E >::forward(const plan_array &p) {
+  // Accumulate the feature from activated embeddings
+  feature_.resize(output_embedding_.size(1)).zero();
+  value_type *feature = feature_.data();
+  if (input_scale_.empty()) {
+    for (const plan_entry &entry : p) {
+      kernel_.axpy(input_embedding_[entry.field], entry.index, feature,
+                   entry.weight);
+    }
+  } else {
+    for (const plan_entry &entry : p) {
+      const T &scale = input_scale_[entry.field];
+      kernel_.axpy(input_embedding_[entry.field], entry.index, feature,
+                   entry.weight * scale(entry.index));
+    }
+  }
   // Update the output
   linalg_.gemv(output_embedding_, feature_,
-               output_.resize(output_embedding_.size(0)).zero());
+               output_.resize(output_embedding_.size(0)).zero(),
+               output_scale_(0));
   return output_;
 }
 
-template < typename T, typename H >
-void Model< T, H >::update(
+template < typename T, typename H, typename E >
+void Model< T, H, E >::update(
     const field_array &input, const T &grad_output, value_type rate,
     value_type decay) {
-  // Calculate grad_feature_ using gemv
-  linalg_.gemv(
-      scratch_.resize(
-          output_embedding_.size(1), output_embedding_.size(0)).copy(
-              output_embedding_.transpose(0, 1)),
-      grad_output, grad_feature_.resize(feature_.size(0)).zero());
-
-  // Loop over input fields to update input_embedding_
-  const index_array *field_index;
-  const byte_array *field_bytes;
-  for (size_type i = 0; i < input.size(); ++i) {
-    if ((field_index = ::std::get_if< index_array >(&input[i])) != nullptr) {
-      // The field is an index array. Apply gradient update using axpy
-      for (const index_pair &pair : *field_index) {
-        linalg_.axpy(grad_feature_, input_embedding_[i][pair.first],
-                     - rate * pair.second);
-        // Apply weight decay only for activated embedding
-        if (decay != 0.0) {
-          linalg_.scal(input_embedding_[i][pair.first],
-                       1.0 - pair.second * decay * rate);
-        }
-      }
-    } else if ((field_bytes = ::std::get_if< byte_array >(
-        &input[i])) != nullptr) {
-      const size_array &field_gram = gram_[i];
-      size_type field_size = 0;
-      for (const size_type &g : field_gram) {
-        field_size = field_size + (
-            field_bytes->size() >= g ? (field_bytes->size() - g + 1) : 0);
+  plan(input, &plan_);
+  update(plan_, grad_output, rate, decay);
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::update(
+    const plan_array &p, const T &grad_output, value_type rate,
+    value_type decay) {
+  // Calculate grad_feature_ as the transposed product of output_embedding_
+  // and grad_output, accumulating one contiguous row per class.
+  grad_feature_.resize(feature_.size(0)).zero();
+  // Pending scales below this request a fold into the parameters
+  const value_type min_scale = 1e-4;
+  value_type output_scale = output_scale_(0);
+  value_type *grad_feature = grad_feature_.data();
+  for (size_type i = 0; i < output_embedding_.size(0); ++i) {
+    kernel_.axpy(output_embedding_.data() + i * output_embedding_.stride(0),
+                 grad_feature, grad_output(i) * output_scale);
+  }
+
+  // Weight decay changes the scales only when it is lazy
+  if (lazy_decay_ == true && decay != 0.0 && pending() == false) {
+    pending_->store(true);
+  }
+
+  // Loop over activated embeddings to update input_embedding_. With lazy
+  // decay, the gradient is divided by the pending scale of the row, and
+  // weight decay only changes the scale instead of multiplying the row.
+  for (const plan_entry &entry : p) {
+    const E &embedding = input_embedding_[entry.field];
+    if (input_scale_.empty()) {
+      // Apply gradient update using axpy
+      kernel_.axpy(grad_feature, embedding, entry.index,
+                   - rate * entry.weight);
+      // Apply weight decay only for activated embedding
+      if (decay != 0.0) {
+        kernel_.scal(embedding, entry.index,
+                     1.0 - entry.weight * decay * rate);
       }
-      value_type weight = 1.0 / static_cast< value_type >(field_size);
-      for (const size_type &g : field_gram) {
-        for (size_type j = 0; field_bytes->size() >= g &&
-                 j < field_bytes->size() - g + 1; ++j) {
-          size_type index = hash_.hash64(&(*field_bytes)[j], g, seed_) %
-              input_embedding_[i].size(0);
-          // Apply gradient update using axpy
-          linalg_.axpy(
-              grad_feature_, input_embedding_[i][index], -weight * rate);
-          // Apply weight decay only for activated embedding
-          if (decay != 0.0) {
-            linalg_.scal(input_embedding_[i][index],
-                         1.0 - weight * decay * rate);
-          }
-        }
+      continue;
+    }
+    const T &scale = input_scale_[entry.field];
+    kernel_.axpy(grad_feature, embedding, entry.index,
+                 - rate * entry.weight / scale(entry.index));
+    if (decay != 0.0) {
+      scale(entry.index) =
+          scale(entry.index) * (1.0 - entry.weight * decay * rate);
+      if (scale(entry.index) < min_scale && folding() == false) {
+        fold_->store(true);
       }
     }
   }
 
   // Apply gradient update for output_embedding_ using ger
   linalg_.ger(
-      grad_output, feature_, output_embedding_, -rate);
+      grad_output, feature_, output_embedding_, -rate / output_scale);
   // Apply weight decay for output_embedding_
-  if (decay != 0.0) {
+  if (decay != 0.0 && lazy_decay_ == false) {
     linalg_.scal(output_embedding_, 1.0 - decay * rate);
+  } else if (decay != 0.0) {
+    output_scale_(0) = output_scale * (1.0 - decay * rate);
+    if (output_scale_(0) < min_scale && folding() == false) {
+      fold_->store(true);
+    }
+  }
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::accumulate(const plan_array &p, const T &grad_output) {
+  // Grow the batch rows by doubling, keeping the accumulated samples
+  if (batch_feature_.dimension() != 2 ||
+      batch_size_ == batch_feature_.size(0) ||
+      batch_grad_output_.size(1) != grad_output.size(0)) {
+    size_type rows = batch_size_ == 0 ? 1 : 2 * batch_size_;
+    T feature(rows, feature_.size(0));
+    T grad_output_rows(rows, grad_output.size(0));
+    if (batch_size_ > 0) {
+      feature.narrow(0, 0, batch_size_).copy(
+          batch_feature_.narrow(0, 0, batch_size_));
+      grad_output_rows.narrow(0, 0, batch_size_).copy(
+          batch_grad_output_.narrow(0, 0, batch_size_));
+    }
+    batch_feature_ = feature;
+    batch_grad_output_ = grad_output_rows;
+  }
+  batch_feature_[batch_size_].copy(feature_);
+  batch_grad_output_[batch_size_].copy(grad_output);
+  for (const plan_entry &entry : p) {
+    batch_plan_.push_back(entry);
+    batch_sample_.push_back(batch_size_);
+  }
+  batch_size_ = batch_size_ + 1;
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::updateBatch(value_type rate, value_type decay) {
+  if (batch_size_ == 0) {
+    return;
+  }
+  const T feature = batch_feature_.narrow(0, 0, batch_size_);
+  const T grad_output = batch_grad_output_.narrow(0, 0, batch_size_);
+  // Calculate gradients of all features as the product of grad_output and
+  // output_embedding_ before the output embedding changes
+  // Pending scales below this request a fold into the parameters
+  const value_type min_scale = 1e-4;
+  value_type output_scale = output_scale_(0);
+  batch_grad_feature_.resize(batch_size_, output_embedding_.size(1));
+  linalg_.gemm(grad_output, output_embedding_, batch_grad_feature_,
+               output_scale);
+
+  // Lazy weight decay of the batch changes the scales below
+  if (lazy_decay_ == true && decay != 0.0 && pending() == false) {
+    pending_->store(true);
+  }
+
+  // Sort plan entries by row, so that gradients from every sample activating
+  // a row are summed and the row is updated once
+  ::std::vector< size_type > order(batch_plan_.size());
+  for (size_type i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  ::std::sort(order.begin(), order.end(),
+              [this](size_type a, size_type b) -> bool {
+                const plan_entry &x = batch_plan_[a];
+                const plan_entry &y = batch_plan_[b];
+                return x.field < y.field ||
+                    (x.field == y.field && x.index < y.index);
+              });
+  batch_grad_row_.resize(output_embedding_.size(1));
+  value_type *grad_row = batch_grad_row_.data();
+  for (size_type i = 0; i < order.size();) {
+    const plan_entry &entry = batch_plan_[order[i]];
+    const E &embedding = input_embedding_[entry.field];
+    batch_grad_row_.zero();
+    value_type row_decay = 1.0;
+    size_type j = i;
+    for (; j < order.size() && batch_plan_[order[j]].field == entry.field &&
+             batch_plan_[order[j]].index == entry.index; ++j) {
+      const plan_entry &sample_entry = batch_plan_[order[j]];
+      kernel_.axpy(batch_grad_feature_.data() +
+                   batch_sample_[order[j]] * batch_grad_feature_.stride(0),
+                   grad_row, sample_entry.weight);
+      row_decay = row_decay * (1.0 - sample_entry.weight * decay * rate);
+    }
+    // Apply the summed gradient and then the weight decay of the row
+    if (input_scale_.empty()) {
+      kernel_.axpy(grad_row, embedding, entry.index, - rate);
+      if (decay != 0.0) {
+        kernel_.scal(embedding, entry.index, row_decay);
+      }
+    } else {
+      const T &scale = input_scale_[entry.field];
+      kernel_.axpy(grad_row, embedding, entry.index,
+                   - rate / scale(entry.index));
+      if (decay != 0.0) {
+        scale(entry.index) = scale(entry.index) * row_decay;
+        if (scale(entry.index) < min_scale && folding() == false) {
+          fold_->store(true);
+        }
+      }
+    }
+    i = j;
+  }
+
+  // Apply gradient update for output_embedding_ using one gemm
+  linalg_.gemm(grad_output.transpose(0, 1), feature, output_embedding_,
+               -rate / output_scale, 1.0);
+  if (decay != 0.0) {
+    value_type batch_decay = 1.0;
+    for (size_type i = 0; i < batch_size_; ++i) {
+      batch_decay = batch_decay * (1.0 - decay * rate);
+    }
+    if (lazy_decay_ == false) {
+      linalg_.scal(output_embedding_, batch_decay);
+    } else {
+      output_scale_(0) = output_scale * batch_decay;
+      if (output_scale_(0) < min_scale && folding() == false) {
+        fold_->store(true);
+      }
+    }
+  }
+  batch_plan_.clear();
+  batch_sample_.clear();
+  batch_size_ = 0;
+}
+
+template < typename T, typename H, typename E >
+typename Model< T, H, E >::size_type Model< T, H, E >::batch_size() const {
+  return batch_size_;
+}
+
+template < typename T, typename H, typename E >
+E Model< T, H, E >::allocate(size_type n, size_type d) {
+  if (placement_.page() == kDefaultPage &&
+      placement_.policy() == kDefaultPolicy) {
+    return E(n, d);
+  }
+  if constexpr (::std::is_same< E, T >::value ||
+                ::std::is_same< E, HalfTensor >::value) {
+    typedef typename E::value_type embedding_value_type;
+    bool placed = false;
+    ::std::shared_ptr< void > memory = placement_.allocate(
+        n * d * sizeof(embedding_value_type), &placed);
+    placed_ = placed_ && placed;
+    embedding_value_type *data =
+        static_cast< embedding_value_type * >(memory.get());
+    if constexpr (::std::is_same< E, T >::value) {
+      typedef typename T::storage_type storage_type;
+      return T(size_storage{n, d}, ::std::make_shared< storage_type >(
+          typename storage_type::shared_pointer(memory, data), n * d));
+    } else {
+      return HalfTensor(size_storage{n, d},
+                        HalfTensor::storage_pointer(memory, data));
+    }
+  } else {
+    placed_ = false;
+    return E(n, d);
+  }
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::resetKernel() {
+  // Kernels work on raw rows, so each row must be contiguous
+  for (E &embedding : input_embedding_) {
+    if (embedding.stride(1) != 1) {
+      embedding = E(embedding.size()).copy(embedding);
+    }
+  }
+  if (output_embedding_.stride(1) != 1) {
+    output_embedding_ = T(output_embedding_.size()).copy(output_embedding_);
+  }
+  kernel_ = kernel_type(output_embedding_.size(1));
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::resetScale() {
+  // Eager decay needs no scale per row, saving the memory and the lookup
+  input_scale_.clear();
+  if (lazy_decay_ == true) {
+    input_scale_.resize(input_embedding_.size());
+    for (size_type i = 0; i < input_embedding_.size(); ++i) {
+      input_scale_[i] = T(input_embedding_[i].size(0));
+      input_scale_[i].fill(1.0);
+    }
   }
+  output_scale_ = T(1);
+  output_scale_.fill(1.0);
+  fold_ = ::std::make_shared< ::std::atomic< bool > >(false);
+  pending_ = ::std::make_shared< ::std::atomic< bool > >(false);
 }
 
-template < typename T, typename H >
-typename Model< T, H >::size_type Model< T, H >::input_size() const {
+template < typename T, typename H, typename E >
+typename Model< T, H, E >::size_type Model< T, H, E >::input_size() const {
   return input_embedding_.size();
 }
 
-template < typename T, typename H >
-typename Model< T, H >::size_storage
-Model< T, H >::input_embedding_size() const {
+template < typename T, typename H, typename E >
+typename Model< T, H, E >::size_storage
+Model< T, H, E >::input_embedding_size() const {
   size_storage s(input_embedding_.size());
   for (size_type i = 0; i < input_embedding_.size(); ++i) {
     s[i] = input_embedding_[i].size(0);
@@ -176,91 +565,129 @@ Model< T, H >::input_embedding_size() const {
   return s;
 }
 
-template < typename T, typename H >
-typename Model< T, H >::size_type Model< T, H >::input_embedding_size(
+template < typename T, typename H, typename E >
+typename Model< T, H, E >::size_type Model< T, H, E >::input_embedding_size(
     size_type ind) const {
   return input_embedding_[ind].size(0);
 }
 
-template < typename T, typename H >
-typename Model< T, H >::size_type
-    Model< T, H >::output_embedding_size() const {
+template < typename T, typename H, typename E >
+typename Model< T, H, E >::size_type
+    Model< T, H, E >::output_embedding_size() const {
   return output_embedding_.size(0);
 }
 
-template < typename T, typename H >
-typename Model< T, H >::size_type Model< T, H >::dimension() const {
+template < typename T, typename H, typename E >
+typename Model< T, H, E >::size_type Model< T, H, E >::dimension() const {
   return output_embedding_.size(1);
 }
 
-template < typename T, typename H >
-const typename Model< T, H >::tensor_array &
-Model< T, H >::input_embedding() const {
+template < typename T, typename H, typename E >
+const typename Model< T, H, E >::embedding_array &
+Model< T, H, E >::input_embedding() const {
+  // Clones sharing the parameters may be updating them
+  if (fold_.use_count() == 1) {
+    normalize();
+  }
   return input_embedding_;
 }
 
-template < typename T, typename H >
-void Model< T, H >::set_input_embedding(const tensor_array &e) {
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_input_embedding(const embedding_array &e) {
+  normalize();
   input_embedding_ = e;
+  resetKernel();
+  resetScale();
 }
 
-template < typename T, typename H >
-const T &Model< T, H >::output_embedding() const {
+template < typename T, typename H, typename E >
+const T &Model< T, H, E >::output_embedding() const {
+  if (fold_.use_count() == 1) {
+    normalize();
+  }
   return output_embedding_;
 }
 
-template < typename T, typename H >
-void Model< T, H >::set_output_embedding(const T &e) {
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_output_embedding(const T &e) {
+  normalize();
   output_embedding_ = e;
+  resetKernel();
+  resetScale();
 }
 
-template < typename T, typename H >
-const typename Model< T, H >::gram_array &Model< T, H >::gram() const {
+template < typename T, typename H, typename E >
+const typename Model< T, H, E >::gram_array &Model< T, H, E >::gram() const {
   return gram_;
 }
 
-template < typename T, typename H >
-void Model< T, H >::set_gram(const gram_array &g) {
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_gram(const gram_array &g) {
   gram_ = g;
 }
 
-template < typename T, typename H >
-uint64_t Model< T, H >::seed() const {
+template < typename T, typename H, typename E >
+uint64_t Model< T, H, E >::seed() const {
   return seed_;
 }
 
-template < typename T, typename H >
-void Model< T, H >::set_seed(uint64_t sd) {
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_seed(uint64_t sd) {
   seed_ = sd;
 }
 
-template < typename T, typename H >
-const T &Model< T, H >::feature() const {
+template < typename T, typename H, typename E >
+bool Model< T, H, E >::coalesce() const {
+  return coalesce_;
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_coalesce(bool c) {
+  coalesce_ = c;
+}
+
+template < typename T, typename H, typename E >
+const Placement &Model< T, H, E >::placement() const {
+  return placement_;
+}
+
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_placement(const Placement &p) {
+  placement_ = p;
+}
+
+template < typename T, typename H, typename E >
+bool Model< T, H, E >::placed() const {
+  return placed_;
+}
+
+template < typename T, typename H, typename E >
+const T &Model< T, H, E >::feature() const {
   return feature_;
 }
 
-template < typename T, typename H >
-void Model< T, H >::set_feature(const T &e) {
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_feature(const T &e) {
   feature_ = e;
 }
 
-template < typename T, typename H >
-const T &Model< T, H >::grad_feature() const {
+template < typename T, typename H, typename E >
+const T &Model< T, H, E >::grad_feature() const {
   return grad_feature_;
 }
 
-template < typename T, typename H >
-void Model< T, H >::set_grad_feature(const T &e) {
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_grad_feature(const T &e) {
   grad_feature_ = e;
 }
 
-template < typename T, typename H >
-const T &Model< T, H >::output() const {
+template < typename T, typename H, typename E >
+const T &Model< T, H, E >::output() const {
   return output_;
 }
 
-template < typename T, typename H >
-void Model< T, H >::set_output(const T &e) {
+template < typename T, typename H, typename E >
+void Model< T, H, E >::set_output(const T &e) {
   output_ = e;
 }
 
@@ -270,14 +697,15 @@ void Model< T, H >::set_output(const T &e) {
 namespace thunder {
 namespace serializer {
 
-template < typename S, typename T, typename H >
-void save(S *s, const ::bytesteady::Model< T, H > &m) {
-  typedef typename ::bytesteady::Model< T, H >::gram_array gram_array;
-  typedef typename ::bytesteady::Model< T, H >::size_array size_array;
-  typedef typename ::bytesteady::Model< T, H >::size_type size_type;
-  typedef typename ::bytesteady::Model< T, H >::tensor_array tensor_array;
+template < typename S, typename T, typename H, typename E >
+void save(S *s, const ::bytesteady::Model< T, H, E > &m) {
+  typedef typename ::bytesteady::Model< T, H, E >::gram_array gram_array;
+  typedef typename ::bytesteady::Model< T, H, E >::size_array size_array;
+  typedef typename ::bytesteady::Model< T, H, E >::size_type size_type;
+  typedef typename ::bytesteady::Model< T, H, E >::embedding_array
+      embedding_array;
   // Save input embedding
-  const tensor_array &input_embedding = m.input_embedding();
+  const embedding_array &input_embedding = m.input_embedding();
   s->save(input_embedding.size());
   for (size_type i = 0; i < input_embedding.size(); ++i) {
     s->save(input_embedding[i]);
@@ -297,18 +725,22 @@ void save(S *s, const ::bytesteady::Model< T, H > &m) {
   s->save(m.seed());
 }
 
-template < typename S, typename T, typename H >
-void load(S *s, bytesteady::Model< T, H > *m) {
-  typedef typename ::bytesteady::Model< T, H >::gram_array gram_array;
-  typedef typename ::bytesteady::Model< T, H >::size_array size_array;
-  typedef typename ::bytesteady::Model< T, H >::size_type size_type;
-  typedef typename ::bytesteady::Model< T, H >::tensor_array tensor_array;
+template < typename S, typename T, typename H, typename E >
+void load(S *s, bytesteady::Model< T, H, E > *m) {
+  typedef typename ::bytesteady::Model< T, H, E >::gram_array gram_array;
+  typedef typename ::bytesteady::Model< T, H, E >::size_array size_array;
+  typedef typename ::bytesteady::Model< T, H, E >::size_type size_type;
+  typedef typename ::bytesteady::Model< T, H, E >::embedding_array
+      embedding_array;
   size_type input_size;
   // Load input embedding
   s->load(&input_size);
-  tensor_array input_embedding(input_size);
+  embedding_array input_embedding(input_size);
   for (size_type i = 0; i < input_size; ++i) {
     s->load(&input_embedding[i]);
+    // Place each field before reading the next, so that one field at most
+    // is held twice
+    input_embedding[i] = m->place(input_embedding[i]);
   }
   m->set_input_embedding(input_embedding);
   // Load output embedding
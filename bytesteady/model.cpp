@@ -35,6 +35,18 @@ template class Model< ::thunder::DoubleTensor, FNVHash >;
 template class Model< ::thunder::FloatTensor, FNVHash >;
 template class Model< ::thunder::DoubleTensor, CityHash >;
 template class Model< ::thunder::FloatTensor, CityHash >;
+template class Model< ::thunder::DoubleTensor, RollingHash >;
+template class Model< ::thunder::FloatTensor, RollingHash >;
+template class Model< ::thunder::FloatTensor, FNVHash, HalfTensor >;
+template class Model< ::thunder::FloatTensor, CityHash, HalfTensor >;
+template class Model< ::thunder::FloatTensor, RollingHash, HalfTensor >;
+template class Model< ::thunder::FloatTensor, FNVHash, QuantTensor >;
+template class Model< ::thunder::FloatTensor, CityHash, QuantTensor >;
+template class Model< ::thunder::FloatTensor, RollingHash, QuantTensor >;
+template class Model< ::thunder::FloatTensor, FNVHash, SparseTensor >;
+template class Model< ::thunder::FloatTensor, CityHash, SparseTensor >;
+template class Model<
+  ::thunder::FloatTensor, RollingHash, SparseTensor >;
 
 }  // namespace bytesteady
 
@@ -42,56 +54,89 @@ namespace thunder {
 namespace serializer {
 
 // Template serializer instantiation
-#define BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(T, H)    \
+#define BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(T, H, E) \
   template void save(                                   \
       StringBinarySerializer *s,                        \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   template void StringBinarySerializer::save(           \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   template void load(                                   \
       StringBinarySerializer *s,                        \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   template void StringBinarySerializer::load(           \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   template void save(                                   \
       FileBinarySerializer *s,                          \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   template void FileBinarySerializer::save(             \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   template void load(                                   \
       FileBinarySerializer *s,                          \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   template void FileBinarySerializer::load(             \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   template void save(                                   \
       StringTextSerializer *s,                          \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   template void StringTextSerializer::save(             \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   template void load(                                   \
       StringTextSerializer *s,                          \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   template void StringTextSerializer::load(             \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   template void save(                                   \
       FileTextSerializer *s,                            \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   template void FileTextSerializer::save(               \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   template void load(                                   \
       FileTextSerializer *s,                            \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   template void FileTextSerializer::load(               \
-      ::bytesteady::Model< T, H > *m);
+      ::bytesteady::Model< T, H, E > *m);
 
 BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
-    ::thunder::DoubleTensor, ::bytesteady::FNVHash);
+    ::thunder::DoubleTensor, ::bytesteady::FNVHash,
+    ::thunder::DoubleTensor);
 BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
-    ::thunder::FloatTensor, ::bytesteady::FNVHash);
+    ::thunder::FloatTensor, ::bytesteady::FNVHash,
+    ::thunder::FloatTensor);
 BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
-    ::thunder::DoubleTensor, ::bytesteady::CityHash);
+    ::thunder::DoubleTensor, ::bytesteady::CityHash,
+    ::thunder::DoubleTensor);
 BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
-    ::thunder::FloatTensor, ::bytesteady::CityHash);
+    ::thunder::FloatTensor, ::bytesteady::CityHash,
+    ::thunder::FloatTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::DoubleTensor, ::bytesteady::RollingHash,
+    ::thunder::DoubleTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::RollingHash,
+    ::thunder::FloatTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::FNVHash, ::bytesteady::HalfTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::CityHash, ::bytesteady::HalfTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::RollingHash,
+    ::bytesteady::HalfTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::FNVHash, ::bytesteady::QuantTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::CityHash, ::bytesteady::QuantTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::RollingHash,
+    ::bytesteady::QuantTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::FNVHash,
+    ::bytesteady::SparseTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::CityHash,
+    ::bytesteady::SparseTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::RollingHash,
+    ::bytesteady::SparseTensor);
 
 #undef BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE
 
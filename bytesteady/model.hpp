@@ -14,22 +14,37 @@
 #ifndef BYTESTEADY_MODEL_HPP_
 #define BYTESTEADY_MODEL_HPP_
 
+#include <atomic>
+#include <memory>
 #include <variant>
 #include <vector>
 
+#include "bytesteady/half_tensor.hpp"
 #include "bytesteady/hash.hpp"
 #include "bytesteady/integer.hpp"
+#include "bytesteady/kernel.hpp"
+#include "bytesteady/placement.hpp"
+#include "bytesteady/quant_tensor.hpp"
+#include "bytesteady/sparse_tensor.hpp"
 #include "thunder/linalg.hpp"
 #include "thunder/serializer.hpp"
 #include "thunder/tensor.hpp"
 
 namespace bytesteady {
 
-template < typename T = ::thunder::DoubleTensor, typename H = FNVHash >
+// T is the tensor type for computation and E is the tensor type storing the
+// input embeddings, which can be HalfTensor to halve memory and bandwidth of
+// float, QuantTensor for models quantized after training, or SparseTensor
+// for models compacted after training. Embedding rows are always accumulated
+// in the value type of T.
+template < typename T = ::thunder::DoubleTensor, typename H = FNVHash,
+           typename E = T >
 class Model {
  public:
   typedef T tensor_type;
+  typedef E embedding_type;
   typedef H hash_type;
+  typedef Kernel< T > kernel_type;
   typedef typename T::size_type size_type;
   typedef typename T::size_storage size_storage;
   typedef typename T::value_type value_type;
@@ -41,26 +56,91 @@ class Model {
   typedef ::std::vector< size_type > size_array;
   typedef ::std::vector< size_array > gram_array;
   typedef ::std::vector< T > tensor_array;
+  typedef ::std::vector< E > embedding_array;
+
+  // An activated embedding row: field, bucket index in the field and weight
+  struct PlanEntry {
+    size_type field;
+    size_type index;
+    value_type weight;
+  };
+  typedef PlanEntry plan_entry;
+  typedef ::std::vector< PlanEntry > plan_array;
 
   // Sizes of the embedding for each field, number of output
-  // classes, and dimension of the embedding
+  // classes, and dimension of the embedding. Input embeddings are allocated
+  // by the placement and left untouched, so that initialize() is the first
+  // to write their pages.
   Model(const size_storage &s, size_type c, size_type d,
-        const gram_array &g = {{1,2,3,4}}, uint64_t sd = 1946);
+        const gram_array &g = {{1,2,3,4}}, uint64_t sd = 1946,
+        const Placement &p = Placement());
   // Construct from input embedding and output embedding
-  Model(const tensor_array &ie, const T &oe, const gram_array &g = {{1,2,3,4}},
-        uint64_t sd = 1946);
+  Model(const embedding_array &ie, const T &oe,
+        const gram_array &g = {{1,2,3,4}}, uint64_t sd = 1946);
 
-  // Initialize all embedding with given mean and std
-  void initialize(value_type mu = 0.0, value_type sigma = 1.0) const;
+  // Initialize all embedding with given mean and std using threads. The
+  // values only depend on the seed, not on the number of threads.
+  void initialize(value_type mu = 0.0, value_type sigma = 1.0,
+                  size_type threads = 1) const;
+
+  // Apply pending weight decay to the embeddings. With lazy decay, weight
+  // decay is recorded as scale factors per input embedding row and for the
+  // output embedding, and only multiplied into the parameters here. It must
+  // not run while clones sharing the parameters are updating them. The
+  // embedding accessors and clone(false) call it unless such clones exist.
+  // It returns at once unless some update decayed a scale since the last
+  // call, so that reading the embeddings does not pass over every scale.
+  void normalize() const;
+
+  // Whether weight decay is lazy. Otherwise update() multiplies the decay
+  // into the activated rows and the output embedding at once, and neither
+  // forward() nor update() reads any scale. Models start with eager decay.
+  bool lazy_decay() const;
+  void set_lazy_decay(bool l);
+
+  // Whether some pending scale became small enough to be folded into the
+  // parameters by normalize(). Updates never fold by themselves, since
+  // clones sharing the parameters may be updating the same rows.
+  bool folding() const;
+
+  // Whether some scale may differ from one since the last normalize()
+  bool pending() const;
 
   // Clone the model
   Model clone(bool share = true) const;
 
+  // Input embedding with the values of e in memory allocated by the
+  // placement of the model. Loading places each field as it is read, so that
+  // only one field is held twice. Returns e itself for the default placement
+  // and for quantized or compacted embeddings.
+  E place(const E &e);
+
+  // Compute the embedding rows activated by the input. Plan entries are
+  // appended in the order forward() would visit them, so that the same plan
+  // can be used for both forward() and update() without hashing again. If
+  // coalesce is set, entries are sorted and duplicated rows are merged by
+  // summing their weights. Returns the number of activations before merging.
+  size_type plan(const field_array &input, plan_array *p);
+
   // Forward with a list of indices and weights for each embedding
   const T &forward(const field_array &input);
+  // Forward with a precomputed plan
+  const T &forward(const plan_array &p);
   // Update the parameters using the given indices and weights
   void update(const field_array &input, const T &grad_output,
               value_type rate = 1.0, value_type decay = 0.0);
+  // Update the parameters using the plan given to the last forward()
+  void update(const plan_array &p, const T &grad_output,
+              value_type rate = 1.0, value_type decay = 0.0);
+  // Add the plan given to the last forward() and its output gradient to a
+  // mini-batch. Parameters do not change until updateBatch() is called.
+  void accumulate(const plan_array &p, const T &grad_output);
+  // Update the parameters with the accumulated mini-batch and clear it. The
+  // output embedding gets one gemm instead of a ger per sample, and input
+  // rows activated by several samples sum their gradients to update once.
+  void updateBatch(value_type rate = 1.0, value_type decay = 0.0);
+  // Number of samples accumulated in the mini-batch
+  size_type batch_size() const;
 
   size_type input_size() const;
   size_storage input_embedding_size() const;
@@ -68,8 +148,8 @@ class Model {
   size_type output_embedding_size() const;
   size_type dimension() const;
 
-  const tensor_array &input_embedding() const;
-  void set_input_embedding(const tensor_array &e);
+  const embedding_array &input_embedding() const;
+  void set_input_embedding(const embedding_array &e);
 
   const T &output_embedding() const;
   void set_output_embedding(const T &e);
@@ -80,6 +160,16 @@ class Model {
   uint64_t seed() const;
   void set_seed(uint64_t sd);
 
+  bool coalesce() const;
+  void set_coalesce(bool c);
+
+  // Placement of input embeddings allocated from now on
+  const Placement &placement() const;
+  void set_placement(const Placement &p);
+  // Whether every input embedding allocated by a placement got the pages and
+  // policy requested
+  bool placed() const;
+
   const T &feature() const;
   void set_feature(const T &f);
 
@@ -92,18 +182,47 @@ class Model {
  private:
   H hash_;
   ::thunder::Linalg< T > linalg_;
+  kernel_type kernel_;
 
-  tensor_array input_embedding_;
+  embedding_array input_embedding_;
   T output_embedding_;
+  // Pending weight decay scales for each input embedding row and for the
+  // whole output embedding. Actual parameter equals scale times the stored.
+  // Input scales are only allocated for lazy decay. The fold request and
+  // the pending flag are shared with the clones sharing the scales.
+  bool lazy_decay_ = false;
+  tensor_array input_scale_;
+  T output_scale_;
+  ::std::shared_ptr< ::std::atomic< bool > > fold_;
+  ::std::shared_ptr< ::std::atomic< bool > > pending_;
 
   gram_array gram_;
   uint64_t seed_;
+  bool coalesce_ = false;
+
+  Placement placement_;
+  bool placed_ = true;
 
   T feature_;
   T grad_feature_;
   T output_;
 
-  T scratch_;
+  plan_array plan_;
+
+  // Mini-batch of features and output gradients, one row per sample, and
+  // the plan entries of all samples with the sample each belongs to
+  T batch_feature_;
+  T batch_grad_output_;
+  T batch_grad_feature_;
+  T batch_grad_row_;
+  plan_array batch_plan_;
+  size_array batch_sample_;
+  size_type batch_size_ = 0;
+
+  // Allocate an input embedding of n rows and d columns by the placement
+  E allocate(size_type n, size_type d);
+  void resetKernel();
+  void resetScale();
 };
 
 // Short-hand model class names
@@ -111,6 +230,21 @@ typedef Model< ::thunder::DoubleTensor, FNVHash > DoubleFNVModel;
 typedef Model< ::thunder::FloatTensor, FNVHash > FloatFNVModel;
 typedef Model< ::thunder::DoubleTensor, CityHash > DoubleCityModel;
 typedef Model< ::thunder::FloatTensor, CityHash > FloatCityModel;
+typedef Model< ::thunder::DoubleTensor, RollingHash > DoubleRollingModel;
+typedef Model< ::thunder::FloatTensor, RollingHash > FloatRollingModel;
+typedef Model< ::thunder::FloatTensor, FNVHash, HalfTensor > HalfFNVModel;
+typedef Model< ::thunder::FloatTensor, CityHash, HalfTensor > HalfCityModel;
+typedef Model< ::thunder::FloatTensor, RollingHash, HalfTensor >
+HalfRollingModel;
+typedef Model< ::thunder::FloatTensor, FNVHash, QuantTensor > QuantFNVModel;
+typedef Model< ::thunder::FloatTensor, CityHash, QuantTensor > QuantCityModel;
+typedef Model< ::thunder::FloatTensor, RollingHash, QuantTensor >
+QuantRollingModel;
+typedef Model< ::thunder::FloatTensor, FNVHash, SparseTensor > SparseFNVModel;
+typedef Model< ::thunder::FloatTensor, CityHash, SparseTensor >
+SparseCityModel;
+typedef Model< ::thunder::FloatTensor, RollingHash, SparseTensor >
+SparseRollingModel;
 // Already exists: typedef DoubleFNVModel Model;
 
 }  // namespace bytesteady
@@ -118,11 +252,11 @@ typedef Model< ::thunder::FloatTensor, CityHash > FloatCityModel;
 namespace thunder {
 namespace serializer {
 
-template < typename S, typename T, typename H >
-void save(S *s, const ::bytesteady::Model< T, H > &m);
+template < typename S, typename T, typename H, typename E >
+void save(S *s, const ::bytesteady::Model< T, H, E > &m);
 
-template < typename S, typename T, typename H >
-void load(S *s, bytesteady::Model< T, H > *m);
+template < typename S, typename T, typename H, typename E >
+void load(S *s, bytesteady::Model< T, H, E > *m);
 
 }  // namespace serializer
 }  // namespace thunder
@@ -134,6 +268,18 @@ extern template class Model< ::thunder::DoubleTensor, FNVHash >;
 extern template class Model< ::thunder::FloatTensor, FNVHash >;
 extern template class Model< ::thunder::DoubleTensor, CityHash >;
 extern template class Model< ::thunder::FloatTensor, CityHash >;
+extern template class Model< ::thunder::DoubleTensor, RollingHash >;
+extern template class Model< ::thunder::FloatTensor, RollingHash >;
+extern template class Model< ::thunder::FloatTensor, FNVHash, HalfTensor >;
+extern template class Model< ::thunder::FloatTensor, CityHash, HalfTensor >;
+extern template class Model< ::thunder::FloatTensor, RollingHash, HalfTensor >;
+extern template class Model< ::thunder::FloatTensor, FNVHash, QuantTensor >;
+extern template class Model< ::thunder::FloatTensor, CityHash, QuantTensor >;
+extern template class Model< ::thunder::FloatTensor, RollingHash, QuantTensor >;
+extern template class Model< ::thunder::FloatTensor, FNVHash, SparseTensor >;
+extern template class Model< ::thunder::FloatTensor, CityHash, SparseTensor >;
+extern template class Model<
+  ::thunder::FloatTensor, RollingHash, SparseTensor >;
 
 }  // namespace bytesteady
 
@@ -141,56 +287,89 @@ namespace thunder {
 namespace serializer {
 
 // Pre-compiled template serializer instantiation
-#define BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(T, H)    \
+#define BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(T, H, E) \
   extern template void save(                            \
       StringBinarySerializer *s,                        \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   extern template void StringBinarySerializer::save(    \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   extern template void load(                            \
       StringBinarySerializer *s,                        \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   extern template void StringBinarySerializer::load(    \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   extern template void save(                            \
       FileBinarySerializer *s,                          \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   extern template void FileBinarySerializer::save(      \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   extern template void load(                            \
       FileBinarySerializer *s,                          \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   extern template void FileBinarySerializer::load(      \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   extern template void save(                            \
       StringTextSerializer *s,                          \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   extern template void StringTextSerializer::save(      \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   extern template void load(                            \
       StringTextSerializer *s,                          \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   extern template void StringTextSerializer::load(      \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   extern template void save(                            \
       FileTextSerializer *s,                            \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   extern template void FileTextSerializer::save(        \
-      const ::bytesteady::Model< T, H > &m);            \
+      const ::bytesteady::Model< T, H, E > &m);         \
   extern template void load(                            \
       FileTextSerializer *s,                            \
-      ::bytesteady::Model< T, H > *m);                  \
+      ::bytesteady::Model< T, H, E > *m);               \
   extern template void FileTextSerializer::load(        \
-      ::bytesteady::Model< T, H > *m);
+      ::bytesteady::Model< T, H, E > *m);
 
 BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
-    ::thunder::DoubleTensor, ::bytesteady::FNVHash);
+    ::thunder::DoubleTensor, ::bytesteady::FNVHash,
+    ::thunder::DoubleTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::FNVHash,
+    ::thunder::FloatTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::DoubleTensor, ::bytesteady::CityHash,
+    ::thunder::DoubleTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::CityHash,
+    ::thunder::FloatTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::DoubleTensor, ::bytesteady::RollingHash,
+    ::thunder::DoubleTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::RollingHash,
+    ::thunder::FloatTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::FNVHash, ::bytesteady::HalfTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::CityHash, ::bytesteady::HalfTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::RollingHash,
+    ::bytesteady::HalfTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::FNVHash, ::bytesteady::QuantTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::CityHash, ::bytesteady::QuantTensor);
+BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
+    ::thunder::FloatTensor, ::bytesteady::RollingHash,
+    ::bytesteady::QuantTensor);
 BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
-    ::thunder::FloatTensor, ::bytesteady::FNVHash);
+    ::thunder::FloatTensor, ::bytesteady::FNVHash,
+    ::bytesteady::SparseTensor);
 BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
-    ::thunder::DoubleTensor, ::bytesteady::CityHash);
+    ::thunder::FloatTensor, ::bytesteady::CityHash,
+    ::bytesteady::SparseTensor);
 BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE(
-    ::thunder::FloatTensor, ::bytesteady::CityHash);
+    ::thunder::FloatTensor, ::bytesteady::RollingHash,
+    ::bytesteady::SparseTensor);
 
 #undef BYTESTEADY_MODEL_INSTANTIATE_SERIALIZE
 
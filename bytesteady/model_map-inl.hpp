@@ -0,0 +1,293 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/model_map.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace bytesteady {
+
+template < typename M >
+bool ModelMap< M >::save(const M &m, const ::std::string &file) {
+  const embedding_array &input_embedding = m.input_embedding();
+  const tensor_type &output_embedding = m.output_embedding();
+  const gram_array &gram = m.gram();
+  size_type dimension = m.dimension();
+
+  // Header is padded so that the first blob is aligned
+  size_type bits = 8 * sizeof(embedding_value_type);
+  if constexpr (::std::is_same< embedding_type, QuantTensor >::value) {
+    // Codes of all fields share the same number of bits
+    bits = input_embedding.size() > 0 ? input_embedding[0].bits() : 8;
+    for (const embedding_type &embedding : input_embedding) {
+      if (embedding.bits() != bits) {
+        return false;
+      }
+    }
+  } else if constexpr (::std::is_same< embedding_type, SparseTensor >::value) {
+    bits = bits + kSparse;
+  }
+  ::std::vector< uint64_t > header = {
+    0, sizeof(value_type), bits, input_embedding.size(),
+    output_embedding.size(0), dimension, m.seed(), 0};
+  ::std::memcpy(header.data(), kMagic, sizeof(kMagic));
+  for (const embedding_type &embedding : input_embedding) {
+    header.push_back(embedding.size(0));
+  }
+  header.push_back(gram.size());
+  for (const size_array &field_gram : gram) {
+    header.push_back(field_gram.size());
+    header.insert(header.end(), field_gram.begin(), field_gram.end());
+  }
+  size_type offset = header.size() * sizeof(uint64_t);
+  offset = (offset + kAlignment - 1) / kAlignment * kAlignment;
+  header[7] = offset;
+
+  FILE *fp = ::std::fopen(file.c_str(), "wb");
+  if (fp == nullptr) {
+    return false;
+  }
+  ::std::vector< char > padding(kAlignment, 0);
+  size_type position = header.size() * sizeof(uint64_t);
+  bool success = ::std::fwrite(header.data(), sizeof(uint64_t), header.size(),
+                               fp) == header.size();
+  // Write rows of n values each, given the stride between rows in values
+  auto write = [&](const auto *data, size_type rows, size_type n,
+                   size_type stride) -> void {
+    size_type value_size = sizeof(*data);
+    // Pad to the alignment before each blob
+    size_type pad = (kAlignment - position % kAlignment) % kAlignment;
+    success = success && ::std::fwrite(padding.data(), 1, pad, fp) == pad;
+    position = position + pad;
+    if (stride == n) {
+      success = success && ::std::fwrite(
+          data, value_size, rows * n, fp) == rows * n;
+    } else {
+      for (size_type i = 0; success == true && i < rows; ++i) {
+        success = ::std::fwrite(data + i * stride, value_size, n, fp) == n;
+      }
+    }
+    position = position + rows * n * value_size;
+  };
+  for (const embedding_type &embedding : input_embedding) {
+    if constexpr (::std::is_same< embedding_type, QuantTensor >::value) {
+      // Rows hold their scales next to the codes
+      write(embedding.data(), embedding.size(0), embedding.stride(0),
+            embedding.stride(0));
+    } else if constexpr (::std::is_same< embedding_type,
+                         SparseTensor >::value) {
+      // Retained row count and index precede the retained rows
+      uint64_t retained = embedding.retained();
+      write(&retained, 1, 1, 1);
+      write(embedding.index(), retained, 1, 1);
+      write(embedding.data(), retained, dimension, embedding.stride(0));
+    } else {
+      write(embedding.data(), embedding.size(0), dimension,
+            embedding.stride(0));
+    }
+  }
+  write(output_embedding.data(), output_embedding.size(0), dimension,
+        output_embedding.stride(0));
+  return ::std::fclose(fp) == 0 && success;
+}
+
+template < typename M >
+bool ModelMap< M >::load(const ::std::string &file, M *m) {
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    ::close(fd);
+    return false;
+  }
+  size_type size = static_cast< size_type >(status.st_size);
+  void *address = size > 0 ?
+      ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    return false;
+  }
+  // Tensors keep the mapping alive through aliases of this pointer
+  ::std::shared_ptr< void > mapping(address, [size](void *a) -> void {
+      ::munmap(a, size);});
+  const uint8_t *map = static_cast< const uint8_t * >(address);
+
+  // Read header values with bounds checking
+  size_type position = 0;
+  auto read = [&](uint64_t *value) -> bool {
+    if (size - position < sizeof(uint64_t)) {
+      return false;
+    }
+    ::std::memcpy(value, map + position, sizeof(uint64_t));
+    position = position + sizeof(uint64_t);
+    return true;
+  };
+  // Magic, value size, bits, input size, output size, dimension, seed and
+  // offset
+  uint64_t header[8];
+  for (uint64_t &value : header) {
+    if (read(&value) == false) {
+      return false;
+    }
+  }
+  bool bits_match = header[2] == 8 * sizeof(embedding_value_type);
+  if constexpr (::std::is_same< embedding_type, QuantTensor >::value) {
+    bits_match = header[2] == 8 || header[2] == 4;
+  } else if constexpr (::std::is_same< embedding_type, SparseTensor >::value) {
+    bits_match = header[2] == 8 * sizeof(embedding_value_type) + kSparse;
+  }
+  if (::std::memcmp(header, kMagic, sizeof(kMagic)) != 0 ||
+      header[1] != sizeof(value_type) || bits_match == false ||
+      header[5] == 0 || header[7] % kAlignment != 0 ||
+      header[3] > (size - position) / sizeof(uint64_t)) {
+    return false;
+  }
+  ::std::vector< uint64_t > rows(header[3]);
+  for (uint64_t &field_rows : rows) {
+    if (read(&field_rows) == false) {
+      return false;
+    }
+  }
+  uint64_t gram_size;
+  if (read(&gram_size) == false || gram_size > size) {
+    return false;
+  }
+  gram_array gram(gram_size);
+  for (size_array &field_gram : gram) {
+    uint64_t field_gram_size;
+    if (read(&field_gram_size) == false || field_gram_size > size) {
+      return false;
+    }
+    field_gram.resize(field_gram_size);
+    for (size_type &field_gram_value : field_gram) {
+      uint64_t value;
+      if (read(&value) == false) {
+        return false;
+      }
+      field_gram_value = value;
+    }
+  }
+
+  // Point the tensors into the blobs
+  size_type dimension = header[5];
+  position = header[7];
+  // Point to the next blob of rows with n values each
+  auto blob = [&](size_type rows, size_type n, auto **data) -> bool {
+    typedef typename ::std::remove_reference< decltype(**data) >::type
+        blob_value_type;
+    position = (position + kAlignment - 1) / kAlignment * kAlignment;
+    if (position > size || n == 0 ||
+        rows > (size - position) / sizeof(blob_value_type) / n) {
+      return false;
+    }
+    *data = reinterpret_cast< blob_value_type * >(
+        const_cast< uint8_t * >(map + position));
+    position = position + rows * n * sizeof(blob_value_type);
+    return true;
+  };
+  // Point an input or output embedding into the next blobs
+  auto view = [&](size_type n, auto *embedding) -> bool {
+    typedef typename ::std::remove_pointer< decltype(embedding) >::type
+        view_type;
+    typedef typename view_type::value_type view_value_type;
+    if constexpr (::std::is_same< view_type, QuantTensor >::value) {
+      int8_t *data;
+      if (blob(n, QuantTensor::rowSize(dimension, header[2]), &data) ==
+          false) {
+        return false;
+      }
+      *embedding = QuantTensor(size_storage{n, dimension}, header[2],
+                               QuantTensor::storage_pointer(mapping, data));
+    } else if constexpr (::std::is_same< view_type, SparseTensor >::value) {
+      uint64_t *retained;
+      uint64_t *index;
+      float *data;
+      if (blob(1, 1, &retained) == false || *retained > n ||
+          blob(*retained, 1, &index) == false ||
+          blob(*retained, dimension, &data) == false) {
+        return false;
+      }
+      // Lookups rely on a sorted index of valid rows
+      for (size_type i = 0; i < *retained; ++i) {
+        if (index[i] >= n || (i > 0 && index[i] <= index[i - 1])) {
+          return false;
+        }
+      }
+      *embedding = SparseTensor(size_storage{n, dimension}, *retained,
+                                SparseTensor::index_pointer(mapping, index),
+                                SparseTensor::storage_pointer(mapping, data));
+    } else {
+      view_value_type *data;
+      if (blob(n, dimension, &data) == false) {
+        return false;
+      }
+      if constexpr (::std::is_same< view_type, HalfTensor >::value) {
+        *embedding = HalfTensor(size_storage{n, dimension},
+                                HalfTensor::storage_pointer(mapping, data));
+      } else {
+        ::std::shared_ptr< storage_type > storage =
+            ::std::make_shared< storage_type >(
+                typename storage_type::shared_pointer(mapping, data),
+                n * dimension);
+        *embedding = view_type(size_storage{n, dimension}, storage);
+      }
+    }
+    return true;
+  };
+  embedding_array input_embedding(rows.size());
+  for (size_type i = 0; i < rows.size(); ++i) {
+    if (view(rows[i], &input_embedding[i]) == false) {
+      return false;
+    }
+  }
+  tensor_type output_embedding;
+  if (view(header[4], &output_embedding) == false) {
+    return false;
+  }
+  // Rows are looked up by hash, so read-ahead only wastes memory
+  ::madvise(address, size, MADV_RANDOM);
+
+  // Mapped memory is read-only, so no scale is kept for decaying it
+  m->set_lazy_decay(false);
+  m->set_input_embedding(input_embedding);
+  m->set_output_embedding(output_embedding);
+  m->set_gram(gram);
+  m->set_seed(header[6]);
+  return true;
+}
+
+template < typename M >
+bool ModelMap< M >::check(const ::std::string &file) {
+  FILE *fp = ::std::fopen(file.c_str(), "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  char magic[sizeof(kMagic)];
+  bool result = ::std::fread(magic, 1, sizeof(kMagic), fp) ==
+      sizeof(kMagic) && ::std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  ::std::fclose(fp);
+  return result;
+}
+
+}  // namespace bytesteady
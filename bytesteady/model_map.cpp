@@ -0,0 +1,39 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/model_map.hpp"
+
+#include "bytesteady/model.hpp"
+
+#include "bytesteady/model_map-inl.hpp"
+
+namespace bytesteady {
+
+// Template class instantiation
+template class ModelMap< DoubleFNVModel >;
+template class ModelMap< FloatFNVModel >;
+template class ModelMap< DoubleCityModel >;
+template class ModelMap< FloatCityModel >;
+template class ModelMap< DoubleRollingModel >;
+template class ModelMap< FloatRollingModel >;
+template class ModelMap< HalfFNVModel >;
+template class ModelMap< HalfCityModel >;
+template class ModelMap< HalfRollingModel >;
+template class ModelMap< QuantFNVModel >;
+template class ModelMap< QuantCityModel >;
+template class ModelMap< QuantRollingModel >;
+template class ModelMap< SparseFNVModel >;
+template class ModelMap< SparseCityModel >;
+template class ModelMap< SparseRollingModel >;
+
+}  // namespace bytesteady
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_MODEL_MAP_HPP_
+#define BYTESTEADY_MODEL_MAP_HPP_
+
+#include <string>
+
+#include "bytesteady/integer.hpp"
+#include "bytesteady/model.hpp"
+
+namespace bytesteady {
+
+/*
+ * Model file layout that can be memory-mapped. Embeddings are stored as raw
+ * tensor blobs aligned to 64 bytes, so loading only maps the file read-only
+ * and points the model tensors into the mapping. Processes loading the same
+ * file share one copy in the page cache, and pages are read on demand. The
+ * mapping is released when the last tensor referring to it is destroyed.
+ *
+ * All integers are 64-bit in host byte order:
+ *   header: magic, size of an output embedding value, bits of an input
+ *           embedding value (plus kSparse if compacted), input field count,
+ *           output size, dimension, seed and offset of the first blob,
+ *           then the number of rows of each input embedding, then the gram
+ *           count followed by a size and gram values for each field
+ *   blobs:  each input embedding and then the output embedding as row-major
+ *           values, each starting at a multiple of 64 bytes. A quantized
+ *           input embedding is one blob of rows, each a float scale
+ *           followed by its codes padded to QuantTensor::rowSize(). A
+ *           compacted input embedding is a blob of its retained row count,
+ *           a blob of the sorted retained row numbers and a blob of the
+ *           retained rows.
+ */
+template < typename M = Model<> >
+class ModelMap {
+ public:
+  typedef M model_type;
+  typedef typename M::gram_array gram_array;
+  typedef typename M::size_array size_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::embedding_array embedding_array;
+  typedef typename M::embedding_type embedding_type;
+  typedef typename M::tensor_array tensor_array;
+  typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
+  typedef typename embedding_type::value_type embedding_value_type;
+  typedef typename tensor_type::size_storage size_storage;
+  typedef typename tensor_type::storage_type storage_type;
+
+  static constexpr char kMagic[8] = {'B', 'S', 'T', 'M', 'O', 'D', 'L', '1'};
+  static constexpr size_type kAlignment = 64;
+  // Added to the bits in the header for compacted input embeddings
+  static constexpr uint64_t kSparse = 256;
+
+  // Write the model to file. Returns false on failure.
+  static bool save(const M &m, const ::std::string &file);
+  // Map the file and set the model to use it. Returns false if the file
+  // cannot be mapped or has a different layout or value type.
+  static bool load(const ::std::string &file, M *m);
+  // Whether the file starts with the magic
+  static bool check(const ::std::string &file);
+};
+
+// Short-hand model map class names
+typedef ModelMap< DoubleFNVModel > DoubleFNVModelMap;
+typedef ModelMap< FloatFNVModel > FloatFNVModelMap;
+typedef ModelMap< DoubleCityModel > DoubleCityModelMap;
+typedef ModelMap< FloatCityModel > FloatCityModelMap;
+typedef ModelMap< DoubleRollingModel > DoubleRollingModelMap;
+typedef ModelMap< FloatRollingModel > FloatRollingModelMap;
+typedef ModelMap< HalfFNVModel > HalfFNVModelMap;
+typedef ModelMap< HalfCityModel > HalfCityModelMap;
+typedef ModelMap< HalfRollingModel > HalfRollingModelMap;
+typedef ModelMap< QuantFNVModel > QuantFNVModelMap;
+typedef ModelMap< QuantCityModel > QuantCityModelMap;
+typedef ModelMap< QuantRollingModel > QuantRollingModelMap;
+typedef ModelMap< SparseFNVModel > SparseFNVModelMap;
+typedef ModelMap< SparseCityModel > SparseCityModelMap;
+typedef ModelMap< SparseRollingModel > SparseRollingModelMap;
+// Already exists: typedef DoubleFNVModelMap ModelMap;
+
+}  // namespace bytesteady
+
+namespace bytesteady {
+
+// Pre-compiled template class instantiation
+extern template class ModelMap< DoubleFNVModel >;
+extern template class ModelMap< FloatFNVModel >;
+extern template class ModelMap< DoubleCityModel >;
+extern template class ModelMap< FloatCityModel >;
+extern template class ModelMap< DoubleRollingModel >;
+extern template class ModelMap< FloatRollingModel >;
+extern template class ModelMap< HalfFNVModel >;
+extern template class ModelMap< HalfCityModel >;
+extern template class ModelMap< HalfRollingModel >;
+extern template class ModelMap< QuantFNVModel >;
+extern template class ModelMap< QuantCityModel >;
+extern template class ModelMap< QuantRollingModel >;
+extern template class ModelMap< SparseFNVModel >;
+extern template class ModelMap< SparseCityModel >;
+extern template class ModelMap< SparseRollingModel >;
+
+}  // namespace bytesteady
+
+#endif  // BYTESTEADY_MODEL_MAP_HPP_
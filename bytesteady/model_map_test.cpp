@@ -0,0 +1,204 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/model_map.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "gtest/gtest.h"
+#include "thunder/serializer.hpp"
+
+namespace bytesteady {
+namespace {
+
+template < typename M, typename N >
+void saveLoadTest() {
+  typedef typename M::byte_array byte_array;
+  typedef typename M::embedding_array embedding_array;
+  typedef typename M::embedding_type embedding_type;
+  typedef typename M::field_array field_array;
+  typedef typename M::index_array index_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
+
+  // Create model and decay it so that there are pending scales to apply
+  M model1({16, 33}, 3, 10, {{},{1,2,3,4}}, 1995);
+  model1.initialize(0.0, 1.0);
+  model1.set_lazy_decay(true);
+  field_array input;
+  input.push_back(index_array{
+      ::std::make_pair(size_type(4), value_type(0.6)),
+      ::std::make_pair(size_type(3), value_type(0.88))});
+  input.push_back(byte_array({22, 0, 255, 4, 9, 88, 126, 30}));
+  tensor_type grad_output(3);
+  grad_output.fill(0.5);
+  model1.forward(input);
+  model1.update(input, grad_output, 0.1, 0.01);
+
+  ::std::string file = "bytesteady/unittest_model.bsm";
+  EXPECT_TRUE(ModelMap< M >::save(model1, file));
+  EXPECT_TRUE(ModelMap< M >::check(file));
+
+  M model2({1}, 1, 1);
+  model2.set_lazy_decay(true);
+  EXPECT_TRUE(ModelMap< M >::load(file, &model2));
+  // Mapped models keep no decay scales
+  EXPECT_FALSE(model2.lazy_decay());
+  // Parameters are the same
+  const embedding_array &input_embedding1 = model1.input_embedding();
+  const embedding_array &input_embedding2 = model2.input_embedding();
+  ASSERT_EQ(input_embedding1.size(), input_embedding2.size());
+  for (size_type i = 0; i < input_embedding1.size(); ++i) {
+    ASSERT_EQ(input_embedding1[i].size(0), input_embedding2[i].size(0));
+    ASSERT_EQ(input_embedding1[i].size(1), input_embedding2[i].size(1));
+    // Blobs are aligned in the mapping
+    EXPECT_EQ(0, reinterpret_cast< uintptr_t >(
+        input_embedding2[i].data()) % ModelMap< M >::kAlignment);
+    // Values are compared bitwise to also cover bfloat16 and quantized
+    // embeddings, whose rows include their scales
+    EXPECT_EQ(0, ::std::memcmp(
+        input_embedding1[i].data(), input_embedding2[i].data(),
+        input_embedding1[i].size(0) * input_embedding1[i].stride(0) *
+        sizeof(typename embedding_type::value_type)));
+    if constexpr (::std::is_same< embedding_type, QuantTensor >::value) {
+      EXPECT_EQ(input_embedding1[i].bits(), input_embedding2[i].bits());
+    }
+  }
+  const tensor_type &output_embedding1 = model1.output_embedding();
+  const tensor_type &output_embedding2 = model2.output_embedding();
+  ASSERT_EQ(output_embedding1.size(0), output_embedding2.size(0));
+  ASSERT_EQ(output_embedding1.size(1), output_embedding2.size(1));
+  EXPECT_EQ(0, reinterpret_cast< uintptr_t >(
+      output_embedding2.data()) % ModelMap< M >::kAlignment);
+  for (size_type i = 0; i < output_embedding1.size(0); ++i) {
+    for (size_type j = 0; j < output_embedding1.size(1); ++j) {
+      EXPECT_EQ(output_embedding1(i, j), output_embedding2(i, j));
+    }
+  }
+  EXPECT_EQ(model1.gram(), model2.gram());
+  EXPECT_EQ(model1.seed(), model2.seed());
+
+  // Forward on the mapped model gives the same output
+  const tensor_type &output1 = model1.forward(input);
+  const tensor_type &output2 = model2.forward(input);
+  for (size_type i = 0; i < 3; ++i) {
+    EXPECT_EQ(output1(i), output2(i));
+  }
+
+  // The mapping outlives the file and the model it was loaded into
+  M model3({1}, 1, 1);
+  EXPECT_TRUE(ModelMap< M >::load(file, &model3));
+  ::std::remove(file.c_str());
+  embedding_array input_embedding3 = model3.input_embedding();
+  model3 = M({1}, 1, 1);
+  EXPECT_EQ(0, ::std::memcmp(
+      input_embedding1[1].data() + 320, input_embedding3[1].data() + 320,
+      10 * sizeof(typename embedding_type::value_type)));
+
+  // A field count larger than the file is rejected
+  EXPECT_TRUE(ModelMap< M >::save(model1, file));
+  FILE *fp = ::std::fopen(file.c_str(), "r+b");
+  ASSERT_NE(nullptr, fp);
+  uint64_t field_count = uint64_t(1) << 40;
+  ::std::fseek(fp, 3 * sizeof(uint64_t), SEEK_SET);
+  ::std::fwrite(&field_count, sizeof(field_count), 1, fp);
+  ::std::fclose(fp);
+  EXPECT_FALSE(ModelMap< M >::load(file, &model3));
+
+  // Files of other value types or formats are rejected
+  EXPECT_TRUE(ModelMap< N >::save(N({16, 33}, 3, 10), file));
+  EXPECT_FALSE(ModelMap< M >::load(file, &model3));
+  {
+    ::thunder::FileBinarySerializer serializer(
+        file, ::thunder::FileBinarySerializer::out);
+    serializer.save(model1);
+  }
+  EXPECT_FALSE(ModelMap< M >::check(file));
+  EXPECT_FALSE(ModelMap< M >::load(file, &model3));
+  ::std::remove(file.c_str());
+}
+
+TEST(ModelMapTest, saveLoadTest) {
+  saveLoadTest< DoubleFNVModel, FloatFNVModel >();
+  saveLoadTest< FloatCityModel, DoubleCityModel >();
+  saveLoadTest< DoubleRollingModel, FloatRollingModel >();
+  saveLoadTest< HalfFNVModel, FloatFNVModel >();
+  saveLoadTest< FloatCityModel, HalfCityModel >();
+  saveLoadTest< QuantFNVModel, FloatFNVModel >();
+  saveLoadTest< FloatRollingModel, QuantRollingModel >();
+}
+
+TEST(ModelMapTest, sparseTest) {
+  typedef FloatFNVModel::field_array field_array;
+  typedef FloatFNVModel::index_array index_array;
+  typedef FloatFNVModel::size_type size_type;
+  typedef FloatFNVModel::tensor_type tensor_type;
+
+  // Compact a model by keeping every third row, and zero the dropped rows of
+  // the dense model to compare outputs
+  FloatFNVModel model1({16, 33}, 3, 10, {{},{1,2,3,4}}, 1995);
+  model1.initialize(0.0, 1.0);
+  SparseFNVModel::embedding_array sparse_embedding;
+  for (const tensor_type &embedding : model1.input_embedding()) {
+    SparseTensor::index_array rows;
+    for (size_type i = 0; i < embedding.size(0); ++i) {
+      if (i % 3 == 0) {
+        rows.push_back(i);
+      } else {
+        embedding[i].zero();
+      }
+    }
+    sparse_embedding.push_back(SparseTensor(embedding, rows));
+  }
+  SparseFNVModel model2(sparse_embedding, model1.output_embedding(),
+                        model1.gram(), model1.seed());
+
+  ::std::string file = "bytesteady/unittest_model.bsm";
+  EXPECT_TRUE(ModelMap< SparseFNVModel >::save(model2, file));
+  SparseFNVModel model3({1}, 1, 1);
+  EXPECT_TRUE(ModelMap< SparseFNVModel >::load(file, &model3));
+  EXPECT_EQ(6, model3.input_embedding()[0].retained());
+  EXPECT_EQ(11, model3.input_embedding()[1].retained());
+  EXPECT_EQ(33, model3.input_embedding()[1].size(0));
+
+  field_array input;
+  input.push_back(index_array{
+      ::std::make_pair(size_type(4), 0.6f),
+      ::std::make_pair(size_type(3), 0.88f),
+      ::std::make_pair(size_type(6), 0.5f)});
+  input.push_back(FloatFNVModel::byte_array({22, 0, 255, 4, 9, 88, 126, 30}));
+  const tensor_type &output1 = model1.forward(input);
+  const tensor_type &output2 = model2.forward(input);
+  const tensor_type &output3 = model3.forward(input);
+  for (size_type i = 0; i < 3; ++i) {
+    EXPECT_EQ(output1(i), output2(i));
+    EXPECT_EQ(output1(i), output3(i));
+  }
+
+  // Dense and compacted layouts do not load each other
+  SparseFNVModel model4({1}, 1, 1);
+  FloatFNVModel model5({1}, 1, 1);
+  EXPECT_FALSE(ModelMap< FloatFNVModel >::load(file, &model5));
+  ::std::remove(file.c_str());
+  EXPECT_TRUE(ModelMap< FloatFNVModel >::save(model1, file));
+  EXPECT_FALSE(ModelMap< SparseFNVModel >::load(file, &model4));
+  ::std::remove(file.c_str());
+}
+
+}  // namespace
+}  // namespace bytesteady
@@ -13,6 +13,12 @@
 
 #include "bytesteady/model.hpp"
 
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "thunder/linalg.hpp"
 #include "thunder/random.hpp"
@@ -61,6 +67,517 @@ void forwardUpdateTest() {
 
 TEST(ModelTest, forwardUpdateTest) {
   forwardUpdateTest< DoubleFNVModel >();
+  forwardUpdateTest< DoubleRollingModel >();
+  forwardUpdateTest< HalfFNVModel >();
+  forwardUpdateTest< QuantFNVModel >();
+}
+
+template < typename M >
+void planTest() {
+  typedef typename M::byte_array byte_array;
+  typedef typename M::field_array field_array;
+  typedef typename M::index_array index_array;
+  typedef typename M::plan_array plan_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
+
+  ::thunder::Random< tensor_type > random;
+
+  // Create two identical models
+  M model1({16, 32}, 3, 10, {{},{1,2,3,4}}, 1946);
+  model1.initialize(0.0, 1.0);
+  M model2 = model1.clone(false);
+
+  // Create input
+  field_array input;
+  input.push_back(index_array{
+      ::std::make_pair(size_type(4), value_type(0.6)),
+      ::std::make_pair(size_type(3), value_type(0.88))});
+  input.push_back(byte_array({22, 0, 255, 4, 9, 88, 126, 30}));
+
+  // Plan has one entry per index and one per n-gram
+  plan_array plan;
+  model2.plan(input, &plan);
+  EXPECT_EQ(2 + 8 + 7 + 6 + 5, plan.size());
+
+  // Forward with input and with plan should agree
+  const tensor_type &output1 = model1.forward(input);
+  const tensor_type &output2 = model2.forward(plan);
+  for (size_type i = 0; i < output1.size(0); ++i) {
+    EXPECT_FLOAT_EQ(output1(i), output2(i));
+  }
+
+  // Update with input and with plan should agree
+  tensor_type grad_output = random.normal(
+      tensor_type(output1.size(0)), 0.0, 1.0);
+  model1.update(input, grad_output, 0.001, 0.00001);
+  model2.update(plan, grad_output, 0.001, 0.00001);
+  for (size_type i = 0; i < model1.input_size(); ++i) {
+    const tensor_type &embedding1 = model1.input_embedding()[i];
+    const tensor_type &embedding2 = model2.input_embedding()[i];
+    for (size_type j = 0; j < embedding1.size(0); ++j) {
+      for (size_type k = 0; k < embedding1.size(1); ++k) {
+        EXPECT_FLOAT_EQ(embedding1(j, k), embedding2(j, k));
+      }
+    }
+  }
+  for (size_type i = 0; i < model1.output_embedding().size(0); ++i) {
+    for (size_type j = 0; j < model1.output_embedding().size(1); ++j) {
+      EXPECT_FLOAT_EQ(model1.output_embedding()(i, j),
+                      model2.output_embedding()(i, j));
+    }
+  }
+}
+
+TEST(ModelTest, planTest) {
+  planTest< DoubleFNVModel >();
+  planTest< DoubleRollingModel >();
+}
+
+template < typename M >
+void batchTest() {
+  typedef typename M::byte_array byte_array;
+  typedef typename M::field_array field_array;
+  typedef typename M::index_array index_array;
+  typedef typename M::plan_array plan_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
+
+  ::thunder::Random< tensor_type > random;
+
+  // Samples sharing some of their rows
+  M model({16, 32}, 3, 10, {{},{1,2,3,4}}, 1946);
+  model.initialize(0.0, 1.0);
+  M initial = model.clone(false);
+  ::std::vector< field_array > inputs(3);
+  inputs[0].push_back(index_array{
+      ::std::make_pair(size_type(4), value_type(0.6)),
+      ::std::make_pair(size_type(3), value_type(0.88))});
+  inputs[0].push_back(byte_array({22, 0, 255, 4, 9, 88, 126, 30}));
+  inputs[1].push_back(index_array{
+      ::std::make_pair(size_type(4), value_type(1.0))});
+  inputs[1].push_back(byte_array({22, 0, 255, 4, 7}));
+  inputs[2].push_back(index_array{
+      ::std::make_pair(size_type(9), value_type(0.3))});
+  inputs[2].push_back(byte_array({22, 0, 255, 4, 9, 88, 126, 30}));
+
+  // A mini-batch update adds the updates of each sample at the same
+  // parameters
+  value_type rate = 0.01;
+  ::std::vector< M > references;
+  for (const field_array &input : inputs) {
+    tensor_type grad_output = random.normal(tensor_type(3), 0.0, 1.0);
+    plan_array plan;
+    model.plan(input, &plan);
+    model.forward(plan);
+    model.accumulate(plan, grad_output);
+    M reference = initial.clone(false);
+    reference.forward(plan);
+    reference.update(plan, grad_output, rate, 0.0);
+    references.push_back(reference);
+  }
+  EXPECT_EQ(3, model.batch_size());
+  model.updateBatch(rate, 0.0);
+  EXPECT_EQ(0, model.batch_size());
+  for (size_type i = 0; i < model.input_size(); ++i) {
+    const tensor_type &embedding = model.input_embedding()[i];
+    const tensor_type &initial_embedding = initial.input_embedding()[i];
+    for (size_type j = 0; j < embedding.size(0); ++j) {
+      for (size_type k = 0; k < embedding.size(1); ++k) {
+        value_type expected = initial_embedding(j, k);
+        for (const M &reference : references) {
+          expected = expected + reference.input_embedding()[i](j, k) -
+              initial_embedding(j, k);
+        }
+        EXPECT_NEAR(expected, embedding(j, k), 1e-6);
+      }
+    }
+  }
+  const tensor_type &output_embedding = model.output_embedding();
+  const tensor_type &initial_output_embedding = initial.output_embedding();
+  for (size_type i = 0; i < output_embedding.size(0); ++i) {
+    for (size_type j = 0; j < output_embedding.size(1); ++j) {
+      value_type expected = initial_output_embedding(i, j);
+      for (const M &reference : references) {
+        expected = expected + reference.output_embedding()(i, j) -
+            initial_output_embedding(i, j);
+      }
+      EXPECT_NEAR(expected, output_embedding(i, j), 1e-6);
+    }
+  }
+
+  // An empty mini-batch does not change the parameters
+  M cloned = model.clone(false);
+  model.updateBatch(rate, 0.00001);
+  EXPECT_EQ(cloned.output_embedding()(0, 0), model.output_embedding()(0, 0));
+}
+
+TEST(ModelTest, batchTest) {
+  batchTest< DoubleFNVModel >();
+  batchTest< DoubleRollingModel >();
+}
+
+template < typename M >
+void coalesceTest() {
+  typedef typename M::byte_array byte_array;
+  typedef typename M::field_array field_array;
+  typedef typename M::index_array index_array;
+  typedef typename M::plan_array plan_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
+
+  M model1({16, 32}, 3, 10, {{},{1,2}}, 1946);
+  model1.initialize(0.0, 1.0);
+  M model2 = model1.clone(false);
+  model2.set_coalesce(true);
+  EXPECT_FALSE(model1.coalesce());
+  EXPECT_TRUE(model2.coalesce());
+
+  // Repetitive input with duplicated indices and n-grams
+  field_array input;
+  input.push_back(index_array{
+      ::std::make_pair(size_type(4), value_type(0.6)),
+      ::std::make_pair(size_type(3), value_type(0.88)),
+      ::std::make_pair(size_type(4), value_type(0.2))});
+  input.push_back(byte_array({7, 7, 7, 7, 7, 7, 7, 7}));
+
+  plan_array plan1, plan2;
+  EXPECT_EQ(3 + 8 + 7, model1.plan(input, &plan1));
+  EXPECT_EQ(3 + 8 + 7, model2.plan(input, &plan2));
+  EXPECT_EQ(3 + 8 + 7, plan1.size());
+  EXPECT_GE(4, plan2.size());
+  value_type weight1 = 0.0, weight2 = 0.0;
+  for (size_type i = 0; i < plan1.size(); ++i) {
+    weight1 = weight1 + plan1[i].weight;
+  }
+  for (size_type i = 0; i < plan2.size(); ++i) {
+    weight2 = weight2 + plan2[i].weight;
+    if (i > 0) {
+      EXPECT_TRUE(plan2[i - 1].field < plan2[i].field ||
+                  plan2[i - 1].index < plan2[i].index);
+    }
+  }
+  EXPECT_FLOAT_EQ(weight1, weight2);
+
+  // Forward result does not change with coalescing
+  const tensor_type &output1 = model1.forward(plan1);
+  const tensor_type &output2 = model2.forward(plan2);
+  for (size_type i = 0; i < output1.size(0); ++i) {
+    EXPECT_NEAR(output1(i), output2(i), 1e-9);
+  }
+}
+
+TEST(ModelTest, coalesceTest) {
+  coalesceTest< DoubleFNVModel >();
+  coalesceTest< DoubleRollingModel >();
+}
+
+template < typename M >
+void decayTest(bool lazy) {
+  typedef typename M::field_array field_array;
+  typedef typename M::index_array index_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
+
+  ::thunder::Linalg< tensor_type > linalg;
+  ::thunder::Random< tensor_type > random;
+  const value_type rate = 0.5;
+  const value_type decay = 0.9;
+
+  // Create model and a reference copy of its parameters
+  M model({8}, 3, 4, {{}}, 1946);
+  model.initialize(0.0, 1.0);
+  model.set_lazy_decay(lazy);
+  tensor_type input_embedding = tensor_type(8, 4).copy(
+      model.input_embedding()[0]);
+  tensor_type output_embedding = tensor_type(3, 4).copy(
+      model.output_embedding());
+
+  field_array input;
+  input.push_back(index_array{
+      ::std::make_pair(size_type(4), value_type(0.6)),
+      ::std::make_pair(size_type(3), value_type(0.88)),
+      ::std::make_pair(size_type(4), value_type(0.3))});
+  const index_array &pairs = ::std::get< index_array >(input[0]);
+
+  // Enough steps for the pending scales to be folded in more than once
+  tensor_type feature(4);
+  tensor_type output(3);
+  tensor_type grad_feature(4);
+  size_type fold_count = 0;
+  for (size_type step = 0; step < 50; ++step) {
+    if (model.folding() == true) {
+      model.normalize();
+      fold_count = fold_count + 1;
+    }
+    const tensor_type &model_output = model.forward(input);
+    // Reference forward with eager weight decay
+    feature.zero();
+    for (const auto &pair : pairs) {
+      linalg.axpy(input_embedding[pair.first], feature, pair.second);
+    }
+    linalg.gemv(output_embedding, feature, output.zero());
+    for (size_type i = 0; i < 3; ++i) {
+      EXPECT_NEAR(output(i), model_output(i), 1e-9);
+    }
+    tensor_type grad_output = random.normal(tensor_type(3), 0.0, 1.0);
+    model.update(input, grad_output, rate, decay);
+    // Reference update with eager weight decay
+    grad_feature.zero();
+    for (size_type i = 0; i < 3; ++i) {
+      linalg.axpy(output_embedding[i], grad_feature, grad_output(i));
+    }
+    for (const auto &pair : pairs) {
+      linalg.axpy(grad_feature, input_embedding[pair.first],
+                  -rate * pair.second);
+      linalg.scal(input_embedding[pair.first],
+                  1.0 - pair.second * decay * rate);
+    }
+    linalg.ger(grad_output, feature, output_embedding, -rate);
+    linalg.scal(output_embedding, 1.0 - decay * rate);
+  }
+  EXPECT_EQ(lazy, fold_count > 1);
+
+  // Parameters read from the model have all pending decay applied
+  for (size_type i = 0; i < 8; ++i) {
+    for (size_type j = 0; j < 4; ++j) {
+      EXPECT_NEAR(input_embedding(i, j), model.input_embedding()[0](i, j),
+                  1e-9);
+    }
+  }
+  for (size_type i = 0; i < 3; ++i) {
+    for (size_type j = 0; j < 4; ++j) {
+      EXPECT_NEAR(output_embedding(i, j), model.output_embedding()(i, j),
+                  1e-9);
+    }
+  }
+}
+
+TEST(ModelTest, decayTest) {
+  decayTest< DoubleFNVModel >(false);
+  decayTest< DoubleFNVModel >(true);
+}
+
+template < typename M >
+void pendingTest() {
+  typedef typename M::field_array field_array;
+  typedef typename M::index_array index_array;
+  typedef typename M::plan_array plan_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
+
+  M model({8}, 3, 4, {{}}, 1946);
+  model.initialize(0.0, 1.0);
+  field_array input;
+  input.push_back(index_array{
+      ::std::make_pair(size_type(4), value_type(0.6))});
+  tensor_type grad_output(3);
+  grad_output.fill(0.1);
+
+  // Eager decay never leaves scales pending
+  model.forward(input);
+  model.update(input, grad_output, 0.5, 0.1);
+  EXPECT_FALSE(model.pending());
+
+  // Lazy decay leaves scales pending until normalize()
+  model.set_lazy_decay(true);
+  model.forward(input);
+  model.update(input, grad_output, 0.5, 0.0);
+  EXPECT_FALSE(model.pending());
+  model.forward(input);
+  model.update(input, grad_output, 0.5, 0.1);
+  EXPECT_TRUE(model.pending());
+  M shared_model = model.clone(true);
+  EXPECT_TRUE(shared_model.pending());
+  M copied_model = model.clone(false);
+  EXPECT_TRUE(model.pending());
+  EXPECT_TRUE(copied_model.pending());
+  model.normalize();
+  EXPECT_FALSE(model.pending());
+  EXPECT_FALSE(shared_model.pending());
+  EXPECT_TRUE(copied_model.pending());
+  plan_array plan;
+  model.plan(input, &plan);
+  model.forward(plan);
+  model.accumulate(plan, grad_output);
+  model.updateBatch(0.5, 0.1);
+  EXPECT_TRUE(model.pending());
+}
+
+TEST(ModelTest, pendingTest) {
+  pendingTest< DoubleFNVModel >();
+}
+
+template < typename M >
+void gradFeatureTest() {
+  typedef typename M::byte_array byte_array;
+  typedef typename M::field_array field_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+
+  ::thunder::Random< tensor_type > random;
+  ::thunder::Linalg< tensor_type > linalg;
+
+  field_array input;
+  input.push_back(byte_array({22, 0, 255, 4, 9, 88, 126, 30}));
+  for (size_type classes : {1, 2, 16, 129}) {
+    M model({1024}, classes, 10, {{1,2,3,4}}, 1946);
+    model.initialize(0.0, 1.0);
+    tensor_type grad_output = random.normal(
+        tensor_type(classes), 0.0, 1.0);
+    // The update changes the output embedding after computing grad_feature
+    tensor_type output_embedding = model.output_embedding().clone();
+    model.forward(input);
+    model.update(input, grad_output, 0.001, 0.00001);
+    tensor_type grad_feature(10);
+    linalg.gemv(output_embedding.transpose(0, 1), grad_output,
+                grad_feature.zero());
+    const tensor_type &model_grad_feature = model.grad_feature();
+    ASSERT_EQ(10, model_grad_feature.size(0));
+    for (size_type i = 0; i < 10; ++i) {
+      EXPECT_NEAR(grad_feature(i), model_grad_feature(i), 1e-9);
+    }
+  }
+}
+
+TEST(ModelTest, gradFeatureTest) {
+  gradFeatureTest< DoubleFNVModel >();
+}
+
+template < typename M >
+void updateBenchmarkTest() {
+  typedef typename M::byte_array byte_array;
+  typedef typename M::field_array field_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+
+  ::thunder::Random< tensor_type > random;
+  const size_type steps = 100;
+
+  field_array input;
+  input.push_back(byte_array({22, 0, 255, 4, 9, 88, 126, 30}));
+  for (size_type classes : {2, 16, 128, 1024, 8192}) {
+    M model({1024}, classes, 64, {{1,2,3,4}}, 1946);
+    model.initialize(0.0, 1.0);
+    tensor_type grad_output = random.normal(
+        tensor_type(classes), 0.0, 1.0);
+    model.forward(input);
+    ::std::chrono::steady_clock::time_point start =
+        ::std::chrono::steady_clock::now();
+    for (size_type i = 0; i < steps; ++i) {
+      model.update(input, grad_output, 0.001, 0.00001);
+    }
+    double elapsed = ::std::chrono::duration< double, ::std::micro >(
+        ::std::chrono::steady_clock::now() - start).count();
+    printf("Update classes = %lu, time per step = %gus\n", classes,
+           elapsed / static_cast< double >(steps));
+  }
+}
+
+TEST(ModelTest, updateBenchmarkTest) {
+  updateBenchmarkTest< DoubleFNVModel >();
+}
+
+template < typename M >
+void placeTest() {
+  typedef typename M::byte_array byte_array;
+  typedef typename M::field_array field_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+
+  field_array input;
+  input.push_back(byte_array({22, 0, 255, 4, 9, 88, 126, 30}));
+  M model({4096}, 3, 16, {{1,2,3,4}}, 1946);
+  model.initialize(0.0, 1.0);
+  for (PlacementPage page : {kDefaultPage, kHugePage}) {
+    ::thunder::StringBinarySerializer serializer;
+    serializer.save(model);
+    // Placed embeddings are initialized in place by several threads
+    M placed_model({4096}, 3, 16, {{1,2,3,4}}, 1946,
+                   Placement(page, kDefaultPolicy));
+    placed_model.initialize(0.0, 1.0, 4);
+    // Loading places each field and keeps its values
+    M loaded_model({2}, 3, 16, {{1,2,3,4}}, 1946);
+    loaded_model.set_placement(Placement(page, kDefaultPolicy));
+    serializer.load(&loaded_model);
+    for (const M *m : {&placed_model, &loaded_model}) {
+      for (size_type i = 0; i < 4096; ++i) {
+        for (size_type j = 0; j < 16; ++j) {
+          EXPECT_EQ(model.input_embedding()[0](i, j),
+                    m->input_embedding()[0](i, j));
+        }
+      }
+    }
+    const tensor_type &output = model.forward(input);
+    const tensor_type &placed_output = placed_model.forward(input);
+    for (size_type i = 0; i < 3; ++i) {
+      EXPECT_FLOAT_EQ(output(i), placed_output(i));
+    }
+  }
+}
+
+TEST(ModelTest, placeTest) {
+  placeTest< FloatFNVModel >();
+}
+
+template < typename M >
+void placeBenchmarkTest() {
+  typedef typename M::byte_array byte_array;
+  typedef typename M::field_array field_array;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+
+  ::thunder::Random< tensor_type > random;
+  const size_type steps = 200;
+  // Tables large enough to miss the TLB, like 1 << 21 rows taking 128 MB,
+  // are set by the environment so that default runs stay small
+  size_type rows = 1 << 14;
+  const char *rows_env = ::std::getenv("BYTESTEADY_PLACE_BENCHMARK_ROWS");
+  if (rows_env != nullptr && ::std::strtoull(rows_env, nullptr, 10) > 0) {
+    rows = ::std::strtoull(rows_env, nullptr, 10);
+  }
+
+  // Random bytes spread activations over the table
+  ::std::vector< field_array > inputs(64);
+  for (field_array &input : inputs) {
+    tensor_type bytes = random.uniform(tensor_type(64), 0.0, 256.0);
+    byte_array field(64);
+    for (size_type i = 0; i < 64; ++i) {
+      field[i] = static_cast< uint8_t >(bytes(i));
+    }
+    input.push_back(field);
+  }
+  for (const Placement &placement : {
+           Placement(), Placement(kHugePage, kDefaultPolicy),
+           Placement(kHugePage, kInterleavePolicy)}) {
+    M model({rows}, 4, 16, {{1,2,3,4}}, 1946, placement);
+    model.initialize(0.0, 1.0, 4);
+    tensor_type grad_output = random.normal(tensor_type(4), 0.0, 1.0);
+    ::std::chrono::steady_clock::time_point start =
+        ::std::chrono::steady_clock::now();
+    for (size_type i = 0; i < steps; ++i) {
+      const field_array &input = inputs[i % inputs.size()];
+      model.forward(input);
+      model.update(input, grad_output, 0.001, 0.0);
+    }
+    double elapsed = ::std::chrono::duration< double, ::std::micro >(
+        ::std::chrono::steady_clock::now() - start).count();
+    printf("Place rows = %lu, page = %s, policy = %s, placed = %s, "
+           "time per step = %gus\n", rows,
+           placement.page() == kDefaultPage ? "default" : "huge",
+           placement.policy() == kDefaultPolicy ? "default" : "interleave",
+           model.placed() ? "true" : "false",
+           elapsed / static_cast< double >(steps));
+  }
+}
+
+TEST(ModelTest, placeBenchmarkTest) {
+  placeBenchmarkTest< FloatFNVModel >();
 }
 
 template < typename M >
@@ -188,5 +705,65 @@ TEST(ModelTest, cloneTest) {
   cloneTest< DoubleFNVModel >();
 }
 
+template < typename M >
+void initializeTest() {
+  typedef typename M::embedding_array embedding_array;
+  typedef typename M::embedding_type embedding_type;
+  typedef typename M::size_type size_type;
+  typedef typename M::tensor_type tensor_type;
+
+  // Embeddings larger than a shard give the same values bit for bit with any
+  // number of threads
+  M model1({40000, 32}, 3, 10, {{1,2,3,4}}, 1946);
+  model1.initialize(0.0, 1.0, 1);
+  const embedding_array &input_embedding1 = model1.input_embedding();
+  const tensor_type &output_embedding1 = model1.output_embedding();
+  for (size_type threads : {2, 3, 4, 8}) {
+    M model2({40000, 32}, 3, 10, {{1,2,3,4}}, 1946);
+    model2.initialize(0.0, 1.0, threads);
+    const embedding_array &input_embedding2 = model2.input_embedding();
+    for (size_type i = 0; i < input_embedding1.size(); ++i) {
+      EXPECT_EQ(0, ::std::memcmp(
+          input_embedding1[i].data(), input_embedding2[i].data(),
+          input_embedding1[i].size(0) * input_embedding1[i].stride(0) *
+          sizeof(typename embedding_type::value_type))) << threads;
+    }
+    const tensor_type &output_embedding2 = model2.output_embedding();
+    for (size_type i = 0; i < output_embedding1.size(0); ++i) {
+      for (size_type j = 0; j < output_embedding1.size(1); ++j) {
+        EXPECT_EQ(output_embedding1(i, j), output_embedding2(i, j));
+      }
+    }
+  }
+
+  // Values depend on the seed
+  M model3({40000, 32}, 3, 10, {{1,2,3,4}}, 1947);
+  model3.initialize(0.0, 1.0, 4);
+  const embedding_array &input_embedding3 = model3.input_embedding();
+  for (size_type i = 0; i < input_embedding1.size(); ++i) {
+    EXPECT_NE(0, ::std::memcmp(
+        input_embedding1[i].data(), input_embedding3[i].data(),
+        input_embedding1[i].size(0) * input_embedding1[i].stride(0) *
+        sizeof(typename embedding_type::value_type)));
+  }
+
+  // Shards do not repeat each other
+  const embedding_type &e = input_embedding1[0];
+  size_type stride = e.stride(0);
+  EXPECT_NE(0, ::std::memcmp(e.data(), e.data() + 16384 * stride,
+                             stride * sizeof(*e.data())));
+  EXPECT_NE(0, ::std::memcmp(e.data(), input_embedding1[1].data(),
+                             stride * sizeof(*e.data())));
+  EXPECT_NEAR(0.0, e.mean(), 0.01);
+  EXPECT_NEAR(1.0, e.std(), 0.01);
+}
+
+TEST(ModelTest, initializeTest) {
+  initializeTest< DoubleFNVModel >();
+  initializeTest< FloatFNVModel >();
+  initializeTest< HalfFNVModel >();
+  initializeTest< QuantFNVModel >();
+}
+
 }  // namespace
 }  // namespace bytesteady
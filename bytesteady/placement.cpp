@@ -0,0 +1,188 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/placement.hpp"
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
+
+namespace bytesteady {
+
+namespace {
+
+// Size of huge pages on x86-64 and aarch64 with 4 KiB base pages
+const Placement::size_type kHugeSize = 2 << 20;
+// Number of nodes in the node masks given to mbind
+const Placement::size_type kMaskSize = 1024;
+
+bool readLine(const ::std::string &file, ::std::string *line) {
+  ::std::ifstream stream(file);
+  return static_cast< bool >(::std::getline(stream, *line));
+}
+
+}  // namespace
+
+Placement::Placement(PlacementPage p, PlacementPolicy q, size_type n) :
+    page_(p), policy_(q), node_(n) {}
+
+::std::shared_ptr< void > Placement::allocate(
+    size_type size, bool *placed) const {
+  // Round up to whole huge pages so that tails are not left on small pages
+  size_type length = size == 0 ? kHugeSize :
+      (size + kHugeSize - 1) / kHugeSize * kHugeSize;
+  bool success = true;
+  size_type mapped = length;
+  void *address = MAP_FAILED;
+  if (page_ == kHugetlbPage) {
+    address = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    success = address != MAP_FAILED;
+  }
+  if (address == MAP_FAILED) {
+    // Map an extra huge page to align the region for transparent huge pages
+    mapped = page_ == kDefaultPage ? length : length + kHugeSize;
+    address = ::mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED) {
+      throw ::std::bad_alloc();
+    }
+  }
+  uint8_t *data = static_cast< uint8_t * >(address);
+  if (mapped > length) {
+    uintptr_t offset = reinterpret_cast< uintptr_t >(data) % kHugeSize;
+    data = offset == 0 ? data : data + (kHugeSize - offset);
+    success = ::madvise(data, length, MADV_HUGEPAGE) == 0 && success;
+  }
+  // The policy must be set before the first touch of the pages
+  if (policy_ != kDefaultPolicy) {
+    unsigned long mask[kMaskSize / (8 * sizeof(unsigned long))] = {};
+    size_array nodes = policy_ == kInterleavePolicy ?
+        Placement::nodes() : size_array{node_};
+    for (const size_type &n : nodes) {
+      if (n < kMaskSize) {
+        mask[n / (8 * sizeof(unsigned long))] |=
+            1UL << (n % (8 * sizeof(unsigned long)));
+      }
+    }
+    int mode = policy_ == kInterleavePolicy ? MPOL_INTERLEAVE : MPOL_BIND;
+    success = ::syscall(
+        SYS_mbind, data, length, mode, mask, kMaskSize, 0) == 0 && success;
+  }
+  if (placed != nullptr) {
+    *placed = success;
+  }
+  return ::std::shared_ptr< void >(data, [address, mapped](void *) -> void {
+      ::munmap(address, mapped);});
+}
+
+bool Placement::pin(size_type i) const {
+  if (policy_ == kDefaultPolicy) {
+    return false;
+  }
+  size_array nodes = Placement::nodes();
+  size_array cpus = Placement::cpus(
+      policy_ == kInterleavePolicy ? nodes[i % nodes.size()] : node_);
+  if (cpus.size() == 0) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const size_type &cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+PlacementPage Placement::page() const {
+  return page_;
+}
+
+void Placement::set_page(PlacementPage p) {
+  page_ = p;
+}
+
+PlacementPolicy Placement::policy() const {
+  return policy_;
+}
+
+void Placement::set_policy(PlacementPolicy q) {
+  policy_ = q;
+}
+
+Placement::size_type Placement::node() const {
+  return node_;
+}
+
+void Placement::set_node(size_type n) {
+  node_ = n;
+}
+
+Placement::size_array Placement::nodes() {
+  ::std::string line;
+  size_array result;
+  if (readLine("/sys/devices/system/node/online", &line) == true) {
+    result = parseList(line);
+  }
+  return result.size() == 0 ? size_array{0} : result;
+}
+
+Placement::size_array Placement::cpus(size_type n) {
+  ::std::string line;
+  if (readLine("/sys/devices/system/node/node" + ::std::to_string(n) +
+               "/cpulist", &line) == true) {
+    return parseList(line);
+  }
+  size_array result;
+  if (n == 0) {
+    for (size_type i = 0; i < ::std::thread::hardware_concurrency(); ++i) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+Placement::size_array Placement::parseList(const ::std::string &list) {
+  size_array result;
+  ::std::istringstream stream(list);
+  ::std::string range;
+  while (::std::getline(stream, range, ',')) {
+    char *end = nullptr;
+    size_type first = ::std::strtoull(range.c_str(), &end, 10);
+    if (end == range.c_str()) {
+      continue;
+    }
+    size_type last = first;
+    if (*end == '-') {
+      last = ::std::strtoull(end + 1, nullptr, 10);
+    }
+    for (size_type i = first; i <= last; ++i) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+}  // namespace bytesteady
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_PLACEMENT_HPP_
+#define BYTESTEADY_PLACEMENT_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bytesteady {
+
+// Pages backing large allocations
+enum PlacementPage {
+  kDefaultPage = 0,
+  // Transparent huge pages requested by madvise
+  kHugePage = 1,
+  // Explicit huge pages from hugetlbfs
+  kHugetlbPage = 2,
+};
+
+// NUMA policy of large allocations and of the threads using them
+enum PlacementPolicy {
+  kDefaultPolicy = 0,
+  // Pages are spread over all nodes and threads over their CPUs
+  kInterleavePolicy = 1,
+  // Pages and threads stay on one node
+  kBindPolicy = 2,
+};
+
+/*
+ * Placement of embedding tables in memory. Embeddings are read at random rows
+ * given by hashes, so on large tables most accesses miss the TLB and many go
+ * to a remote NUMA node. Placement allocates the tables on huge pages and
+ * sets their NUMA policy before the pages are touched, and pins the worker
+ * threads to the CPUs of the matching nodes.
+ *
+ * Everything is best effort: when the system has no huge pages or NUMA
+ * support, memory is allocated with regular pages and the failures are
+ * reported by the return values.
+ */
+class Placement {
+ public:
+  typedef ::std::size_t size_type;
+  typedef ::std::vector< size_type > size_array;
+
+  Placement(PlacementPage p = kDefaultPage,
+            PlacementPolicy q = kDefaultPolicy, size_type n = 0);
+
+  // Allocate zeroed memory of size bytes. If placed is not nullptr, it is set
+  // to whether both the page type and the policy were applied.
+  ::std::shared_ptr< void > allocate(
+      size_type size, bool *placed = nullptr) const;
+
+  // Pin the calling thread, which is the i-th worker, to the CPUs of its node.
+  // Returns false if the policy is default or pinning failed.
+  bool pin(size_type i) const;
+
+  PlacementPage page() const;
+  void set_page(PlacementPage p);
+
+  PlacementPolicy policy() const;
+  void set_policy(PlacementPolicy q);
+
+  size_type node() const;
+  void set_node(size_type n);
+
+  // Online NUMA nodes, and the CPUs of a node. A system without NUMA support
+  // has a single node 0 with all the CPUs.
+  static size_array nodes();
+  static size_array cpus(size_type n);
+  // Parse a list such as "0-3,8,10-11" as used by sysfs
+  static size_array parseList(const ::std::string &list);
+
+ private:
+  PlacementPage page_;
+  PlacementPolicy policy_;
+  size_type node_;
+};
+
+}  // namespace bytesteady
+
+#endif  // BYTESTEADY_PLACEMENT_HPP_
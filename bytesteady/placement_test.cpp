@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/placement.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace bytesteady {
+namespace {
+
+TEST(PlacementTest, parseListTest) {
+  typedef Placement::size_array size_array;
+  EXPECT_EQ(size_array({0}), Placement::parseList("0\n"));
+  EXPECT_EQ(size_array({0, 1, 2, 3, 8, 10, 11}),
+            Placement::parseList("0-3,8,10-11"));
+  EXPECT_EQ(size_array(), Placement::parseList(""));
+}
+
+TEST(PlacementTest, allocateTest) {
+  for (PlacementPage page : {kDefaultPage, kHugePage, kHugetlbPage}) {
+    for (PlacementPolicy policy :
+             {kDefaultPolicy, kInterleavePolicy, kBindPolicy}) {
+      // Placement may fail in a container, but memory is always usable
+      Placement placement(page, policy, Placement::nodes()[0]);
+      bool placed = false;
+      ::std::shared_ptr< void > memory = placement.allocate(3 << 20, &placed);
+      ASSERT_NE(nullptr, memory.get());
+      float *data = static_cast< float * >(memory.get());
+      for (::std::size_t i = 0; i < (3 << 20) / sizeof(float); ++i) {
+        EXPECT_EQ(0.0f, data[i]);
+        data[i] = 1.0f;
+      }
+      if (page != kDefaultPage && placed == true) {
+        EXPECT_EQ(0, reinterpret_cast< uintptr_t >(data) % (2 << 20));
+      }
+    }
+  }
+}
+
+TEST(PlacementTest, pinTest) {
+  Placement placement;
+  EXPECT_FALSE(placement.pin(0));
+  EXPECT_LT(0, Placement::cpus(Placement::nodes()[0]).size());
+
+  // Pinning only changes the affinity of the calling thread
+  placement.set_policy(kInterleavePolicy);
+  bool pinned = false;
+  ::std::thread thread([&placement, &pinned]() -> void {
+      pinned = placement.pin(1);});
+  thread.join();
+  EXPECT_TRUE(pinned);
+}
+
+}  // namespace
+}  // namespace bytesteady
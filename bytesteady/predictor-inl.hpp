@@ -0,0 +1,140 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/predictor.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <variant>
+
+namespace bytesteady {
+
+template < typename M >
+Predictor< M >::Predictor(const M &m, bool share) {
+  // A shared clone never folds the scales it shares with m, so apply them
+  // to m first
+  m.normalize();
+  M model = m.clone(share);
+  input_embedding_ = model.input_embedding();
+  output_embedding_ = model.output_embedding();
+  gram_ = model.gram();
+  seed_ = model.seed();
+  kernel_ = kernel_type(model.dimension());
+}
+
+template < typename M >
+typename Predictor< M >::Context Predictor< M >::context() const {
+  return Context{hash_type(), value_array(dimension()),
+                 value_array(output_size())};
+}
+
+template < typename M >
+const typename Predictor< M >::value_array &Predictor< M >::predict(
+    const field_span *input, size_type n, Context *c) const {
+  return predict(&input, &n, 1, c);
+}
+
+template < typename M >
+const typename Predictor< M >::value_array &Predictor< M >::predict(
+    const field_span *const *input, const size_type *n, size_type b,
+    Context *c) const {
+  size_type dimension = this->dimension();
+  size_type output_size = this->output_size();
+  // Shrinking does not release memory, so a context reused for smaller
+  // batches does not allocate
+  c->feature.resize(b * dimension);
+  c->output.resize(b * output_size);
+  ::std::fill(c->feature.begin(), c->feature.end(), 0.0);
+  for (size_type k = 0; k < b; ++k) {
+    embed(input[k], n[k], c->feature.data() + k * dimension, c);
+  }
+  // Output is the product of output embedding and features
+  const value_type *data = output_embedding_.data();
+  size_type stride = output_embedding_.stride(0);
+  for (size_type i = 0; i < output_size; ++i) {
+    const value_type *row = data + i * stride;
+    for (size_type k = 0; k < b; ++k) {
+      const value_type *feature = c->feature.data() + k * dimension;
+      value_type sum = 0.0;
+      for (size_type j = 0; j < dimension; ++j) {
+        sum = sum + row[j] * feature[j];
+      }
+      c->output[k * output_size + i] = sum;
+    }
+  }
+  return c->output;
+}
+
+template < typename M >
+const typename Predictor< M >::value_array &Predictor< M >::predict(
+    ::std::initializer_list< field_span > input, Context *c) const {
+  return predict(input.begin(), input.size(), c);
+}
+
+template < typename M >
+typename Predictor< M >::size_type Predictor< M >::input_size() const {
+  return input_embedding_.size();
+}
+
+template < typename M >
+typename Predictor< M >::size_type Predictor< M >::output_size() const {
+  return output_embedding_.size(0);
+}
+
+template < typename M >
+typename Predictor< M >::size_type Predictor< M >::dimension() const {
+  return output_embedding_.size(1);
+}
+
+template < typename M >
+void Predictor< M >::embed(const field_span *input, size_type n,
+                           value_type *feature, Context *c) const {
+  const index_span *field_index;
+  const byte_span *field_bytes;
+  // Accumulate the feature directly without a plan
+  for (size_type i = 0; i < ::std::min(n, input_size()); ++i) {
+    const embedding_type &embedding = input_embedding_[i];
+    size_type rows = embedding.size(0);
+    if ((field_index = ::std::get_if< index_span >(&input[i])) != nullptr) {
+      // The field is an index array
+      for (size_type j = 0; j < field_index->second; ++j) {
+        const index_pair &pair = field_index->first[j];
+        if (pair.first < rows) {
+          kernel_.axpy(embedding, pair.first, feature, pair.second);
+        }
+      }
+    } else if ((field_bytes = ::std::get_if< byte_span >(
+        &input[i])) != nullptr) {
+      // The field is a byte sequence
+      const uint8_t *bytes = field_bytes->first;
+      size_type size = field_bytes->second;
+      size_type field_size = 0;
+      for (const size_type &g : gram_[i]) {
+        field_size = field_size + (size >= g ? (size - g + 1) : 0);
+      }
+      if (field_size == 0) {
+        continue;
+      }
+      value_type weight = 1.0 / static_cast< value_type >(field_size);
+      c->hash.reset(bytes, size, seed_);
+      for (const size_type &g : gram_[i]) {
+        for (size_type j = 0; size >= g && j < size - g + 1; ++j) {
+          size_type index = c->hash.gram64(j, g) % rows;
+          kernel_.axpy(embedding, index, feature, weight);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace bytesteady
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/predictor.hpp"
+
+#include "bytesteady/model.hpp"
+
+#include "bytesteady/predictor-inl.hpp"
+
+namespace bytesteady {
+
+// Template class instantiation
+template class Predictor< DoubleFNVModel >;
+template class Predictor< FloatFNVModel >;
+template class Predictor< DoubleCityModel >;
+template class Predictor< FloatCityModel >;
+template class Predictor< DoubleRollingModel >;
+template class Predictor< FloatRollingModel >;
+template class Predictor< HalfFNVModel >;
+template class Predictor< HalfCityModel >;
+template class Predictor< HalfRollingModel >;
+template class Predictor< QuantFNVModel >;
+template class Predictor< QuantCityModel >;
+template class Predictor< QuantRollingModel >;
+template class Predictor< SparseFNVModel >;
+template class Predictor< SparseCityModel >;
+template class Predictor< SparseRollingModel >;
+
+}  // namespace bytesteady
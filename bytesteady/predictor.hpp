@@ -0,0 +1,142 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_PREDICTOR_HPP_
+#define BYTESTEADY_PREDICTOR_HPP_
+
+#include <initializer_list>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "bytesteady/integer.hpp"
+#include "bytesteady/kernel.hpp"
+#include "bytesteady/model.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+
+/*
+ * Thread-safe inference for embedding the model in other programs. The
+ * predictor is immutable after construction and can be shared by any number
+ * of threads, each of which owns a Context for scratch space. Inputs are
+ * views of memory owned by the caller, and predict() does not allocate on the
+ * heap once the context has seen an input of the same size.
+ */
+template < typename M = Model<> >
+class Predictor {
+ public:
+  typedef M model_type;
+  typedef typename M::hash_type hash_type;
+  typedef typename M::kernel_type kernel_type;
+  typedef typename M::gram_array gram_array;
+  typedef typename M::index_pair index_pair;
+  typedef typename M::size_type size_type;
+  typedef typename M::embedding_array embedding_array;
+  typedef typename M::embedding_type embedding_type;
+  typedef typename M::tensor_array tensor_array;
+  typedef typename M::tensor_type tensor_type;
+  typedef typename M::value_type value_type;
+  typedef ::std::vector< value_type > value_array;
+
+  // Views of a byte field and an index field as pointer and size
+  typedef ::std::pair< const uint8_t *, size_type > byte_span;
+  typedef ::std::pair< const index_pair *, size_type > index_span;
+  typedef ::std::variant< index_span, byte_span > field_span;
+
+  // Scratch space for one thread. Only use it with one call at a time.
+  struct Context {
+    hash_type hash;
+    value_array feature;
+    value_array output;
+  };
+  typedef Context context_type;
+
+  // The predictor shares or copies the parameters of the model, in the same
+  // way as Model::clone(). Pending weight decay is applied to the model first.
+  // A shared model must not be trained while the predictor is used.
+  explicit Predictor(const M &m, bool share = true);
+
+  // Create a context sized for the model
+  Context context() const;
+
+  // Return the output scores for the given fields, valid until the next call
+  // with the same context. Indices outside of the embedding are ignored.
+  const value_array &predict(const field_span *input, size_type n,
+                             Context *c) const;
+  const value_array &predict(::std::initializer_list< field_span > input,
+                             Context *c) const;
+  // Return the output scores for b inputs at once, where input i has the n[i]
+  // fields at input[i] and its scores start at i * output_size(). Each row of
+  // the output embedding is read once for the whole batch.
+  const value_array &predict(const field_span *const *input,
+                             const size_type *n, size_type b,
+                             Context *c) const;
+
+  size_type input_size() const;
+  size_type output_size() const;
+  size_type dimension() const;
+
+ private:
+  embedding_array input_embedding_;
+  tensor_type output_embedding_;
+  gram_array gram_;
+  uint64_t seed_;
+  kernel_type kernel_;
+
+  // Accumulate the feature of the n fields in input
+  void embed(const field_span *input, size_type n, value_type *feature,
+             Context *c) const;
+};
+
+typedef Predictor< DoubleFNVModel > DoubleFNVPredictor;
+typedef Predictor< FloatFNVModel > FloatFNVPredictor;
+typedef Predictor< DoubleCityModel > DoubleCityPredictor;
+typedef Predictor< FloatCityModel > FloatCityPredictor;
+typedef Predictor< DoubleRollingModel > DoubleRollingPredictor;
+typedef Predictor< FloatRollingModel > FloatRollingPredictor;
+typedef Predictor< HalfFNVModel > HalfFNVPredictor;
+typedef Predictor< HalfCityModel > HalfCityPredictor;
+typedef Predictor< HalfRollingModel > HalfRollingPredictor;
+typedef Predictor< QuantFNVModel > QuantFNVPredictor;
+typedef Predictor< QuantCityModel > QuantCityPredictor;
+typedef Predictor< QuantRollingModel > QuantRollingPredictor;
+typedef Predictor< SparseFNVModel > SparseFNVPredictor;
+typedef Predictor< SparseCityModel > SparseCityPredictor;
+typedef Predictor< SparseRollingModel > SparseRollingPredictor;
+// Already exists: typedef DoubleFNVPredictor Predictor;
+
+}  // namespace bytesteady
+
+namespace bytesteady {
+
+// Pre-compiled template class instantiation
+extern template class Predictor< DoubleFNVModel >;
+extern template class Predictor< FloatFNVModel >;
+extern template class Predictor< DoubleCityModel >;
+extern template class Predictor< FloatCityModel >;
+extern template class Predictor< DoubleRollingModel >;
+extern template class Predictor< FloatRollingModel >;
+extern template class Predictor< HalfFNVModel >;
+extern template class Predictor< HalfCityModel >;
+extern template class Predictor< HalfRollingModel >;
+extern template class Predictor< QuantFNVModel >;
+extern template class Predictor< QuantCityModel >;
+extern template class Predictor< QuantRollingModel >;
+extern template class Predictor< SparseFNVModel >;
+extern template class Predictor< SparseCityModel >;
+extern template class Predictor< SparseRollingModel >;
+
+}  // namespace bytesteady
+
+#endif  // BYTESTEADY_PREDICTOR_HPP_
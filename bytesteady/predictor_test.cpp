@@ -0,0 +1,230 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/predictor.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "bytesteady/data.hpp"
+#include "bytesteady/integer.hpp"
+#include "gtest/gtest.h"
+
+// Count heap allocations to check that predict() does not allocate
+::std::atomic< uint64_t > allocation_count(0);
+
+void *operator new(::std::size_t size) {
+  allocation_count.fetch_add(1);
+  void *pointer = ::std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw ::std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void *pointer) noexcept {
+  ::std::free(pointer);
+}
+
+namespace bytesteady {
+namespace {
+
+template < typename P >
+void predictTest() {
+  typedef typename P::context_type context_type;
+  typedef typename P::field_span field_span;
+  typedef typename P::byte_span byte_span;
+  typedef typename P::index_span index_span;
+  typedef typename P::model_type model_type;
+  typedef typename P::value_array value_array;
+  typedef typename model_type::byte_array byte_array;
+  typedef typename model_type::field_array field_array;
+  typedef typename model_type::gram_array gram_array;
+  typedef typename model_type::index_array index_array;
+  typedef typename model_type::size_storage size_storage;
+  typedef typename model_type::size_type size_type;
+  typedef typename model_type::tensor_type tensor_type;
+  typedef Data< tensor_type > data_type;
+  typedef typename data_type::index_pair index_pair;
+
+  // Create model
+  size_storage model_input_size = {1000, 16};
+  size_type model_output_size = 4;
+  size_type model_dimension = 16;
+  gram_array model_gram = {{1,2,4,8},{}};
+  model_type model(model_input_size, model_output_size, model_dimension,
+                   model_gram);
+  model.initialize(0.0, 1.0);
+
+  // Read all samples and compute the expected output with forward()
+  data_type data("bytesteady/unittest_train.txt", {kBytes, kIndex});
+  ::std::vector< field_array > inputs;
+  ::std::vector< value_array > outputs;
+  field_array input;
+  index_pair label;
+  while (data.getSample(&input, &label) == true) {
+    const tensor_type &output = model.forward(input);
+    inputs.push_back(input);
+    outputs.push_back(value_array(output.data(), output.data() + 4));
+  }
+  EXPECT_EQ(20, inputs.size());
+
+  // Views of the inputs
+  ::std::vector< ::std::vector< field_span > > spans(inputs.size());
+  for (size_type i = 0; i < inputs.size(); ++i) {
+    const byte_array &bytes = ::std::get< byte_array >(inputs[i][0]);
+    const index_array &indices = ::std::get< index_array >(inputs[i][1]);
+    spans[i].push_back(byte_span(bytes.data(), bytes.size()));
+    spans[i].push_back(index_span(indices.data(), indices.size()));
+  }
+
+  P predictor(model);
+  EXPECT_EQ(2, predictor.input_size());
+  EXPECT_EQ(4, predictor.output_size());
+  EXPECT_EQ(16, predictor.dimension());
+  context_type context = predictor.context();
+  for (size_type i = 0; i < inputs.size(); ++i) {
+    const value_array &output = predictor.predict(
+        spans[i].data(), spans[i].size(), &context);
+    for (size_type j = 0; j < 4; ++j) {
+      EXPECT_NEAR(outputs[i][j], output[j], 1e-4);
+    }
+  }
+
+  // No allocation once the context is warm
+  uint64_t count = allocation_count.load();
+  for (size_type i = 0; i < inputs.size(); ++i) {
+    predictor.predict({spans[i][0], spans[i][1]}, &context);
+  }
+  EXPECT_EQ(count, allocation_count.load());
+
+  // A batch of all inputs gives the same scores
+  ::std::vector< const field_span * > batch_input;
+  ::std::vector< size_type > batch_size;
+  for (size_type i = 0; i < inputs.size(); ++i) {
+    batch_input.push_back(spans[i].data());
+    batch_size.push_back(spans[i].size());
+  }
+  const value_array &batch_output = predictor.predict(
+      batch_input.data(), batch_size.data(), inputs.size(), &context);
+  ASSERT_EQ(inputs.size() * 4, batch_output.size());
+  for (size_type i = 0; i < inputs.size(); ++i) {
+    for (size_type j = 0; j < 4; ++j) {
+      EXPECT_NEAR(outputs[i][j], batch_output[i * 4 + j], 1e-4);
+    }
+  }
+  count = allocation_count.load();
+  EXPECT_EQ(4, predictor.predict(
+      spans[0].data(), spans[0].size(), &context).size());
+  EXPECT_EQ(count, allocation_count.load());
+
+  // Concurrent predictions with a context for each thread
+  ::std::vector< ::std::thread > threads;
+  ::std::vector< int > results(4, 1);
+  for (size_type t = 0; t < 4; ++t) {
+    threads.push_back(::std::thread([&, t]() -> void {
+      context_type thread_context = predictor.context();
+      for (size_type k = 0; k < 100; ++k) {
+        for (size_type i = 0; i < inputs.size(); ++i) {
+          const value_array &output = predictor.predict(
+              spans[i].data(), spans[i].size(), &thread_context);
+          for (size_type j = 0; j < 4; ++j) {
+            if (::std::abs(outputs[i][j] - output[j]) > 1e-4) {
+              results[t] = 0;
+            }
+          }
+        }
+      }
+    }));
+  }
+  for (::std::thread &thread : threads) {
+    thread.join();
+  }
+  for (size_type t = 0; t < 4; ++t) {
+    EXPECT_EQ(1, results[t]);
+  }
+}
+
+TEST(PredictorTest, predictTest) {
+  predictTest< DoubleFNVPredictor >();
+  predictTest< FloatCityPredictor >();
+  predictTest< DoubleRollingPredictor >();
+  predictTest< HalfRollingPredictor >();
+  predictTest< QuantFNVPredictor >();
+}
+
+template < typename P >
+void decayTest(bool share) {
+  typedef typename P::context_type context_type;
+  typedef typename P::byte_span byte_span;
+  typedef typename P::index_span index_span;
+  typedef typename P::model_type model_type;
+  typedef typename P::value_array value_array;
+  typedef typename model_type::byte_array byte_array;
+  typedef typename model_type::field_array field_array;
+  typedef typename model_type::gram_array gram_array;
+  typedef typename model_type::index_array index_array;
+  typedef typename model_type::size_storage size_storage;
+  typedef typename model_type::size_type size_type;
+  typedef typename model_type::tensor_type tensor_type;
+  typedef Data< tensor_type > data_type;
+  typedef typename data_type::index_pair index_pair;
+
+  size_storage model_input_size = {1000, 16};
+  gram_array model_gram = {{1,2,4,8},{}};
+  model_type model(model_input_size, 4, 16, model_gram);
+  model.initialize(0.0, 1.0);
+  model.set_lazy_decay(true);
+
+  // Updates with weight decay leave scales pending in the model
+  data_type data("bytesteady/unittest_train.txt", {kBytes, kIndex});
+  ::std::vector< field_array > inputs;
+  field_array input;
+  index_pair label;
+  tensor_type grad_output(4);
+  grad_output.fill(0.1);
+  while (data.getSample(&input, &label) == true) {
+    model.forward(input);
+    model.update(input, grad_output, 0.1, 0.5);
+    inputs.push_back(input);
+  }
+
+  // The predictor sees the decayed parameters
+  P predictor(model, share);
+  context_type context = predictor.context();
+  for (const field_array &sample : inputs) {
+    const byte_array &bytes = ::std::get< byte_array >(sample[0]);
+    const index_array &indices = ::std::get< index_array >(sample[1]);
+    const tensor_type &expected = model.forward(sample);
+    const value_array &output = predictor.predict(
+        {byte_span(bytes.data(), bytes.size()),
+         index_span(indices.data(), indices.size())}, &context);
+    for (size_type j = 0; j < 4; ++j) {
+      EXPECT_NEAR(expected(j), output[j], 1e-4);
+    }
+  }
+}
+
+TEST(PredictorTest, decayTest) {
+  decayTest< DoubleFNVPredictor >(true);
+  decayTest< DoubleFNVPredictor >(false);
+}
+
+}  // namespace
+}  // namespace bytesteady
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/prefetch.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace bytesteady {
+
+template < typename D >
+Prefetch< D >::Prefetch(D *d, size_type r, size_type q) :
+    data_(d), reader_size_(r == 0 ? 1 : r), queue_size_(1), tail_(0),
+    head_(0), active_(0), taken_(0), waiting_(0), drain_(false),
+    parked_(0) {
+  // Round up to a power of 2 so that positions wrap with a mask
+  while (queue_size_ < q) {
+    queue_size_ = queue_size_ * 2;
+  }
+  slots_.reset(new Slot[queue_size_]);
+  for (size_type i = 0; i < queue_size_; ++i) {
+    slots_[i].sequence.store(i, ::std::memory_order_relaxed);
+  }
+}
+
+template < typename D >
+Prefetch< D >::~Prefetch() {
+  join();
+}
+
+template < typename D >
+void Prefetch< D >::start() {
+  join();
+  drain_.store(false);
+  active_.store(reader_size_);
+  for (size_type i = 0; i < reader_size_; ++i) {
+    threads_.push_back(::std::thread(&Prefetch::read, this, i));
+  }
+}
+
+template < typename D >
+void Prefetch< D >::join() {
+  for (::std::thread &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+template < typename D >
+bool Prefetch< D >::getSample(field_array *input, index_pair *label) {
+  // The sample is counted as taken before it leaves the ring, so that
+  // drain() never misses it in between
+  for (size_type i = 0; i < kSpin && active_.load() > 0; ++i) {
+    taken_.fetch_add(1);
+    if (pop(input, label) == true) {
+      notify();
+      return true;
+    }
+    release();
+    ::std::this_thread::yield();
+  }
+  // Sleep until readers push or stop. drain() waits on the same mutex, so
+  // it does not see the count of a failed attempt here.
+  bool result = false;
+  {
+    ::std::unique_lock< ::std::mutex > lock(mutex_);
+    waiting_.fetch_add(1);
+    condition_.wait(lock, [&]() -> bool {
+        bool stopped = active_.load() == 0;
+        taken_.fetch_add(1);
+        // Readers may have filled the last slots before stopping
+        result = pop(input, label);
+        if (result == false) {
+          taken_.fetch_sub(1);
+        }
+        return result == true || stopped == true;
+      });
+    waiting_.fetch_sub(1);
+  }
+  if (result == true) {
+    notify();
+  }
+  return result;
+}
+
+template < typename D >
+void Prefetch< D >::done() {
+  release();
+}
+
+template < typename D >
+void Prefetch< D >::drain(const consumer_type &consume) {
+  {
+    ::std::lock_guard< ::std::mutex > lock(mutex_);
+    drain_.store(true);
+  }
+  field_array input;
+  index_pair label;
+  while (true) {
+    // Take the samples left in the ring like any other consumer
+    if (consume) {
+      taken_.fetch_add(1);
+      if (pop(&input, &label) == true) {
+        notify();
+        consume(&input, &label);
+        release();
+        continue;
+      }
+      taken_.fetch_sub(1);
+    }
+    // Parked readers hold no sample, so the ring empties once consumers took
+    // the rest. The ring is checked before the samples taken.
+    bool drained = false;
+    ::std::unique_lock< ::std::mutex > lock(mutex_);
+    waiting_.fetch_add(1);
+    condition_.wait(lock, [&]() -> bool {
+        bool empty = head_.load() == tail_.load();
+        drained = parked_ == active_.load() && empty == true &&
+            taken_.load() == 0;
+        return drained == true || (consume && empty == false);
+      });
+    waiting_.fetch_sub(1);
+    if (drained == true) {
+      return;
+    }
+  }
+}
+
+template < typename D >
+void Prefetch< D >::resume() {
+  {
+    ::std::lock_guard< ::std::mutex > lock(mutex_);
+    drain_.store(false);
+  }
+  condition_.notify_all();
+}
+
+template < typename D >
+typename Prefetch< D >::size_type Prefetch< D >::reader_size() const {
+  return reader_size_;
+}
+
+template < typename D >
+typename Prefetch< D >::size_type Prefetch< D >::queue_size() const {
+  return queue_size_;
+}
+
+template < typename D >
+void Prefetch< D >::read(size_type reader) {
+  field_array input;
+  index_pair label;
+  size_type shard = reader;
+  while (true) {
+    if (drain_.load() == true) {
+      ::std::unique_lock< ::std::mutex > lock(mutex_);
+      parked_ = parked_ + 1;
+      condition_.notify_all();
+      waiting_.fetch_add(1);
+      condition_.wait(lock, [this]() -> bool {
+          return drain_.load() == false; });
+      waiting_.fetch_sub(1);
+      parked_ = parked_ - 1;
+    }
+    if (data_->getSample(&shard, reader_size_, &input, &label) == false) {
+      break;
+    }
+    // Spin briefly, then sleep until consumers make room
+    bool pushed = push(&input, &label);
+    for (size_type i = 0; i < kSpin && pushed == false; ++i) {
+      ::std::this_thread::yield();
+      pushed = push(&input, &label);
+    }
+    if (pushed == false) {
+      ::std::unique_lock< ::std::mutex > lock(mutex_);
+      waiting_.fetch_add(1);
+      condition_.wait(lock, [&]() -> bool {
+          return push(&input, &label); });
+      waiting_.fetch_sub(1);
+    }
+    notify();
+  }
+  {
+    ::std::lock_guard< ::std::mutex > lock(mutex_);
+    active_.fetch_sub(1);
+  }
+  condition_.notify_all();
+}
+
+template < typename D >
+bool Prefetch< D >::push(field_array *input, index_pair *label) {
+  size_type position = tail_.load(::std::memory_order_relaxed);
+  Slot *slot;
+  while (true) {
+    slot = &slots_[position & (queue_size_ - 1)];
+    size_type sequence = slot->sequence.load(::std::memory_order_acquire);
+    if (sequence == position) {
+      if (tail_.compare_exchange_weak(
+              position, position + 1, ::std::memory_order_relaxed) == true) {
+        break;
+      }
+    } else if (sequence < position) {
+      // The slot still holds a sample from the previous round
+      return false;
+    } else {
+      position = tail_.load(::std::memory_order_relaxed);
+    }
+  }
+  ::std::swap(slot->input, *input);
+  ::std::swap(slot->label, *label);
+  slot->sequence.store(position + 1, ::std::memory_order_release);
+  return true;
+}
+
+template < typename D >
+bool Prefetch< D >::pop(field_array *input, index_pair *label) {
+  size_type position = head_.load(::std::memory_order_relaxed);
+  Slot *slot;
+  while (true) {
+    slot = &slots_[position & (queue_size_ - 1)];
+    size_type sequence = slot->sequence.load(::std::memory_order_acquire);
+    if (sequence == position + 1) {
+      if (head_.compare_exchange_weak(
+              position, position + 1, ::std::memory_order_relaxed) == true) {
+        break;
+      }
+    } else if (sequence < position + 1) {
+      // The slot is not filled yet
+      return false;
+    } else {
+      position = head_.load(::std::memory_order_relaxed);
+    }
+  }
+  ::std::swap(slot->input, *input);
+  ::std::swap(slot->label, *label);
+  slot->sequence.store(position + queue_size_, ::std::memory_order_release);
+  return true;
+}
+
+template < typename D >
+void Prefetch< D >::release() {
+  taken_.fetch_sub(1);
+  if (drain_.load() == true) {
+    notify();
+  }
+}
+
+template < typename D >
+void Prefetch< D >::notify() {
+  // Order the ring update before reading waiting_, pairing with waiters that
+  // count themselves before checking the ring
+  ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+  if (waiting_.load() > 0) {
+    ::std::lock_guard< ::std::mutex > lock(mutex_);
+    condition_.notify_all();
+  }
+}
+
+}  // namespace bytesteady
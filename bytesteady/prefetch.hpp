@@ -0,0 +1,130 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_PREFETCH_HPP_
+#define BYTESTEADY_PREFETCH_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bytesteady/data.hpp"
+
+namespace bytesteady {
+
+/*
+ * Read-ahead of samples by dedicated reader threads. Readers parse samples
+ * from their own data shards into a bounded lock-free ring of slots, and any
+ * number of consumers take them out. Samples are exchanged with the slots by
+ * swapping, so the buffers a consumer hands back are reused by the readers
+ * and the steady state makes no allocations.
+ *
+ * Samples come out in the order readers finish parsing them. Samples in the
+ * ring are already counted in the data offsets, so a checkpoint must call
+ * drain() first to have every sample counted also taken out and used. The
+ * caller of drain() takes the samples left in the ring itself, since the
+ * other consumers may be waiting for it. Both
+ * readers and consumers spin briefly on a full or empty ring and then sleep
+ * on a condition variable.
+ */
+template < typename D = Data<> >
+class Prefetch {
+ public:
+  typedef D data_type;
+  typedef typename D::field_array field_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+  typedef ::std::function< void (field_array *, index_pair *) > consumer_type;
+
+  // Read d with r reader threads into a ring of at least q slots
+  Prefetch(D *d, size_type r = 1, size_type q = 1024);
+  // Wait for the reader threads
+  ~Prefetch();
+
+  // Start the reader threads. They stop after their last shard.
+  void start();
+  void join();
+
+  // Get a sample read ahead, waiting for readers if the ring is empty. The
+  // previous contents of input and label are recycled by the readers. Returns
+  // false once all readers stopped and the ring is empty. Call done() once a
+  // sample returned is used.
+  bool getSample(field_array *input, index_pair *label);
+  void done();
+
+  // Park the readers before their next sample and wait until the ring is
+  // empty and every sample taken out is done. Samples still in the ring are
+  // passed to consume, or left to the other consumers if it is empty.
+  void drain(const consumer_type &consume = consumer_type());
+  // Let parked readers continue
+  void resume();
+
+  size_type reader_size() const;
+  size_type queue_size() const;
+
+ private:
+  struct Slot {
+    // Position the slot is ready for. A reader can fill the slot at position
+    // p when sequence is p, and a consumer can take it when sequence is p + 1.
+    ::std::atomic< size_type > sequence;
+    field_array input;
+    index_pair label;
+  };
+
+  // Foreign object pointer
+  D *data_;
+
+  size_type reader_size_;
+  size_type queue_size_;
+  ::std::unique_ptr< Slot[] > slots_;
+  // Positions of the next slot to fill and to take, on their own cache lines
+  alignas(64) ::std::atomic< size_type > tail_;
+  alignas(64) ::std::atomic< size_type > head_;
+  alignas(64) ::std::atomic< size_type > active_;
+  // Samples taken out of the ring and not done yet
+  alignas(64) ::std::atomic< size_type > taken_;
+
+  // Sleeping state. Threads count themselves in waiting_ while they wait on
+  // condition_, so that the others only take the mutex to notify them then.
+  ::std::atomic< size_type > waiting_;
+  ::std::atomic< bool > drain_;
+  size_type parked_;
+  ::std::mutex mutex_;
+  ::std::condition_variable condition_;
+
+  // Thread container
+  ::std::vector< ::std::thread > threads_;
+
+  // Attempts on a full or empty ring before sleeping
+  static constexpr size_type kSpin = 64;
+
+  void read(size_type reader);
+  bool push(field_array *input, index_pair *label);
+  bool pop(field_array *input, index_pair *label);
+  void release();
+  void notify();
+};
+
+}  // namespace bytesteady
+
+namespace bytesteady {
+// Pre-compiled template class instantiation
+extern template class Prefetch< DoubleData >;
+extern template class Prefetch< FloatData >;
+}  // namespace bytesteady
+
+#endif  // BYTESTEADY_PREFETCH_HPP_
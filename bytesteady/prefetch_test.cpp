@@ -0,0 +1,143 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/prefetch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "bytesteady/data.hpp"
+#include "gtest/gtest.h"
+
+namespace bytesteady {
+namespace {
+
+template < typename D >
+void getSampleTest() {
+  typedef typename D::byte_array byte_array;
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+  typedef ::std::pair< size_type, size_type > sample_key;
+
+  ::std::string file = "bytesteady/unittest_train.txt";
+  format_array format = {kBytes, kIndex};
+
+  // Samples read directly, identified by label and byte length
+  D data(file, format, 3);
+  ASSERT_TRUE(data.rewind());
+  ::std::vector< sample_key > expected;
+  field_array input;
+  index_pair label;
+  while (data.getSample(&input, &label) == true) {
+    expected.push_back(::std::make_pair(
+        label.first, ::std::get< byte_array >(input[0]).size()));
+  }
+  ::std::sort(expected.begin(), expected.end());
+  ASSERT_LT(0, expected.size());
+
+  // Every sample comes out once with more consumers than slots, and again
+  // after rewinding with the buffers recycled from the first pass
+  Prefetch< D > prefetch(&data, 2, 3);
+  EXPECT_EQ(2, prefetch.reader_size());
+  EXPECT_EQ(4, prefetch.queue_size());
+  for (int pass = 0; pass < 2; ++pass) {
+    ASSERT_TRUE(data.rewind());
+    ::std::vector< sample_key > samples;
+    ::std::mutex samples_mutex;
+    prefetch.start();
+    ::std::vector< ::std::thread > consumers;
+    for (int i = 0; i < 3; ++i) {
+      consumers.push_back(::std::thread([&]() -> void {
+          field_array consumer_input;
+          index_pair consumer_label;
+          while (prefetch.getSample(
+                     &consumer_input, &consumer_label) == true) {
+            ::std::lock_guard< ::std::mutex > lock(samples_mutex);
+            samples.push_back(::std::make_pair(
+                consumer_label.first, ::std::get< byte_array >(
+                    consumer_input[0]).size()));
+          }}));
+    }
+    for (::std::thread &consumer : consumers) {
+      consumer.join();
+    }
+    prefetch.join();
+    ::std::sort(samples.begin(), samples.end());
+    EXPECT_EQ(expected, samples);
+  }
+}
+
+TEST(PrefetchTest, getSampleTest) {
+  getSampleTest< DoubleData >();
+  getSampleTest< FloatData >();
+}
+
+template < typename D >
+void drainTest() {
+  typedef typename D::field_array field_array;
+  typedef typename D::format_array format_array;
+  typedef typename D::index_pair index_pair;
+  typedef typename D::size_type size_type;
+
+  D data("bytesteady/unittest_train.txt", format_array{kBytes, kIndex}, 3);
+  ASSERT_TRUE(data.rewind());
+  Prefetch< D > prefetch(&data, 2, 4);
+  prefetch.start();
+  // Slow consumers leave samples in the ring when drain() is called
+  size_type consumed = 0;
+  ::std::mutex consumed_mutex;
+  ::std::vector< ::std::thread > consumers;
+  for (int i = 0; i < 2; ++i) {
+    consumers.push_back(::std::thread([&]() -> void {
+        field_array input;
+        index_pair label;
+        while (prefetch.getSample(&input, &label) == true) {
+          ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+          {
+            ::std::lock_guard< ::std::mutex > lock(consumed_mutex);
+            consumed = consumed + 1;
+          }
+          prefetch.done();
+        }}));
+  }
+  ::std::this_thread::sleep_for(::std::chrono::milliseconds(3));
+  // Every sample counted by the data is done after draining
+  prefetch.drain();
+  {
+    ::std::lock_guard< ::std::mutex > lock(consumed_mutex);
+    EXPECT_EQ(data.count(), consumed);
+    EXPECT_GT(20, consumed);
+  }
+  prefetch.resume();
+  for (::std::thread &consumer : consumers) {
+    consumer.join();
+  }
+  prefetch.join();
+  EXPECT_EQ(20, consumed);
+  EXPECT_EQ(20, data.count());
+}
+
+TEST(PrefetchTest, drainTest) {
+  drainTest< DoubleData >();
+  drainTest< FloatData >();
+}
+
+}  // namespace
+}  // namespace bytesteady
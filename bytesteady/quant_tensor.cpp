@@ -0,0 +1,350 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/quant_tensor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "bytesteady/integer.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/serializer/binary_protocol.hpp"
+#include "thunder/serializer/serializer.hpp"
+#include "thunder/serializer/static.hpp"
+#include "thunder/serializer/text_protocol.hpp"
+#include "thunder/tensor.hpp"
+
+#include "thunder/serializer/binary_protocol-inl.hpp"
+#include "thunder/serializer/serializer-inl.hpp"
+#include "thunder/serializer/static-inl.hpp"
+#include "thunder/serializer/text_protocol-inl.hpp"
+
+namespace bytesteady {
+
+namespace {
+
+template < typename P >
+::std::shared_ptr< P > allocate(QuantTensor::size_type n) {
+  ::std::shared_ptr< P > storage(
+      new P[n == 0 ? 1 : n], ::std::default_delete< P[] >());
+  ::std::fill(storage.get(), storage.get() + n, P(0));
+  return storage;
+}
+
+QuantTensor::size_type codeBytes(QuantTensor::size_type m,
+                                 QuantTensor::size_type b) {
+  return b == 4 ? (m + 1) / 2 : m;
+}
+
+template < typename X >
+void quantizeRow(const QuantTensor &q, QuantTensor::size_type r,
+                 const X *x) {
+  typedef QuantTensor::size_type size_type;
+  size_type columns = q.size(1);
+  int max_code = q.bits() == 4 ? 7 : 127;
+  double max_value = 0.0;
+  for (size_type j = 0; j < columns; ++j) {
+    max_value = ::std::max(max_value, ::std::abs(static_cast< double >(x[j])));
+  }
+  float scale = static_cast< float >(max_value / max_code);
+  double inverse = scale > 0.0f ? 1.0 / scale : 0.0;
+  *q.scale(r) = scale;
+  int8_t *row = q.codes(r);
+  if (q.bits() == 4) {
+    ::std::fill(row, row + codeBytes(columns, 4), 0);
+  }
+  for (size_type j = 0; j < columns; ++j) {
+    long code = ::std::lround(static_cast< double >(x[j]) * inverse);
+    code = ::std::min< long >(::std::max< long >(code, -max_code), max_code);
+    if (q.bits() == 4) {
+      uint8_t nibble = static_cast< uint8_t >(code) & 0x0f;
+      row[j / 2] = static_cast< int8_t >(static_cast< uint8_t >(row[j / 2]) |
+                                         (j % 2 == 0 ? nibble : nibble << 4));
+    } else {
+      row[j] = static_cast< int8_t >(code);
+    }
+  }
+}
+
+template < typename X >
+void dequantizeRow(const QuantTensor &q, QuantTensor::size_type r, X *x) {
+  typedef QuantTensor::size_type size_type;
+  float scale = *q.scale(r);
+  const int8_t *row = q.codes(r);
+  for (size_type j = 0; j < q.size(1); ++j) {
+    int code;
+    if (q.bits() == 4) {
+      // Sign-extend the nibble
+      int nibble = (static_cast< uint8_t >(row[j / 2]) >> (j % 2 * 4)) & 0x0f;
+      code = (nibble ^ 0x08) - 0x08;
+    } else {
+      code = row[j];
+    }
+    x[j] = static_cast< X >(code * scale);
+  }
+}
+
+template < typename T >
+void copyRows(const QuantTensor &q, const T &t, QuantTensor::size_type r) {
+  typedef typename T::value_type value_type;
+  typedef QuantTensor::size_type size_type;
+  size_type rows = ::std::min(t.size(0), q.size(0) - r);
+  ::std::vector< value_type > row(q.size(1), 0);
+  for (size_type i = 0; i < rows; ++i) {
+    const value_type *source = t.data() + i * t.stride(0);
+    for (size_type j = 0; j < ::std::min(t.size(1), q.size(1)); ++j) {
+      row[j] = source[j * t.stride(1)];
+    }
+    quantizeRow(q, r + i, row.data());
+  }
+}
+
+template < typename T >
+void getRows(const QuantTensor &q, const T &t, QuantTensor::size_type r) {
+  typedef typename T::value_type value_type;
+  typedef QuantTensor::size_type size_type;
+  size_type rows = ::std::min(t.size(0), q.size(0) - r);
+  ::std::vector< value_type > row(q.size(1));
+  for (size_type i = 0; i < rows; ++i) {
+    dequantizeRow(q, r + i, row.data());
+    value_type *target = t.data() + i * t.stride(0);
+    for (size_type j = 0; j < ::std::min(t.size(1), q.size(1)); ++j) {
+      target[j * t.stride(1)] = row[j];
+    }
+  }
+}
+
+}  // namespace
+
+QuantTensor::QuantTensor() :
+    rows_(0), columns_(0), bits_(8), storage_(allocate< int8_t >(0)) {}
+
+QuantTensor::QuantTensor(size_type n, size_type m, size_type b) :
+    rows_(n), columns_(m), bits_(b == 4 ? 4 : 8),
+    storage_(allocate< int8_t >(n * rowSize(m, bits_))) {}
+
+QuantTensor::QuantTensor(const size_storage &sz, size_type b) :
+    QuantTensor(sz.size() > 0 ? sz[0] : 0, sz.size() > 1 ? sz[1] : 1, b) {}
+
+QuantTensor::QuantTensor(const size_storage &sz, size_type b,
+                         const storage_pointer &s) :
+    rows_(sz.size() > 0 ? sz[0] : 0), columns_(sz.size() > 1 ? sz[1] : 1),
+    bits_(b == 4 ? 4 : 8), storage_(s) {}
+
+QuantTensor::size_type QuantTensor::rowSize(size_type m, size_type b) {
+  // Pad the codes so that the scale of the next row stays aligned
+  size_type codes = codeBytes(m, b == 4 ? 4 : 8);
+  return sizeof(float) + (codes + sizeof(float) - 1) / sizeof(float) *
+      sizeof(float);
+}
+
+QuantTensor::size_type QuantTensor::bits() const {
+  return bits_;
+}
+
+QuantTensor::size_type QuantTensor::dimension() const {
+  return 2;
+}
+
+QuantTensor::size_storage QuantTensor::size() const {
+  return size_storage{rows_, columns_};
+}
+
+QuantTensor::size_type QuantTensor::size(size_type d) const {
+  return d == 0 ? rows_ : columns_;
+}
+
+QuantTensor::difference_type QuantTensor::stride(size_type d) const {
+  return d == 0 ? rowSize(columns_, bits_) : 1;
+}
+
+int8_t *QuantTensor::data() const {
+  return storage_.get();
+}
+
+int8_t *QuantTensor::codes(size_type r) const {
+  return storage_.get() + r * rowSize(columns_, bits_) + sizeof(float);
+}
+
+float *QuantTensor::scale(size_type r) const {
+  return reinterpret_cast< float * >(
+      storage_.get() + r * rowSize(columns_, bits_));
+}
+
+const QuantTensor::storage_pointer &QuantTensor::storage() const {
+  return storage_;
+}
+
+const QuantTensor &QuantTensor::copy(const QuantTensor &t) const {
+  if (bits_ == t.bits() && columns_ == t.size(1)) {
+    // Rows of the same layout are copied exactly without requantizing
+    size_type rows = ::std::min(rows_, t.size(0));
+    ::std::copy(t.data(), t.data() + rows * stride(0), data());
+    return *this;
+  }
+  ::std::vector< float > row(::std::max(columns_, t.size(1)), 0.0f);
+  for (size_type i = 0; i < ::std::min(rows_, t.size(0)); ++i) {
+    t.dequantize(i, row.data());
+    quantize(i, row.data());
+  }
+  return *this;
+}
+
+const QuantTensor &QuantTensor::copy(
+    const ::thunder::DoubleTensor &t, size_type r) const {
+  copyRows(*this, t, r);
+  return *this;
+}
+
+const QuantTensor &QuantTensor::copy(
+    const ::thunder::FloatTensor &t, size_type r) const {
+  copyRows(*this, t, r);
+  return *this;
+}
+
+void QuantTensor::get(const ::thunder::DoubleTensor &t, size_type r) const {
+  getRows(*this, t, r);
+}
+
+void QuantTensor::get(const ::thunder::FloatTensor &t, size_type r) const {
+  getRows(*this, t, r);
+}
+
+void QuantTensor::quantize(size_type r, const double *x) const {
+  quantizeRow(*this, r, x);
+}
+
+void QuantTensor::quantize(size_type r, const float *x) const {
+  quantizeRow(*this, r, x);
+}
+
+void QuantTensor::dequantize(size_type r, double *x) const {
+  dequantizeRow(*this, r, x);
+}
+
+void QuantTensor::dequantize(size_type r, float *x) const {
+  dequantizeRow(*this, r, x);
+}
+
+double QuantTensor::mean() const {
+  ::std::vector< double > row(columns_);
+  double sum = 0.0;
+  for (size_type i = 0; i < rows_; ++i) {
+    dequantize(i, row.data());
+    for (double value : row) {
+      sum = sum + value;
+    }
+  }
+  return rows_ * columns_ == 0 ? 0.0 : sum / (rows_ * columns_);
+}
+
+double QuantTensor::std() const {
+  ::std::vector< double > row(columns_);
+  double mu = mean();
+  double sum = 0.0;
+  for (size_type i = 0; i < rows_; ++i) {
+    dequantize(i, row.data());
+    for (double value : row) {
+      sum = sum + (value - mu) * (value - mu);
+    }
+  }
+  return rows_ * columns_ == 0 ? 0.0 : ::std::sqrt(sum / (rows_ * columns_));
+}
+
+double QuantTensor::min() const {
+  ::std::vector< double > row(columns_);
+  double result = ::std::numeric_limits< double >::infinity();
+  for (size_type i = 0; i < rows_; ++i) {
+    dequantize(i, row.data());
+    for (double value : row) {
+      result = ::std::min(result, value);
+    }
+  }
+  return result;
+}
+
+double QuantTensor::max() const {
+  ::std::vector< double > row(columns_);
+  double result = -::std::numeric_limits< double >::infinity();
+  for (size_type i = 0; i < rows_; ++i) {
+    dequantize(i, row.data());
+    for (double value : row) {
+      result = ::std::max(result, value);
+    }
+  }
+  return result;
+}
+
+}  // namespace bytesteady
+
+namespace thunder {
+namespace serializer {
+
+template < typename S >
+void save(S *s, const ::bytesteady::QuantTensor &t) {
+  typedef ::bytesteady::QuantTensor::size_type size_type;
+  s->save(t.size(0));
+  s->save(t.size(1));
+  s->save(t.bits());
+  // Each row is its scale and codes, without padding
+  size_type code_size = ::bytesteady::codeBytes(t.size(1), t.bits());
+  for (size_type i = 0; i < t.size(0); ++i) {
+    s->save(*t.scale(i));
+    const int8_t *codes = t.codes(i);
+    for (size_type j = 0; j < code_size; ++j) {
+      s->save(static_cast< uint8_t >(codes[j]));
+    }
+  }
+}
+
+template < typename S >
+void load(S *s, ::bytesteady::QuantTensor *t) {
+  typedef ::bytesteady::QuantTensor::size_type size_type;
+  size_type rows;
+  size_type columns;
+  size_type bits;
+  s->load(&rows);
+  s->load(&columns);
+  s->load(&bits);
+  *t = ::bytesteady::QuantTensor(rows, columns, bits);
+  size_type code_size = ::bytesteady::codeBytes(columns, t->bits());
+  uint8_t code;
+  for (size_type i = 0; i < rows; ++i) {
+    s->load(t->scale(i));
+    int8_t *codes = t->codes(i);
+    for (size_type j = 0; j < code_size; ++j) {
+      s->load(&code);
+      codes[j] = static_cast< int8_t >(code);
+    }
+  }
+}
+
+// Template serializer instantiation
+#define BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(S)         \
+  template void save(S *s, const ::bytesteady::QuantTensor &t);  \
+  template void S::save(const ::bytesteady::QuantTensor &t);     \
+  template void load(S *s, ::bytesteady::QuantTensor *t);        \
+  template void S::load(::bytesteady::QuantTensor *t);
+
+BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(StringBinarySerializer);
+BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(FileBinarySerializer);
+BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(StringTextSerializer);
+BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(FileTextSerializer);
+
+#undef BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE
+
+}  // namespace serializer
+}  // namespace thunder
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_QUANT_TENSOR_HPP_
+#define BYTESTEADY_QUANT_TENSOR_HPP_
+
+#include <memory>
+
+#include "bytesteady/integer.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+
+/*
+ * Matrix of quantized values used to store input embeddings of trained
+ * models. Each row has a float scale and signed integer codes of 8 or 4 bits,
+ * so that a value equals its code times the scale of its row. The scale maps
+ * the largest magnitude of the row to the largest code, and codes are rounded
+ * to nearest. 4-bit codes are packed two to a byte with the lower nibble
+ * first. A row is stored as its scale followed by its codes, padded to the
+ * alignment of the scale, so that a lookup touches one span of memory. Like
+ * thunder tensors, copies share the same storage and the const methods modify
+ * the values.
+ */
+class QuantTensor {
+ public:
+  typedef int8_t value_type;
+  typedef ::std::size_t size_type;
+  typedef ::std::ptrdiff_t difference_type;
+  typedef ::thunder::SizeStorage size_storage;
+  typedef ::std::shared_ptr< int8_t > storage_pointer;
+
+  QuantTensor();
+  // Matrix of n rows and m columns with b bits for each code, set to zero
+  QuantTensor(size_type n, size_type m, size_type b = 8);
+  explicit QuantTensor(const size_storage &sz, size_type b = 8);
+  // Matrix viewing existing rows that are kept alive by the pointer
+  QuantTensor(const size_storage &sz, size_type b, const storage_pointer &s);
+
+  // Bytes of a row with m columns of b-bit codes, including its scale
+  static size_type rowSize(size_type m, size_type b);
+
+  size_type bits() const;
+  size_type dimension() const;
+  size_storage size() const;
+  size_type size(size_type d) const;
+  // Stride of rows is in bytes, including the scale
+  difference_type stride(size_type d) const;
+  int8_t *data() const;
+  // Codes and scale of row r
+  int8_t *codes(size_type r) const;
+  float *scale(size_type r) const;
+  const storage_pointer &storage() const;
+
+  // Copy values from a matrix of the same size, requantizing them only if
+  // the number of bits or columns differ
+  const QuantTensor &copy(const QuantTensor &t) const;
+  // Quantize the rows of t into rows starting at r
+  const QuantTensor &copy(const ::thunder::DoubleTensor &t,
+                          size_type r = 0) const;
+  const QuantTensor &copy(const ::thunder::FloatTensor &t,
+                          size_type r = 0) const;
+  // Dequantize rows starting at r into t
+  void get(const ::thunder::DoubleTensor &t, size_type r = 0) const;
+  void get(const ::thunder::FloatTensor &t, size_type r = 0) const;
+
+  // Quantize contiguous values into row r
+  void quantize(size_type r, const double *x) const;
+  void quantize(size_type r, const float *x) const;
+  // Dequantize row r into contiguous values
+  void dequantize(size_type r, double *x) const;
+  void dequantize(size_type r, float *x) const;
+
+  // Statistics of dequantized values for logging
+  double mean() const;
+  double std() const;
+  double min() const;
+  double max() const;
+
+ private:
+  size_type rows_;
+  size_type columns_;
+  size_type bits_;
+  storage_pointer storage_;
+};
+
+}  // namespace bytesteady
+
+namespace thunder {
+namespace serializer {
+
+template < typename S >
+void save(S *s, const ::bytesteady::QuantTensor &t);
+
+template < typename S >
+void load(S *s, ::bytesteady::QuantTensor *t);
+
+// Pre-compiled template serializer instantiation
+#define BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(S)         \
+  extern template void save(                                     \
+      S *s, const ::bytesteady::QuantTensor &t);                 \
+  extern template void S::save(const ::bytesteady::QuantTensor &t); \
+  extern template void load(S *s, ::bytesteady::QuantTensor *t); \
+  extern template void S::load(::bytesteady::QuantTensor *t);
+
+BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(StringBinarySerializer);
+BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(FileBinarySerializer);
+BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(StringTextSerializer);
+BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE(FileTextSerializer);
+
+#undef BYTESTEADY_QUANT_TENSOR_INSTANTIATE_SERIALIZE
+
+}  // namespace serializer
+}  // namespace thunder
+
+#endif  // BYTESTEADY_QUANT_TENSOR_HPP_
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/quant_tensor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "thunder/random.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+namespace {
+
+TEST(QuantTensorTest, quantizeTest) {
+  for (QuantTensor::size_type bits : {8, 4}) {
+    QuantTensor q(3, 7, bits);
+    EXPECT_EQ(bits, q.bits());
+    // Rows are the scale followed by the codes padded to 4 bytes
+    EXPECT_EQ(bits == 8 ? 12 : 8, q.stride(0));
+    EXPECT_EQ(q.data() + q.stride(0),
+              reinterpret_cast< int8_t * >(q.scale(1)));
+    EXPECT_EQ(q.data() + q.stride(0) + sizeof(float), q.codes(1));
+    // The largest magnitude maps to the largest code exactly
+    float x[7] = {0.5f, -2.0f, 1.0f, 0.0f, 0.25f, -0.75f, 1.5f};
+    q.quantize(1, x);
+    EXPECT_FLOAT_EQ(2.0f / (bits == 8 ? 127 : 7), *q.scale(1));
+    float y[7];
+    q.dequantize(1, y);
+    EXPECT_FLOAT_EQ(-2.0f, y[1]);
+    for (int j = 0; j < 7; ++j) {
+      EXPECT_LE(::std::abs(x[j] - y[j]), *q.scale(1) / 2 + 1e-6f);
+    }
+    // Other rows are untouched and a zero row has zero scale
+    q.dequantize(0, y);
+    EXPECT_EQ(0.0f, *q.scale(0));
+    EXPECT_EQ(0.0f, *::std::max_element(y, y + 7));
+    EXPECT_EQ(0.0f, *::std::min_element(y, y + 7));
+  }
+}
+
+template < typename T >
+void copyGetTest(QuantTensor::size_type bits) {
+  typedef typename T::size_type size_type;
+  ::thunder::Random< T > random;
+
+  T t = random.normal(T(7, 5), 0.0, 1.0);
+  QuantTensor q(10, 5, bits);
+  EXPECT_EQ(2, q.dimension());
+  EXPECT_EQ(10, q.size(0));
+  EXPECT_EQ(5, q.size(1));
+  EXPECT_EQ(0.0, q.mean());
+
+  // Copy rows starting at 2 and dequantize them back
+  q.copy(t, 2);
+  T u(7, 5);
+  u.fill(0.0);
+  q.get(u, 2);
+  for (size_type i = 0; i < 7; ++i) {
+    for (size_type j = 0; j < 5; ++j) {
+      EXPECT_LE(::std::abs(t(i, j) - u(i, j)), *q.scale(i + 2) / 2 + 1e-6);
+    }
+  }
+  // Rows outside the copy are still zero
+  for (size_type j = 0; j < 2 * static_cast< size_type >(q.stride(0)); ++j) {
+    EXPECT_EQ(0, q.data()[j]);
+  }
+
+  // Copies share storage while copy() duplicates codes and scales
+  QuantTensor shared = q;
+  QuantTensor duplicate = QuantTensor(q.size(), bits).copy(q);
+  EXPECT_EQ(*q.scale(4), *duplicate.scale(4));
+  for (size_type j = 0; j < static_cast< size_type >(q.stride(0)); ++j) {
+    EXPECT_EQ(q.data()[4 * q.stride(0) + j],
+              duplicate.data()[4 * q.stride(0) + j]);
+  }
+  *q.scale(0) = 1.0f;
+  q.codes(0)[0] = 3;
+  EXPECT_EQ(3, shared.codes(0)[0]);
+  EXPECT_EQ(0, duplicate.codes(0)[0]);
+  EXPECT_LE(3.0, q.max());
+}
+
+TEST(QuantTensorTest, copyGetTest) {
+  copyGetTest< ::thunder::DoubleTensor >(8);
+  copyGetTest< ::thunder::FloatTensor >(8);
+  copyGetTest< ::thunder::DoubleTensor >(4);
+  copyGetTest< ::thunder::FloatTensor >(4);
+}
+
+TEST(QuantTensorTest, saveLoadTest) {
+  ::thunder::Random< ::thunder::FloatTensor > random;
+  for (QuantTensor::size_type bits : {8, 4}) {
+    QuantTensor q1(9, 5, bits);
+    q1.copy(random.normal(::thunder::FloatTensor(9, 5), 0.0, 1.0));
+
+    ::thunder::StringBinarySerializer serializer;
+    serializer.save(q1);
+    QuantTensor q2;
+    serializer.load(&q2);
+    ASSERT_EQ(q1.size(0), q2.size(0));
+    ASSERT_EQ(q1.size(1), q2.size(1));
+    ASSERT_EQ(q1.bits(), q2.bits());
+    for (::std::size_t i = 0; i < 9; ++i) {
+      EXPECT_EQ(*q1.scale(i), *q2.scale(i));
+    }
+    for (::std::size_t i = 0; i < 9 * q1.stride(0); ++i) {
+      EXPECT_EQ(q1.data()[i], q2.data()[i]);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace bytesteady
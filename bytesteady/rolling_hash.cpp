@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/rolling_hash.hpp"
+
+#include <stdint.h>
+
+static const uint64_t kBaseSalt = 0x9e3779b97f4a7c15ULL;
+static const uint64_t kLengthSalt = 0xc2b2ae3d27d4eb4fULL;
+
+// Finalizer from MurmurHash3, to spread the weak low bits of the polynomial
+static uint64_t fmix64(uint64_t k) {
+  k = k ^ (k >> 33);
+  k = k * 0xff51afd7ed558ccdULL;
+  k = k ^ (k >> 33);
+  k = k * 0xc4ceb9fe1a85ec53ULL;
+  k = k ^ (k >> 33);
+  return k;
+}
+
+// The base must be odd to be invertible modulo 2^64
+static uint64_t base64(uint64_t seed) {
+  return fmix64(seed ^ kBaseSalt) | 1ULL;
+}
+
+static uint64_t finalize64(uint64_t hash, uint64_t len, uint64_t seed) {
+  return fmix64(hash ^ fmix64(seed + len * kLengthSalt));
+}
+
+namespace bytesteady {
+
+// Polynomial hash in 64 bit, sum of (s[i] + 1) * base^(len - 1 - i)
+uint64_t RollingHash::hash64(const uint8_t *s, uint64_t len, uint64_t seed) {
+  uint64_t base = base64(seed);
+  uint64_t hash = 0;
+  for (uint64_t i = 0; i < len; ++i) {
+    hash = hash * base + static_cast< uint64_t >(s[i]) + 1;
+  }
+  return finalize64(hash, len, seed);
+}
+
+void RollingHash::reset(const uint8_t *s, uint64_t len, uint64_t seed) {
+  // Powers of base only change with seed, so they are kept across samples
+  if (seed != seed_ || power_.size() == 0) {
+    seed_ = seed;
+    base_ = base64(seed);
+    power_.assign(1, 1);
+  }
+  while (power_.size() <= len) {
+    power_.push_back(power_.back() * base_);
+  }
+  prefix_.resize(len + 1);
+  prefix_[0] = 0;
+  for (uint64_t i = 0; i < len; ++i) {
+    prefix_[i + 1] = prefix_[i] * base_ + static_cast< uint64_t >(s[i]) + 1;
+  }
+}
+
+uint64_t RollingHash::gram64(uint64_t pos, uint64_t len) const {
+  return finalize64(
+      prefix_[pos + len] - prefix_[pos] * power_[len], len, seed_);
+}
+
+}  // namespace bytesteady
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_ROLLING_HASH_HPP_
+#define BYTESTEADY_ROLLING_HASH_HPP_
+
+#include <vector>
+
+#include "bytesteady/integer.hpp"
+
+namespace bytesteady {
+
+/*
+ * Polynomial rolling hash. reset() computes prefix hashes of a byte sequence
+ * in one pass, after which the hash of any n-gram is obtained in constant
+ * time regardless of its length. gram64(pos, len) equals hash64() on the same
+ * bytes, so the result does not depend on how it was computed.
+ */
+class RollingHash {
+ public:
+  typedef ::std::vector< uint64_t > value_array;
+
+  static uint64_t hash64(const uint8_t *s, uint64_t len, uint64_t seed);
+
+  // Set the byte sequence to hash n-grams from
+  void reset(const uint8_t *s, uint64_t len, uint64_t seed);
+  // Hash of the n-gram of length len starting at pos of the sequence
+  uint64_t gram64(uint64_t pos, uint64_t len) const;
+
+ private:
+  uint64_t seed_ = 0;
+  uint64_t base_ = 0;
+  value_array prefix_;
+  value_array power_;
+};
+
+}  // namespace bytesteady
+
+#endif  // BYTESTEADY_ROLLING_HASH_HPP_
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/rolling_hash.hpp"
+
+#include <vector>
+
+#include "bytesteady/integer.hpp"
+#include "gtest/gtest.h"
+
+namespace bytesteady {
+namespace {
+
+TEST(RollingHashTest, gramTest) {
+  ::std::vector< uint8_t > bytes = {
+    22, 0, 255, 4, 9, 88, 126, 30, 0, 0, 0, 0, 22, 0, 255, 4, 9, 88};
+  RollingHash hash;
+  for (uint64_t seed : {1946, 1947}) {
+    hash.reset(bytes.data(), bytes.size(), seed);
+    for (uint64_t g = 1; g <= bytes.size(); ++g) {
+      for (uint64_t j = 0; j + g <= bytes.size(); ++j) {
+        EXPECT_EQ(RollingHash::hash64(&bytes[j], g, seed), hash.gram64(j, g));
+      }
+    }
+  }
+  // Identical n-grams at different positions have the same hash
+  hash.reset(bytes.data(), bytes.size(), 1946);
+  EXPECT_EQ(hash.gram64(0, 6), hash.gram64(12, 6));
+  // Zero bytes of different lengths do not collide
+  EXPECT_NE(hash.gram64(8, 1), hash.gram64(8, 2));
+  EXPECT_NE(hash.gram64(8, 2), hash.gram64(9, 3));
+  // Seed changes the hash
+  EXPECT_NE(RollingHash::hash64(bytes.data(), 4, 1946),
+            RollingHash::hash64(bytes.data(), 4, 1947));
+}
+
+}  // namespace
+}  // namespace bytesteady
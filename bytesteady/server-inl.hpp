@@ -0,0 +1,454 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/server.hpp"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bytesteady/field_format.hpp"
+
+namespace bytesteady {
+
+template < typename P >
+Server< P >::Connection::~Connection() {
+  ::close(fd);
+}
+
+template < typename P >
+Server< P >::Server(const P *p, const ::std::string &path, uint16_t port,
+                    size_type t, size_type b) :
+    predictor_(p), path_(path), port_(port), thread_size_(t == 0 ? 1 : t),
+    batch_size_(b == 0 ? 1 : b), listen_fd_(-1), epoll_fd_(-1),
+    event_fd_(-1), stop_(false), count_(0) {}
+
+template < typename P >
+Server< P >::~Server() {
+  stop();
+  close();
+}
+
+template < typename P >
+bool Server< P >::run() {
+  if (listen() == false) {
+    close();
+    return false;
+  }
+  for (size_type i = 0; i < thread_size_; ++i) {
+    threads_.push_back(::std::thread(&Server::job, this));
+  }
+
+  // Accept connections and read requests until stopped
+  const int max_events = 64;
+  struct epoll_event events[max_events];
+  while (stop_ == false) {
+    int n = ::epoll_wait(epoll_fd_, events, max_events, -1);
+    if (n < 0 && errno != EINTR) {
+      break;
+    }
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == listen_fd_) {
+        accept();
+      } else if (fd != event_fd_) {
+        typename ::std::unordered_map<
+          int, ::std::shared_ptr< Connection > >::iterator iterator =
+              connections_.find(fd);
+        if (iterator != connections_.end() &&
+            receive(iterator->second) == false) {
+          // Workers may still hold the connection to respond
+          ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+          connections_.erase(iterator);
+        }
+      }
+    }
+  }
+
+  // Let workers drain the queue and exit
+  stop_ = true;
+  queue_condition_.notify_all();
+  for (::std::thread &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  close();
+  return true;
+}
+
+template < typename P >
+void Server< P >::stop() {
+  stop_ = true;
+  if (event_fd_ >= 0) {
+    uint64_t value = 1;
+    if (::write(event_fd_, &value, sizeof(value)) < 0) {
+      // The loop wakes up anyway if the counter is already set
+    }
+  }
+  queue_condition_.notify_all();
+  space_condition_.notify_all();
+}
+
+template < typename P >
+typename Server< P >::size_type Server< P >::count() const {
+  return count_;
+}
+
+template < typename P >
+const ::std::string &Server< P >::path() const {
+  return path_;
+}
+
+template < typename P >
+uint16_t Server< P >::port() const {
+  return port_;
+}
+
+template < typename P >
+bool Server< P >::listen() {
+  if (path_.size() > 0) {
+    struct sockaddr_un address;
+    ::std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path_.size() >= sizeof(address.sun_path)) {
+      return false;
+    }
+    ::std::strncpy(address.sun_path, path_.c_str(),
+                   sizeof(address.sun_path) - 1);
+    // Remove a socket left by an earlier server
+    ::unlink(path_.c_str());
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                          0);
+    if (listen_fd_ < 0 || ::bind(
+            listen_fd_, reinterpret_cast< struct sockaddr * >(&address),
+            sizeof(address)) != 0) {
+      return false;
+    }
+  } else {
+    struct sockaddr_in address;
+    ::std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port_);
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                          0);
+    int reuse = 1;
+    if (listen_fd_ < 0 || ::setsockopt(
+            listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        ::bind(listen_fd_, reinterpret_cast< struct sockaddr * >(&address),
+               sizeof(address)) != 0) {
+      return false;
+    }
+    // Find the port if it was chosen by the system
+    socklen_t length = sizeof(address);
+    if (::getsockname(
+            listen_fd_, reinterpret_cast< struct sockaddr * >(&address),
+            &length) != 0) {
+      return false;
+    }
+    port_ = ntohs(address.sin_port);
+  }
+  if (::listen(listen_fd_, SOMAXCONN) != 0) {
+    return false;
+  }
+
+  epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || event_fd_ < 0) {
+    return false;
+  }
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = listen_fd_;
+  if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event) != 0) {
+    return false;
+  }
+  event.data.fd = event_fd_;
+  if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event) != 0) {
+    return false;
+  }
+  // A stop() before the event file existed
+  return stop_ == false;
+}
+
+template < typename P >
+void Server< P >::accept() {
+  int fd;
+  while ((fd = ::accept4(listen_fd_, nullptr, nullptr,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    ::std::shared_ptr< Connection > connection =
+          ::std::make_shared< Connection >();
+    connection->fd = fd;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0) {
+      connections_[fd] = connection;
+    }
+  }
+}
+
+template < typename P >
+bool Server< P >::receive(const ::std::shared_ptr< Connection > &connection) {
+  // Requests larger than this are treated as a broken connection
+  const uint32_t max_length = 1 << 26;
+  char_array &buffer = connection->buffer;
+  bool open = true;
+  char block[65536];
+  while (true) {
+    ssize_t n = ::read(connection->fd, block, sizeof(block));
+    if (n > 0) {
+      buffer.insert(buffer.end(), block, block + n);
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else {
+      open = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+      break;
+    }
+  }
+
+  // Queue all complete requests
+  size_type position = 0;
+  uint32_t length;
+  ::std::vector< Request > requests;
+  while (buffer.size() - position >= sizeof(uint32_t)) {
+    ::std::memcpy(&length, buffer.data() + position, sizeof(uint32_t));
+    if (length > max_length) {
+      return false;
+    }
+    if (buffer.size() - position - sizeof(uint32_t) < length) {
+      break;
+    }
+    position = position + sizeof(uint32_t);
+    requests.push_back(Request{connection, char_array(
+        buffer.begin() + position, buffer.begin() + position + length)});
+    position = position + length;
+  }
+  buffer.erase(buffer.begin(), buffer.begin() + position);
+  if (requests.size() > 0) {
+    ::std::unique_lock< ::std::mutex > lock(queue_mutex_);
+    for (Request &request : requests) {
+      // Stop reading from all connections until the workers catch up
+      space_condition_.wait(lock, [this]() -> bool {
+          return stop_ || queue_.size() < kQueueSize; });
+      queue_.push_back(::std::move(request));
+      queue_condition_.notify_one();
+    }
+  }
+  return open;
+}
+
+template < typename P >
+void Server< P >::close() {
+  connections_.clear();
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    if (path_.size() > 0) {
+      ::unlink(path_.c_str());
+    }
+  }
+  if (epoll_fd_ >= 0) {
+    ::close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+  if (event_fd_ >= 0) {
+    ::close(event_fd_);
+    event_fd_ = -1;
+  }
+}
+
+template < typename P >
+void Server< P >::job() {
+  Local local{predictor_->context()};
+  ::std::vector< Request > batch;
+  size_type output_size = predictor_->output_size();
+  while (true) {
+    // Take up to a batch of requests with one lock
+    {
+      ::std::unique_lock< ::std::mutex > lock(queue_mutex_);
+      queue_condition_.wait(
+          lock, [this]() -> bool { return stop_ || queue_.size() > 0; });
+      if (queue_.size() == 0) {
+        return;
+      }
+      while (queue_.size() > 0 && batch.size() < batch_size_) {
+        batch.push_back(::std::move(queue_.front()));
+        queue_.pop_front();
+      }
+    }
+    space_condition_.notify_one();
+
+    // Decode all requests and score them with one call, where a malformed
+    // request is an empty input whose scores are not sent
+    if (local.fields.size() < batch.size()) {
+      local.ids.resize(batch.size());
+      local.fields.resize(batch.size());
+      local.indices.resize(batch.size());
+    }
+    local.inputs.clear();
+    local.sizes.clear();
+    for (size_type i = 0; i < batch.size(); ++i) {
+      local.ids[i] = 0;
+      if (decode(batch[i].payload, &local.ids[i], &local.fields[i],
+                 &local.indices[i]) == true) {
+        local.inputs.push_back(local.fields[i].data());
+        local.sizes.push_back(local.fields[i].size());
+      } else {
+        local.inputs.push_back(nullptr);
+        local.sizes.push_back(0);
+      }
+    }
+    const value_array &output = predictor_->predict(
+        local.inputs.data(), local.sizes.data(), batch.size(),
+        &local.context);
+    for (size_type i = 0; i < batch.size(); ++i) {
+      respond(&batch[i], local.ids[i], local.inputs[i] == nullptr ?
+              nullptr : output.data() + i * output_size,
+              static_cast< uint32_t >(output_size), &local);
+    }
+    count_ += batch.size();
+    batch.clear();
+  }
+}
+
+template < typename P >
+void Server< P >::respond(Request *request, uint64_t id,
+                          const value_type *scores, uint32_t n,
+                          Local *local) const {
+  uint32_t size = scores == nullptr ? 0 : n;
+  uint32_t score_size = scores == nullptr ? kError : n;
+
+  // Length, id, score count and scores
+  char_array &response = local->response;
+  uint32_t length = sizeof(uint64_t) + sizeof(uint32_t) +
+      size * sizeof(double);
+  response.resize(sizeof(uint32_t) + length);
+  char *data = response.data();
+  ::std::memcpy(data, &length, sizeof(uint32_t));
+  ::std::memcpy(data + sizeof(uint32_t), &id, sizeof(uint64_t));
+  ::std::memcpy(data + sizeof(uint32_t) + sizeof(uint64_t), &score_size,
+                sizeof(uint32_t));
+  data = data + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+  for (uint32_t i = 0; i < size; ++i) {
+    double score = scores[i];
+    ::std::memcpy(data + i * sizeof(double), &score, sizeof(double));
+  }
+  send(request->connection.get(), response);
+}
+
+template < typename P >
+bool Server< P >::decode(
+    const char_array &payload, uint64_t *id,
+    ::std::vector< field_span > *fields,
+    ::std::vector< ::std::vector< index_pair > > *indices) {
+  const char *data = payload.data();
+  size_type remain = payload.size();
+  auto read = [&](void *value, size_type n) -> bool {
+    if (remain < n) {
+      return false;
+    }
+    ::std::memcpy(value, data, n);
+    data = data + n;
+    remain = remain - n;
+    return true;
+  };
+  uint32_t field_size;
+  if (read(id, sizeof(uint64_t)) == false ||
+      read(&field_size, sizeof(uint32_t)) == false ||
+      // Each field has at least a format and a size
+      field_size > remain / (sizeof(uint8_t) + sizeof(uint32_t))) {
+    return false;
+  }
+  fields->clear();
+  if (indices->size() < field_size) {
+    indices->resize(field_size);
+  }
+  uint8_t format;
+  uint32_t size;
+  uint64_t index;
+  double weight;
+  const size_type pair_size = sizeof(uint64_t) + sizeof(double);
+  for (uint32_t i = 0; i < field_size; ++i) {
+    if (read(&format, sizeof(uint8_t)) == false ||
+        read(&size, sizeof(uint32_t)) == false) {
+      return false;
+    }
+    if (format == kBytes) {
+      if (remain < size) {
+        return false;
+      }
+      fields->push_back(byte_span(
+          reinterpret_cast< const uint8_t * >(data), size));
+      data = data + size;
+      remain = remain - size;
+    } else if (format == kIndex) {
+      if (remain / pair_size < size) {
+        return false;
+      }
+      // Pairs are copied since the payload is not aligned for them
+      ::std::vector< index_pair > &pairs = (*indices)[i];
+      pairs.resize(size);
+      for (uint32_t j = 0; j < size; ++j) {
+        read(&index, sizeof(uint64_t));
+        read(&weight, sizeof(double));
+        pairs[j].first = static_cast< size_type >(index);
+        pairs[j].second = static_cast< value_type >(weight);
+      }
+      fields->push_back(index_span(pairs.data(), pairs.size()));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+template < typename P >
+bool Server< P >::send(Connection *connection, const char_array &response) {
+  ::std::lock_guard< ::std::mutex > lock(connection->mutex);
+  size_type position = 0;
+  while (position < response.size()) {
+    ssize_t n = ::send(connection->fd, response.data() + position,
+                       response.size() - position, MSG_NOSIGNAL);
+    if (n > 0) {
+      position = position + n;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Wait for the client to read, giving up on a stalled client
+      struct pollfd descriptor{connection->fd, POLLOUT, 0};
+      if (::poll(&descriptor, 1, 10000) <= 0) {
+        return false;
+      }
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace bytesteady
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/server.hpp"
+
+#include "bytesteady/predictor.hpp"
+
+#include "bytesteady/server-inl.hpp"
+
+namespace bytesteady {
+
+// Template class instantiation
+template class Server< DoubleFNVPredictor >;
+template class Server< FloatFNVPredictor >;
+template class Server< DoubleCityPredictor >;
+template class Server< FloatCityPredictor >;
+template class Server< DoubleRollingPredictor >;
+template class Server< FloatRollingPredictor >;
+template class Server< HalfFNVPredictor >;
+template class Server< HalfCityPredictor >;
+template class Server< HalfRollingPredictor >;
+template class Server< QuantFNVPredictor >;
+template class Server< QuantCityPredictor >;
+template class Server< QuantRollingPredictor >;
+template class Server< SparseFNVPredictor >;
+template class Server< SparseCityPredictor >;
+template class Server< SparseRollingPredictor >;
+
+}  // namespace bytesteady
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_SERVER_HPP_
+#define BYTESTEADY_SERVER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bytesteady/integer.hpp"
+#include "bytesteady/predictor.hpp"
+
+namespace bytesteady {
+
+/*
+ * Inference server over a Unix domain socket or the TCP loopback. One thread
+ * accepts connections and reads requests with epoll, and a pool of worker
+ * threads takes queued requests in batches and scores each batch with one
+ * call to a shared predictor. Reading stops while the queue is full. All
+ * integers are in host byte order.
+ *
+ * A request is a 32-bit length of the rest of the request, a 64-bit id, a
+ * 32-bit field count, and for each field an 8-bit FieldFormat and a 32-bit
+ * element count followed by the raw bytes or (64-bit index, double weight)
+ * pairs.
+ *
+ * A response is a 32-bit length of the rest of the response, the 64-bit id
+ * of the request, a 32-bit score count and the double scores. Responses on a
+ * connection can arrive out of order. A malformed request gets an error
+ * response whose score count is kError, with no scores and the id if it could
+ * be read or 0 otherwise.
+ */
+template < typename P = Predictor<> >
+class Server {
+ public:
+  typedef P predictor_type;
+  typedef typename P::byte_span byte_span;
+  typedef typename P::context_type context_type;
+  typedef typename P::field_span field_span;
+  typedef typename P::index_pair index_pair;
+  typedef typename P::index_span index_span;
+  typedef typename P::size_type size_type;
+  typedef typename P::value_array value_array;
+  typedef typename P::value_type value_type;
+  typedef ::std::vector< char > char_array;
+
+  // Score count of the response to a malformed request
+  static constexpr uint32_t kError = 0xFFFFFFFF;
+  // Maximum number of requests waiting for workers
+  static constexpr size_type kQueueSize = 4096;
+
+  // Listen on the Unix domain socket at path, or on the TCP loopback port if
+  // path is empty. Uses t worker threads scoring up to b requests at a time.
+  Server(const P *p, const ::std::string &path, uint16_t port = 0,
+         size_type t = 1, size_type b = 16);
+  ~Server();
+
+  // Serve until stop() is called. Returns false if it cannot listen.
+  bool run();
+  void stop();
+
+  // Number of requests answered
+  size_type count() const;
+
+  const ::std::string &path() const;
+  uint16_t port() const;
+
+ private:
+  struct Connection {
+    int fd;
+    // Serialize responses written by different workers
+    ::std::mutex mutex;
+    // Received bytes not yet parsed into requests
+    char_array buffer;
+    ~Connection();
+  };
+  struct Request {
+    ::std::shared_ptr< Connection > connection;
+    char_array payload;
+  };
+
+  // Scratch space for decoding and scoring a batch of requests in a worker
+  struct Local {
+    context_type context;
+    // Id, fields and index pairs of each request in the batch
+    ::std::vector< uint64_t > ids;
+    ::std::vector< ::std::vector< field_span > > fields;
+    ::std::vector< ::std::vector< ::std::vector< index_pair > > > indices;
+    // Inputs of the well-formed requests passed to the predictor
+    ::std::vector< const field_span * > inputs;
+    ::std::vector< size_type > sizes;
+    char_array response;
+  };
+
+  const P *predictor_;
+  ::std::string path_;
+  uint16_t port_;
+  size_type thread_size_;
+  size_type batch_size_;
+
+  int listen_fd_;
+  int epoll_fd_;
+  int event_fd_;
+  ::std::atomic< bool > stop_;
+  ::std::atomic< size_type > count_;
+
+  ::std::unordered_map< int, ::std::shared_ptr< Connection > > connections_;
+  ::std::vector< ::std::thread > threads_;
+
+  // Requests waiting for workers
+  ::std::mutex queue_mutex_;
+  ::std::condition_variable queue_condition_;
+  // Wakes the reading thread when the queue has space again
+  ::std::condition_variable space_condition_;
+  ::std::deque< Request > queue_;
+
+  bool listen();
+  void accept();
+  // Read available bytes and queue complete requests. Returns false if the
+  // connection is closed or broken.
+  bool receive(const ::std::shared_ptr< Connection > &connection);
+  void close();
+
+  void job();
+  // Respond with n scores, or an error if scores is null
+  void respond(Request *request, uint64_t id, const value_type *scores,
+               uint32_t n, Local *local) const;
+  static bool decode(const char_array &payload, uint64_t *id,
+                     ::std::vector< field_span > *fields,
+                     ::std::vector< ::std::vector< index_pair > > *indices);
+  static bool send(Connection *connection, const char_array &response);
+};
+
+typedef Server< DoubleFNVPredictor > DoubleFNVServer;
+typedef Server< FloatFNVPredictor > FloatFNVServer;
+typedef Server< DoubleCityPredictor > DoubleCityServer;
+typedef Server< FloatCityPredictor > FloatCityServer;
+typedef Server< DoubleRollingPredictor > DoubleRollingServer;
+typedef Server< FloatRollingPredictor > FloatRollingServer;
+typedef Server< HalfFNVPredictor > HalfFNVServer;
+typedef Server< HalfCityPredictor > HalfCityServer;
+typedef Server< HalfRollingPredictor > HalfRollingServer;
+typedef Server< QuantFNVPredictor > QuantFNVServer;
+typedef Server< QuantCityPredictor > QuantCityServer;
+typedef Server< QuantRollingPredictor > QuantRollingServer;
+typedef Server< SparseFNVPredictor > SparseFNVServer;
+typedef Server< SparseCityPredictor > SparseCityServer;
+typedef Server< SparseRollingPredictor > SparseRollingServer;
+// Already exists: typedef DoubleFNVServer Server;
+
+}  // namespace bytesteady
+
+namespace bytesteady {
+
+// Pre-compiled template class instantiation
+extern template class Server< DoubleFNVPredictor >;
+extern template class Server< FloatFNVPredictor >;
+extern template class Server< DoubleCityPredictor >;
+extern template class Server< FloatCityPredictor >;
+extern template class Server< DoubleRollingPredictor >;
+extern template class Server< FloatRollingPredictor >;
+extern template class Server< HalfFNVPredictor >;
+extern template class Server< HalfCityPredictor >;
+extern template class Server< HalfRollingPredictor >;
+extern template class Server< QuantFNVPredictor >;
+extern template class Server< QuantCityPredictor >;
+extern template class Server< QuantRollingPredictor >;
+extern template class Server< SparseFNVPredictor >;
+extern template class Server< SparseCityPredictor >;
+extern template class Server< SparseRollingPredictor >;
+
+}  // namespace bytesteady
+
+#endif  // BYTESTEADY_SERVER_HPP_
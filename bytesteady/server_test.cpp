@@ -0,0 +1,184 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/server.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "bytesteady/data.hpp"
+#include "bytesteady/field_format.hpp"
+#include "bytesteady/integer.hpp"
+#include "gtest/gtest.h"
+
+namespace bytesteady {
+namespace {
+
+template < typename S >
+void serveTest() {
+  typedef typename S::char_array char_array;
+  typedef typename S::predictor_type predictor_type;
+  typedef typename predictor_type::context_type context_type;
+  typedef typename predictor_type::byte_span byte_span;
+  typedef typename predictor_type::index_span index_span;
+  typedef typename predictor_type::model_type model_type;
+  typedef typename predictor_type::value_array value_array;
+  typedef typename model_type::byte_array byte_array;
+  typedef typename model_type::field_array field_array;
+  typedef typename model_type::gram_array gram_array;
+  typedef typename model_type::index_array index_array;
+  typedef typename model_type::index_pair index_pair;
+  typedef typename model_type::size_storage size_storage;
+  typedef typename model_type::size_type size_type;
+  typedef typename model_type::tensor_type tensor_type;
+  typedef Data< tensor_type > data_type;
+
+  // Create model and predictor
+  size_storage model_input_size = {1000, 16};
+  gram_array model_gram = {{1,2,4,8},{}};
+  model_type model(model_input_size, 4, 16, model_gram);
+  model.initialize(0.0, 1.0);
+  predictor_type predictor(model);
+  context_type context = predictor.context();
+
+  // Encode requests of all samples and compute the expected scores
+  data_type data("bytesteady/unittest_train.txt", {kBytes, kIndex});
+  field_array input;
+  typename data_type::index_pair label;
+  char_array requests;
+  ::std::vector< value_array > expected;
+  auto append = [&requests](const void *value, size_type n) -> void {
+    const char *bytes = static_cast< const char * >(value);
+    requests.insert(requests.end(), bytes, bytes + n);
+  };
+  while (data.getSample(&input, &label) == true) {
+    const byte_array &bytes = ::std::get< byte_array >(input[0]);
+    const index_array &indices = ::std::get< index_array >(input[1]);
+    expected.push_back(predictor.predict(
+        {byte_span(bytes.data(), bytes.size()),
+         index_span(indices.data(), indices.size())}, &context));
+    uint32_t length = sizeof(uint64_t) + sizeof(uint32_t) +
+        2 * (sizeof(uint8_t) + sizeof(uint32_t)) + bytes.size() +
+        indices.size() * (sizeof(uint64_t) + sizeof(double));
+    uint64_t id = expected.size() - 1;
+    uint32_t field_size = 2;
+    uint8_t format = kBytes;
+    uint32_t size = bytes.size();
+    append(&length, sizeof(uint32_t));
+    append(&id, sizeof(uint64_t));
+    append(&field_size, sizeof(uint32_t));
+    append(&format, sizeof(uint8_t));
+    append(&size, sizeof(uint32_t));
+    append(bytes.data(), bytes.size());
+    format = kIndex;
+    size = indices.size();
+    append(&format, sizeof(uint8_t));
+    append(&size, sizeof(uint32_t));
+    for (const index_pair &pair : indices) {
+      uint64_t index = pair.first;
+      double weight = pair.second;
+      append(&index, sizeof(uint64_t));
+      append(&weight, sizeof(double));
+    }
+  }
+  EXPECT_EQ(20, expected.size());
+  // A malformed request with an unknown field format
+  uint32_t length = sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint8_t) +
+      sizeof(uint32_t);
+  uint64_t malformed_id = 1000;
+  uint32_t field_size = 1;
+  uint8_t format = 7;
+  uint32_t size = 0;
+  append(&length, sizeof(uint32_t));
+  append(&malformed_id, sizeof(uint64_t));
+  append(&field_size, sizeof(uint32_t));
+  append(&format, sizeof(uint8_t));
+  append(&size, sizeof(uint32_t));
+
+  // Start the server
+  ::std::string path = "bytesteady/unittest_serve.sock";
+  S server(&predictor, path, 0, 4, 3);
+  ::std::thread thread([&server]() -> void { EXPECT_TRUE(server.run()); });
+
+  // Connect and send all requests at once
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un address;
+  ::std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  ::std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  bool connected = false;
+  for (size_type i = 0; i < 100 && connected == false; ++i) {
+    connected = ::connect(
+        fd, reinterpret_cast< struct sockaddr * >(&address),
+        sizeof(address)) == 0;
+    if (connected == false) {
+      ::std::this_thread::sleep_for(::std::chrono::milliseconds(10));
+    }
+  }
+  ASSERT_TRUE(connected);
+  EXPECT_EQ(requests.size(), ::write(fd, requests.data(), requests.size()));
+
+  // Read responses, which may come in any order
+  ::std::vector< bool > answered(expected.size(), false);
+  for (size_type i = 0; i < expected.size() + 1; ++i) {
+    uint32_t response_length;
+    uint64_t id;
+    uint32_t score_size;
+    ASSERT_EQ(sizeof(uint32_t), ::recv(
+        fd, &response_length, sizeof(uint32_t), MSG_WAITALL));
+    ASSERT_EQ(sizeof(uint64_t), ::recv(
+        fd, &id, sizeof(uint64_t), MSG_WAITALL));
+    ASSERT_EQ(sizeof(uint32_t), ::recv(
+        fd, &score_size, sizeof(uint32_t), MSG_WAITALL));
+    if (id == malformed_id) {
+      EXPECT_EQ(S::kError, score_size);
+      EXPECT_EQ(sizeof(uint64_t) + sizeof(uint32_t), response_length);
+      continue;
+    }
+    ::std::vector< double > scores(score_size);
+    if (score_size > 0) {
+      ASSERT_EQ(score_size * sizeof(double), ::recv(
+          fd, scores.data(), score_size * sizeof(double), MSG_WAITALL));
+    }
+    EXPECT_EQ(sizeof(uint64_t) + sizeof(uint32_t) +
+              score_size * sizeof(double), response_length);
+    ASSERT_LT(id, expected.size());
+    EXPECT_FALSE(answered[id]);
+    answered[id] = true;
+    ASSERT_EQ(4, score_size);
+    for (size_type j = 0; j < 4; ++j) {
+      EXPECT_NEAR(expected[id][j], scores[j], 1e-5);
+    }
+  }
+  ::close(fd);
+
+  server.stop();
+  thread.join();
+  EXPECT_EQ(expected.size() + 1, server.count());
+}
+
+TEST(ServerTest, serveTest) {
+  serveTest< DoubleFNVServer >();
+  serveTest< FloatRollingServer >();
+}
+
+}  // namespace
+}  // namespace bytesteady
@@ -0,0 +1,331 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/sparse_tensor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "bytesteady/integer.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/serializer/binary_protocol.hpp"
+#include "thunder/serializer/serializer.hpp"
+#include "thunder/serializer/static.hpp"
+#include "thunder/serializer/text_protocol.hpp"
+#include "thunder/tensor.hpp"
+
+#include "thunder/serializer/binary_protocol-inl.hpp"
+#include "thunder/serializer/serializer-inl.hpp"
+#include "thunder/serializer/static-inl.hpp"
+#include "thunder/serializer/text_protocol-inl.hpp"
+
+namespace bytesteady {
+
+namespace {
+
+template < typename P >
+::std::shared_ptr< P > allocate(SparseTensor::size_type n) {
+  ::std::shared_ptr< P > storage(
+      new P[n == 0 ? 1 : n], ::std::default_delete< P[] >());
+  ::std::fill(storage.get(), storage.get() + n, P(0));
+  return storage;
+}
+
+template < typename T >
+void compactRows(const SparseTensor &s, const T &t) {
+  typedef SparseTensor::size_type size_type;
+  for (size_type k = 0; k < s.retained(); ++k) {
+    float *target = s.data() + k * s.stride(0);
+    for (size_type j = 0; j < s.size(1); ++j) {
+      target[j] = static_cast< float >(
+          t.data()[s.index()[k] * t.stride(0) + j * t.stride(1)]);
+    }
+  }
+}
+
+template < typename T >
+void copyRows(const SparseTensor &s, const T &t, SparseTensor::size_type r) {
+  typedef SparseTensor::size_type size_type;
+  size_type rows = ::std::min(t.size(0), s.size(0) - r);
+  size_type columns = ::std::min(t.size(1), s.size(1));
+  // Walk the retained rows in the range since the index is sorted
+  const uint64_t *last = s.index() + s.retained();
+  const uint64_t *begin = ::std::lower_bound(
+      static_cast< const uint64_t * >(s.index()), last, r);
+  const uint64_t *end = ::std::lower_bound(begin, last, r + rows);
+  for (const uint64_t *i = begin; i != end; ++i) {
+    float *target = s.data() + (i - s.index()) * s.stride(0);
+    for (size_type j = 0; j < columns; ++j) {
+      target[j] = static_cast< float >(
+          t.data()[(*i - r) * t.stride(0) + j * t.stride(1)]);
+    }
+  }
+}
+
+template < typename T >
+void getRows(const SparseTensor &s, const T &t, SparseTensor::size_type r) {
+  typedef typename T::value_type value_type;
+  typedef SparseTensor::size_type size_type;
+  size_type rows = ::std::min(t.size(0), s.size(0) - r);
+  size_type columns = ::std::min(t.size(1), s.size(1));
+  for (size_type i = 0; i < rows; ++i) {
+    const float *source = s.row(r + i);
+    for (size_type j = 0; j < columns; ++j) {
+      t.data()[i * t.stride(0) + j * t.stride(1)] =
+          source == nullptr ? 0 : static_cast< value_type >(source[j]);
+    }
+  }
+}
+
+}  // namespace
+
+SparseTensor::SparseTensor() :
+    rows_(0), columns_(0), retained_(0), index_(allocate< uint64_t >(0)),
+    storage_(allocate< float >(0)) {
+  build();
+}
+
+SparseTensor::SparseTensor(size_type n, size_type m) :
+    rows_(n), columns_(m), retained_(0), index_(allocate< uint64_t >(0)),
+    storage_(allocate< float >(0)) {
+  build();
+}
+
+SparseTensor::SparseTensor(const size_storage &sz) :
+    SparseTensor(sz.size() > 0 ? sz[0] : 0, sz.size() > 1 ? sz[1] : 1) {}
+
+SparseTensor::SparseTensor(const size_storage &sz, size_type k,
+                           const index_pointer &i, const storage_pointer &s) :
+    rows_(sz.size() > 0 ? sz[0] : 0), columns_(sz.size() > 1 ? sz[1] : 1),
+    retained_(k), index_(i), storage_(s) {
+  build();
+}
+
+SparseTensor::SparseTensor(
+    const ::thunder::DoubleTensor &t, const index_array &rows) :
+    rows_(t.size(0)), columns_(t.size(1)), retained_(rows.size()),
+    index_(allocate< uint64_t >(rows.size())),
+    storage_(allocate< float >(rows.size() * t.size(1))) {
+  ::std::copy(rows.begin(), rows.end(), index_.get());
+  build();
+  compactRows(*this, t);
+}
+
+SparseTensor::SparseTensor(
+    const ::thunder::FloatTensor &t, const index_array &rows) :
+    rows_(t.size(0)), columns_(t.size(1)), retained_(rows.size()),
+    index_(allocate< uint64_t >(rows.size())),
+    storage_(allocate< float >(rows.size() * t.size(1))) {
+  ::std::copy(rows.begin(), rows.end(), index_.get());
+  build();
+  compactRows(*this, t);
+}
+
+SparseTensor::size_type SparseTensor::dimension() const {
+  return 2;
+}
+
+SparseTensor::size_storage SparseTensor::size() const {
+  return size_storage{rows_, columns_};
+}
+
+SparseTensor::size_type SparseTensor::size(size_type d) const {
+  return d == 0 ? rows_ : columns_;
+}
+
+SparseTensor::difference_type SparseTensor::stride(size_type d) const {
+  return d == 0 ? columns_ : 1;
+}
+
+SparseTensor::size_type SparseTensor::retained() const {
+  return retained_;
+}
+
+uint64_t *SparseTensor::index() const {
+  return index_.get();
+}
+
+float *SparseTensor::data() const {
+  return storage_.get();
+}
+
+const SparseTensor::index_pointer &SparseTensor::index_storage() const {
+  return index_;
+}
+
+const SparseTensor::storage_pointer &SparseTensor::storage() const {
+  return storage_;
+}
+
+void SparseTensor::build() {
+  size_type n = (rows_ + 63) / 64;
+  block_ = ::std::shared_ptr< Block >(
+      new Block[n == 0 ? 1 : n], ::std::default_delete< Block[] >());
+  Block *block = block_.get();
+  ::std::fill(block, block + n, Block{0, 0});
+  for (size_type k = 0; k < retained_; ++k) {
+    uint64_t r = index()[k];
+    if (r < rows_) {
+      block[r / 64].bits |= static_cast< uint64_t >(1) << (r % 64);
+    }
+  }
+  uint64_t rank = 0;
+  for (size_type i = 0; i < n; ++i) {
+    block[i].rank = rank;
+    rank = rank + __builtin_popcountll(block[i].bits);
+  }
+}
+
+float *SparseTensor::row(size_type r) const {
+  if (r >= rows_) {
+    return nullptr;
+  }
+  const Block &block = block_.get()[r / 64];
+  uint64_t bit = static_cast< uint64_t >(1) << (r % 64);
+  if ((block.bits & bit) == 0) {
+    return nullptr;
+  }
+  return data() + (block.rank + __builtin_popcountll(
+      block.bits & (bit - 1))) * columns_;
+}
+
+const SparseTensor &SparseTensor::copy(const SparseTensor &t) const {
+  for (size_type k = 0; k < retained_; ++k) {
+    const float *source = t.row(index()[k]);
+    float *target = data() + k * columns_;
+    for (size_type j = 0; j < columns_; ++j) {
+      target[j] = source == nullptr || j >= t.size(1) ? 0.0f : source[j];
+    }
+  }
+  return *this;
+}
+
+const SparseTensor &SparseTensor::copy(
+    const ::thunder::DoubleTensor &t, size_type r) const {
+  copyRows(*this, t, r);
+  return *this;
+}
+
+const SparseTensor &SparseTensor::copy(
+    const ::thunder::FloatTensor &t, size_type r) const {
+  copyRows(*this, t, r);
+  return *this;
+}
+
+void SparseTensor::get(const ::thunder::DoubleTensor &t, size_type r) const {
+  getRows(*this, t, r);
+}
+
+void SparseTensor::get(const ::thunder::FloatTensor &t, size_type r) const {
+  getRows(*this, t, r);
+}
+
+double SparseTensor::mean() const {
+  double sum = 0.0;
+  for (size_type i = 0; i < retained_ * columns_; ++i) {
+    sum = sum + data()[i];
+  }
+  return rows_ * columns_ == 0 ? 0.0 : sum / (rows_ * columns_);
+}
+
+double SparseTensor::std() const {
+  double mu = mean();
+  // Rows that are not retained contribute zeros
+  double sum = (rows_ - retained_) * columns_ * mu * mu;
+  for (size_type i = 0; i < retained_ * columns_; ++i) {
+    sum = sum + (data()[i] - mu) * (data()[i] - mu);
+  }
+  return rows_ * columns_ == 0 ? 0.0 : ::std::sqrt(sum / (rows_ * columns_));
+}
+
+double SparseTensor::min() const {
+  double result = retained_ < rows_ ? 0.0 :
+      ::std::numeric_limits< double >::infinity();
+  for (size_type i = 0; i < retained_ * columns_; ++i) {
+    result = ::std::min(result, static_cast< double >(data()[i]));
+  }
+  return result;
+}
+
+double SparseTensor::max() const {
+  double result = retained_ < rows_ ? 0.0 :
+      -::std::numeric_limits< double >::infinity();
+  for (size_type i = 0; i < retained_ * columns_; ++i) {
+    result = ::std::max(result, static_cast< double >(data()[i]));
+  }
+  return result;
+}
+
+}  // namespace bytesteady
+
+namespace thunder {
+namespace serializer {
+
+template < typename S >
+void save(S *s, const ::bytesteady::SparseTensor &t) {
+  typedef ::bytesteady::SparseTensor::size_type size_type;
+  s->save(t.size(0));
+  s->save(t.size(1));
+  s->save(t.retained());
+  for (size_type i = 0; i < t.retained(); ++i) {
+    s->save(t.index()[i]);
+  }
+  for (size_type i = 0; i < t.retained() * t.size(1); ++i) {
+    s->save(t.data()[i]);
+  }
+}
+
+template < typename S >
+void load(S *s, ::bytesteady::SparseTensor *t) {
+  typedef ::bytesteady::SparseTensor::size_type size_type;
+  size_type rows;
+  size_type columns;
+  size_type retained;
+  s->load(&rows);
+  s->load(&columns);
+  s->load(&retained);
+  ::bytesteady::SparseTensor::index_pointer index(
+      new uint64_t[retained == 0 ? 1 : retained],
+      ::std::default_delete< uint64_t[] >());
+  ::bytesteady::SparseTensor::storage_pointer storage(
+      new float[retained * columns == 0 ? 1 : retained * columns],
+      ::std::default_delete< float[] >());
+  for (size_type i = 0; i < retained; ++i) {
+    s->load(&index.get()[i]);
+  }
+  for (size_type i = 0; i < retained * columns; ++i) {
+    s->load(&storage.get()[i]);
+  }
+  *t = ::bytesteady::SparseTensor(
+      ::bytesteady::SparseTensor::size_storage{rows, columns}, retained,
+      index, storage);
+}
+
+// Template serializer instantiation
+#define BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(S)         \
+  template void save(S *s, const ::bytesteady::SparseTensor &t);  \
+  template void S::save(const ::bytesteady::SparseTensor &t);     \
+  template void load(S *s, ::bytesteady::SparseTensor *t);        \
+  template void S::load(::bytesteady::SparseTensor *t);
+
+BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(StringBinarySerializer);
+BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(FileBinarySerializer);
+BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(StringTextSerializer);
+BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(FileTextSerializer);
+
+#undef BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE
+
+}  // namespace serializer
+}  // namespace thunder
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTESTEADY_SPARSE_TENSOR_HPP_
+#define BYTESTEADY_SPARSE_TENSOR_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "bytesteady/integer.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+
+/*
+ * Matrix of float values in which only some rows are stored, used for input
+ * embeddings of compacted models. The retained rows are kept in a dense
+ * matrix in the order of a sorted index of their row numbers. A row is found
+ * in constant time from a bitmap of the retained rows, in which every 64 rows
+ * also keep the number of retained rows before them. Rows that are not
+ * retained are zero and cannot be changed. Like thunder tensors, copies share
+ * the same storage and the const methods modify the values.
+ */
+class SparseTensor {
+ public:
+  typedef float value_type;
+  typedef ::std::size_t size_type;
+  typedef ::std::ptrdiff_t difference_type;
+  typedef ::thunder::SizeStorage size_storage;
+  typedef ::std::vector< uint64_t > index_array;
+  typedef ::std::shared_ptr< uint64_t > index_pointer;
+  typedef ::std::shared_ptr< float > storage_pointer;
+
+  SparseTensor();
+  // Matrix of n rows and m columns without retained rows
+  SparseTensor(size_type n, size_type m);
+  explicit SparseTensor(const size_storage &sz);
+  // Matrix retaining k rows at the sorted index, viewing existing index and
+  // values that are kept alive by the pointers
+  SparseTensor(const size_storage &sz, size_type k, const index_pointer &i,
+               const storage_pointer &s);
+  // Matrix retaining the sorted rows of t
+  SparseTensor(const ::thunder::DoubleTensor &t, const index_array &rows);
+  SparseTensor(const ::thunder::FloatTensor &t, const index_array &rows);
+
+  size_type dimension() const;
+  size_storage size() const;
+  size_type size(size_type d) const;
+  // Stride of rows is for the retained values
+  difference_type stride(size_type d) const;
+  // Number of retained rows
+  size_type retained() const;
+  uint64_t *index() const;
+  float *data() const;
+  const index_pointer &index_storage() const;
+  const storage_pointer &storage() const;
+
+  // Values of row r, or nullptr if the row is not retained
+  float *row(size_type r) const;
+
+  // Copy retained values from a matrix of the same size
+  const SparseTensor &copy(const SparseTensor &t) const;
+  // Copy the rows of t into retained rows starting at r
+  const SparseTensor &copy(const ::thunder::DoubleTensor &t,
+                           size_type r = 0) const;
+  const SparseTensor &copy(const ::thunder::FloatTensor &t,
+                           size_type r = 0) const;
+  // Expand rows starting at r into t
+  void get(const ::thunder::DoubleTensor &t, size_type r = 0) const;
+  void get(const ::thunder::FloatTensor &t, size_type r = 0) const;
+
+  // Statistics of all values including rows that are not retained
+  double mean() const;
+  double std() const;
+  double min() const;
+  double max() const;
+
+ private:
+  size_type rows_;
+  size_type columns_;
+  size_type retained_;
+  index_pointer index_;
+  storage_pointer storage_;
+
+  // Retained rows among 64 rows and the number of retained rows before them
+  struct Block {
+    uint64_t bits;
+    uint64_t rank;
+  };
+  ::std::shared_ptr< Block > block_;
+
+  // Build the blocks from the index
+  void build();
+};
+
+}  // namespace bytesteady
+
+namespace thunder {
+namespace serializer {
+
+template < typename S >
+void save(S *s, const ::bytesteady::SparseTensor &t);
+
+template < typename S >
+void load(S *s, ::bytesteady::SparseTensor *t);
+
+// Pre-compiled template serializer instantiation
+#define BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(S)          \
+  extern template void save(                                       \
+      S *s, const ::bytesteady::SparseTensor &t);                  \
+  extern template void S::save(const ::bytesteady::SparseTensor &t); \
+  extern template void load(S *s, ::bytesteady::SparseTensor *t);  \
+  extern template void S::load(::bytesteady::SparseTensor *t);
+
+BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(StringBinarySerializer);
+BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(FileBinarySerializer);
+BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(StringTextSerializer);
+BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE(FileTextSerializer);
+
+#undef BYTESTEADY_SPARSE_TENSOR_INSTANTIATE_SERIALIZE
+
+}  // namespace serializer
+}  // namespace thunder
+
+#endif  // BYTESTEADY_SPARSE_TENSOR_HPP_
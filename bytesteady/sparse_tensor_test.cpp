@@ -0,0 +1,143 @@
+/*
+ * Copyright 2021 ServiceNow
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bytesteady/sparse_tensor.hpp"
+
+#include "gtest/gtest.h"
+#include "thunder/random.hpp"
+#include "thunder/serializer.hpp"
+#include "thunder/tensor.hpp"
+
+namespace bytesteady {
+namespace {
+
+template < typename T >
+void compactTest() {
+  typedef typename T::size_type size_type;
+  ::thunder::Random< T > random;
+
+  T t = random.normal(T(10, 5), 0.0, 1.0);
+  SparseTensor s(t, {1, 4, 5, 9});
+  EXPECT_EQ(2, s.dimension());
+  EXPECT_EQ(10, s.size(0));
+  EXPECT_EQ(5, s.size(1));
+  EXPECT_EQ(5, s.stride(0));
+  EXPECT_EQ(4, s.retained());
+
+  // Retained rows keep their values and others are zero
+  T u(10, 5);
+  u.fill(1.0);
+  s.get(u);
+  for (size_type i = 0; i < 10; ++i) {
+    bool retained = i == 1 || i == 4 || i == 5 || i == 9;
+    EXPECT_EQ(retained, s.row(i) != nullptr);
+    for (size_type j = 0; j < 5; ++j) {
+      EXPECT_EQ(retained ? static_cast< float >(t(i, j)) : 0.0f, u(i, j));
+    }
+  }
+  EXPECT_EQ(nullptr, s.row(10));
+  EXPECT_LE(0.0, s.max());
+  EXPECT_GE(0.0, s.min());
+
+  // Copying rows only changes the retained ones
+  T v = random.normal(T(3, 5), 0.0, 1.0);
+  s.copy(v, 3);
+  for (size_type j = 0; j < 5; ++j) {
+    EXPECT_EQ(static_cast< float >(t(1, j)), s.row(1)[j]);
+    EXPECT_EQ(static_cast< float >(v(1, j)), s.row(4)[j]);
+    EXPECT_EQ(static_cast< float >(v(2, j)), s.row(5)[j]);
+    EXPECT_EQ(static_cast< float >(t(9, j)), s.row(9)[j]);
+  }
+
+  // Copies share storage while copy() duplicates values
+  SparseTensor shared = s;
+  SparseTensor duplicate = SparseTensor(t, {4, 9}).copy(s);
+  s.row(4)[0] = 3.0f;
+  EXPECT_EQ(3.0f, shared.row(4)[0]);
+  EXPECT_EQ(static_cast< float >(v(1, 0)), duplicate.row(4)[0]);
+  EXPECT_EQ(static_cast< float >(t(9, 0)), duplicate.row(9)[0]);
+}
+
+TEST(SparseTensorTest, compactTest) {
+  compactTest< ::thunder::DoubleTensor >();
+  compactTest< ::thunder::FloatTensor >();
+}
+
+TEST(SparseTensorTest, emptyTest) {
+  // A matrix without retained rows is all zero
+  SparseTensor s(7, 3);
+  EXPECT_EQ(7, s.size(0));
+  EXPECT_EQ(0, s.retained());
+  EXPECT_EQ(nullptr, s.row(0));
+  EXPECT_EQ(0.0, s.mean());
+  EXPECT_EQ(0.0, s.std());
+  EXPECT_EQ(0.0, s.min());
+  EXPECT_EQ(0.0, s.max());
+}
+
+TEST(SparseTensorTest, saveLoadTest) {
+  ::thunder::Random< ::thunder::FloatTensor > random;
+  SparseTensor s1(random.normal(::thunder::FloatTensor(9, 4), 0.0, 1.0),
+                  {0, 2, 8});
+
+  ::thunder::StringBinarySerializer serializer;
+  serializer.save(s1);
+  SparseTensor s2;
+  serializer.load(&s2);
+  ASSERT_EQ(s1.size(0), s2.size(0));
+  ASSERT_EQ(s1.size(1), s2.size(1));
+  ASSERT_EQ(s1.retained(), s2.retained());
+  for (::std::size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(s1.index()[i], s2.index()[i]);
+  }
+  for (::std::size_t i = 0; i < 12; ++i) {
+    EXPECT_EQ(s1.data()[i], s2.data()[i]);
+  }
+}
+
+TEST(SparseTensorTest, rowTest) {
+  typedef SparseTensor::size_type size_type;
+  // Enough rows for the rank bitmap to span many blocks
+  const size_type rows = 1 << 16;
+
+  // Retain every 16th row, each holding its row number
+  size_type retained = rows / 16;
+  SparseTensor::index_pointer index(
+      new uint64_t[retained], ::std::default_delete< uint64_t[] >());
+  SparseTensor::storage_pointer storage(
+      new float[retained * 4], ::std::default_delete< float[] >());
+  for (size_type k = 0; k < retained; ++k) {
+    index.get()[k] = k * 16;
+    for (size_type j = 0; j < 4; ++j) {
+      storage.get()[k * 4 + j] = static_cast< float >(k * 16);
+    }
+  }
+  SparseTensor s(SparseTensor::size_storage{rows, 4}, retained, index,
+                 storage);
+  EXPECT_EQ(nullptr, s.row(rows));
+
+  // Every row is found exactly when it is retained, with its own values
+  for (size_type row = 0; row < rows; ++row) {
+    const float *values = s.row(row);
+    if (row % 16 == 0) {
+      ASSERT_NE(nullptr, values);
+      EXPECT_EQ(static_cast< float >(row), values[0]);
+      EXPECT_EQ(static_cast< float >(row), values[3]);
+    } else {
+      EXPECT_EQ(nullptr, values);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace bytesteady
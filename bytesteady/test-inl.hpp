@@ -29,15 +29,20 @@ template < typename D, typename M, typename L >
 void Test< D, M, L >::test(const callback_type &callback) {
   threads_.clear();
   mutexes_.clear();
+  count_ = 0;
+  objective_ = 0;
+  error_ = 0;
   for (size_type i = 0; i < thread_size_; ++i) {
     mutexes_.push_back(::std::make_shared< ::std::mutex >());
     threads_.push_back(::std::thread(
-        &Test::job, this, callback, mutexes_[i].get()));
+        &Test::job, this, callback, mutexes_[i].get(),
+        i % data_->shard_size()));
   }
 }
 
 template < typename D, typename M, typename L >
-void Test< D, M, L >::job(const callback_type &callback, ::std::mutex *mutex) {
+void Test< D, M, L >::job(
+    const callback_type &callback, ::std::mutex *mutex, size_type shard) {
   Local local{model_->clone(), L(), field_array(), index_pair(0, 1.0), 0.0,
               0.0, size_tensor(1)};
   M &model = local.model;
@@ -49,10 +54,8 @@ void Test< D, M, L >::job(const callback_type &callback, ::std::mutex *mutex) {
   size_tensor &data_position = local.data_position;
 
   value_type ratio;
-  count_ = 0;
-  objective_ = 0;
-  error_ = 0;
-  while (data_->getSample(&data_input, &data_label) == true) {
+  while (data_->getSample(
+             &shard, thread_size_, &data_input, &data_label) == true) {
     // Forward propagation
     mutex->lock();
     const tensor_type &data_output = model.forward(data_input);
@@ -26,9 +26,31 @@ template class Test< DoubleData, DoubleFNVModel, DoubleNLLLoss >;
 template class Test< FloatData, FloatFNVModel, FloatNLLLoss >;
 template class Test< DoubleData, DoubleCityModel, DoubleNLLLoss >;
 template class Test< FloatData, FloatCityModel, FloatNLLLoss >;
+template class Test< DoubleData, DoubleRollingModel, DoubleNLLLoss >;
+template class Test< FloatData, FloatRollingModel, FloatNLLLoss >;
 template class Test< DoubleData, DoubleFNVModel, DoubleHingeLoss >;
 template class Test< FloatData, FloatFNVModel, FloatHingeLoss >;
 template class Test< DoubleData, DoubleCityModel, DoubleHingeLoss >;
 template class Test< FloatData, FloatCityModel, FloatHingeLoss >;
+template class Test< DoubleData, DoubleRollingModel, DoubleHingeLoss >;
+template class Test< FloatData, FloatRollingModel, FloatHingeLoss >;
+template class Test< FloatData, HalfFNVModel, FloatNLLLoss >;
+template class Test< FloatData, HalfCityModel, FloatNLLLoss >;
+template class Test< FloatData, HalfRollingModel, FloatNLLLoss >;
+template class Test< FloatData, HalfFNVModel, FloatHingeLoss >;
+template class Test< FloatData, HalfCityModel, FloatHingeLoss >;
+template class Test< FloatData, HalfRollingModel, FloatHingeLoss >;
+template class Test< FloatData, QuantFNVModel, FloatNLLLoss >;
+template class Test< FloatData, QuantCityModel, FloatNLLLoss >;
+template class Test< FloatData, QuantRollingModel, FloatNLLLoss >;
+template class Test< FloatData, QuantFNVModel, FloatHingeLoss >;
+template class Test< FloatData, QuantCityModel, FloatHingeLoss >;
+template class Test< FloatData, QuantRollingModel, FloatHingeLoss >;
+template class Test< FloatData, SparseFNVModel, FloatNLLLoss >;
+template class Test< FloatData, SparseCityModel, FloatNLLLoss >;
+template class Test< FloatData, SparseRollingModel, FloatNLLLoss >;
+template class Test< FloatData, SparseFNVModel, FloatHingeLoss >;
+template class Test< FloatData, SparseCityModel, FloatHingeLoss >;
+template class Test< FloatData, SparseRollingModel, FloatHingeLoss >;
 
 }  // namespace bytesteady
@@ -57,7 +57,9 @@ class Test {
        ::std::numeric_limits< size_type >::max(), size_type t = 1);
 
   void test(const callback_type &callback);
-  void job(const callback_type &callback, ::std::mutex *mutex);
+  // Each job reads from its own data shards starting at shard
+  void job(const callback_type &callback, ::std::mutex *mutex,
+           size_type shard);
 
   void join();
 
@@ -91,11 +93,54 @@ typedef Test< DoubleData, DoubleFNVModel, DoubleNLLLoss > DoubleFNVNLLTest;
 typedef Test< FloatData, FloatFNVModel, FloatNLLLoss > FloatFNVNLLTest;
 typedef Test< DoubleData, DoubleCityModel, DoubleNLLLoss > DoubleCityNLLTest;
 typedef Test< FloatData, FloatCityModel, FloatNLLLoss > FloatCityNLLTest;
+typedef Test< DoubleData, DoubleRollingModel, DoubleNLLLoss >
+DoubleRollingNLLTest;
+typedef Test< FloatData, FloatRollingModel, FloatNLLLoss > FloatRollingNLLTest;
 typedef Test< DoubleData, DoubleFNVModel, DoubleHingeLoss > DoubleFNVHingeTest;
 typedef Test< FloatData, FloatFNVModel, FloatHingeLoss > FloatFNVHingeTest;
 typedef Test< DoubleData, DoubleCityModel, DoubleHingeLoss >
 DoubleCityHingeTest;
 typedef Test< FloatData, FloatCityModel, FloatHingeLoss > FloatCityHingeTest;
+typedef Test< DoubleData, DoubleRollingModel, DoubleHingeLoss >
+DoubleRollingHingeTest;
+typedef Test< FloatData, FloatRollingModel, FloatHingeLoss >
+FloatRollingHingeTest;
+typedef Test< FloatData, HalfFNVModel, FloatNLLLoss >
+HalfFNVNLLTest;
+typedef Test< FloatData, HalfCityModel, FloatNLLLoss >
+HalfCityNLLTest;
+typedef Test< FloatData, HalfRollingModel, FloatNLLLoss >
+HalfRollingNLLTest;
+typedef Test< FloatData, HalfFNVModel, FloatHingeLoss >
+HalfFNVHingeTest;
+typedef Test< FloatData, HalfCityModel, FloatHingeLoss >
+HalfCityHingeTest;
+typedef Test< FloatData, HalfRollingModel, FloatHingeLoss >
+HalfRollingHingeTest;
+typedef Test< FloatData, QuantFNVModel, FloatNLLLoss >
+QuantFNVNLLTest;
+typedef Test< FloatData, QuantCityModel, FloatNLLLoss >
+QuantCityNLLTest;
+typedef Test< FloatData, QuantRollingModel, FloatNLLLoss >
+QuantRollingNLLTest;
+typedef Test< FloatData, QuantFNVModel, FloatHingeLoss >
+QuantFNVHingeTest;
+typedef Test< FloatData, QuantCityModel, FloatHingeLoss >
+QuantCityHingeTest;
+typedef Test< FloatData, QuantRollingModel, FloatHingeLoss >
+QuantRollingHingeTest;
+typedef Test< FloatData, SparseFNVModel, FloatNLLLoss >
+SparseFNVNLLTest;
+typedef Test< FloatData, SparseCityModel, FloatNLLLoss >
+SparseCityNLLTest;
+typedef Test< FloatData, SparseRollingModel, FloatNLLLoss >
+SparseRollingNLLTest;
+typedef Test< FloatData, SparseFNVModel, FloatHingeLoss >
+SparseFNVHingeTest;
+typedef Test< FloatData, SparseCityModel, FloatHingeLoss >
+SparseCityHingeTest;
+typedef Test< FloatData, SparseRollingModel, FloatHingeLoss >
+SparseRollingHingeTest;
 
 }  // namespace bytesteady
 
@@ -106,10 +151,33 @@ extern template class Test< DoubleData, DoubleFNVModel, DoubleNLLLoss >;
 extern template class Test< FloatData, FloatFNVModel, FloatNLLLoss >;
 extern template class Test< DoubleData, DoubleCityModel, DoubleNLLLoss >;
 extern template class Test< FloatData, FloatCityModel, FloatNLLLoss >;
+extern template class Test< DoubleData, DoubleRollingModel, DoubleNLLLoss >;
+extern template class Test< FloatData, FloatRollingModel, FloatNLLLoss >;
 extern template class Test< DoubleData, DoubleFNVModel, DoubleHingeLoss >;
 extern template class Test< FloatData, FloatFNVModel, FloatHingeLoss >;
 extern template class Test< DoubleData, DoubleCityModel, DoubleHingeLoss >;
 extern template class Test< FloatData, FloatCityModel, FloatHingeLoss >;
+extern template class Test<
+  DoubleData, DoubleRollingModel, DoubleHingeLoss >;
+extern template class Test< FloatData, FloatRollingModel, FloatHingeLoss >;
+extern template class Test< FloatData, HalfFNVModel, FloatNLLLoss >;
+extern template class Test< FloatData, HalfCityModel, FloatNLLLoss >;
+extern template class Test< FloatData, HalfRollingModel, FloatNLLLoss >;
+extern template class Test< FloatData, HalfFNVModel, FloatHingeLoss >;
+extern template class Test< FloatData, HalfCityModel, FloatHingeLoss >;
+extern template class Test< FloatData, HalfRollingModel, FloatHingeLoss >;
+extern template class Test< FloatData, QuantFNVModel, FloatNLLLoss >;
+extern template class Test< FloatData, QuantCityModel, FloatNLLLoss >;
+extern template class Test< FloatData, QuantRollingModel, FloatNLLLoss >;
+extern template class Test< FloatData, QuantFNVModel, FloatHingeLoss >;
+extern template class Test< FloatData, QuantCityModel, FloatHingeLoss >;
+extern template class Test< FloatData, QuantRollingModel, FloatHingeLoss >;
+extern template class Test< FloatData, SparseFNVModel, FloatNLLLoss >;
+extern template class Test< FloatData, SparseCityModel, FloatNLLLoss >;
+extern template class Test< FloatData, SparseRollingModel, FloatNLLLoss >;
+extern template class Test< FloatData, SparseFNVModel, FloatHingeLoss >;
+extern template class Test< FloatData, SparseCityModel, FloatHingeLoss >;
+extern template class Test< FloatData, SparseRollingModel, FloatHingeLoss >;
 
 }  // namespace bytesteady
 
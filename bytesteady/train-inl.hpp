@@ -11,9 +11,11 @@
  * limitations under the License.
  */
 
-#include <memory>
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <thread>
+#include <utility>
 
 #include "bytesteady/train.hpp"
 
@@ -26,74 +28,154 @@ Train< D, U, M, L >::Train(
     value_type rho_val, size_type t, size_type s) :
     data_(d), universum_(u), model_(m), loss_(l), a_(a_val), b_(b_val),
     alpha_(alpha_val), lambda_(lambda_val), n_(n_val), rho_(rho_val),
-    thread_size_(t), step_(s), input_size_(m->input_embedding_size()),
-    label_size_(m->output_embedding_size()) {                  
-  updateRate();
-}
+    thread_size_(t), batch_size_(1), prefetch_size_(0), reader_size_(1),
+    step_(s), activation_count_(0), plan_count_(0),
+    input_size_(m->input_embedding_size()),
+    label_size_(m->output_embedding_size()), pause_(false), active_(0) {}
 
 template < typename D, typename U, typename M, typename L >
 void Train< D, U, M, L >::train(const callback_type &callback) {
   threads_.clear();
-  mutexes_.clear();
+  prefetch_.reset();
+  // Weight decay is lazy so that updates do not multiply whole rows
+  model_->set_lazy_decay(lambda_ != 0.0);
+  if (prefetch_size_ > 0) {
+    prefetch_.reset(new Prefetch< D >(data_, reader_size_, prefetch_size_));
+    drain_local_.reset(new Local{model_->clone(true)});
+    {
+      ::std::lock_guard< ::std::mutex > pause_lock(pause_mutex_);
+      models_.push_back(&drain_local_->model);
+    }
+    prefetch_->start();
+  }
   for (size_type i = 0; i < thread_size_; ++i) {
-    mutexes_.push_back(::std::make_shared< ::std::mutex >());
-    threads_.push_back(::std::thread(
-        &Train::job, this, callback, mutexes_[i].get()));
+    threads_.push_back(::std::thread([this, callback, i]() -> void {
+        placement_.pin(i);
+        job(callback, i % data_->shard_size());}));
   }
 }
 
 template < typename D, typename U, typename M, typename L >
-void Train< D, U, M, L >::job(
-    const callback_type &callback, ::std::mutex *mutex) {
+void Train< D, U, M, L >::job(const callback_type &callback, size_type shard) {
   Local local{model_->clone(true)};
   M &model = local.model;
-  L &loss = local.loss;
   field_array &data_input = local.data_input;
   index_pair &data_label = local.data_label;
-  value_type &data_objective = local.data_objective;
-  field_array &universum_input = local.universum_input;
-  index_pair &universum_label = local.universum_label;
-  value_type &universum_objective = local.universum_objective;
+  {
+    ::std::lock_guard< ::std::mutex > pause_lock(pause_mutex_);
+    models_.push_back(&model);
+  }
 
   // Get sample untill reaching end othe first epoch
-  while (data_->getSample(&data_input, &data_label) == true) {
-    mutex->lock();
+  while ((prefetch_ != nullptr ?
+          prefetch_->getSample(&data_input, &data_label) :
+          data_->getSample(
+              &shard, thread_size_, &data_input, &data_label)) == true) {
+    enter();
+    learn(&local);
+    leave();
+    if (prefetch_ != nullptr) {
+      prefetch_->done();
+    }
+    // Fold small pending decay scales while no thread is updating
+    if (model.folding() == true) {
+      fold();
+    }
+
+    // Execute callback
+    callback(local);
+  }
+  // Update the model with the last partial mini-batch
+  enter();
+  model.updateBatch(this->rate(step_.load(::std::memory_order_relaxed)),
+                    lambda_);
+  {
+    ::std::lock_guard< ::std::mutex > pause_lock(pause_mutex_);
+    models_.erase(::std::find(models_.begin(), models_.end(), &model));
+  }
+  leave();
+}
+
+template < typename D, typename U, typename M, typename L >
+void Train< D, U, M, L >::learn(Local *local) {
+  M &model = local->model;
+  L &loss = local->loss;
+  field_array &data_input = local->data_input;
+  index_pair &data_label = local->data_label;
+  value_type &data_objective = local->data_objective;
+  field_array &universum_input = local->universum_input;
+  index_pair &universum_label = local->universum_label;
+  value_type &universum_objective = local->universum_objective;
+  plan_array &data_plan = local->data_plan;
+  plan_array &universum_plan = local->universum_plan;
+
+  // Learning rate from a snapshot of the step count
+  value_type rate = this->rate(step_.load(::std::memory_order_relaxed));
+
+  // Forward propagation
+  size_type activation_count = model.plan(data_input, &data_plan);
+  size_type plan_count = data_plan.size();
+  const tensor_type &data_output = model.forward(data_plan);
+  data_objective = loss.forward(
+      data_output, data_label.first) * data_label.second;
+  // Backward propagation
+  const tensor_type &data_grad_output =
+      loss.backward(data_output, data_label.first);
+  data_grad_output.mul(data_label.second);
+  // Parameter update, or accumulation until the mini-batch is full
+  if (batch_size_ > 1) {
+    model.accumulate(data_plan, data_grad_output);
+    if (model.batch_size() >= batch_size_) {
+      model.updateBatch(rate, lambda_);
+    }
+  } else {
+    model.update(data_plan, data_grad_output, rate, lambda_);
+  }
+  // Get universum sample
+  for (size_type i = 0; i < n_ && universum_->getSample(
+           input_size_, label_size_, data_input, data_label, &universum_input,
+           &universum_label) == true; ++i) {
     // Forward propagation
-    const tensor_type &data_output = model.forward(data_input);
-    data_objective = loss.forward(
-        data_output, data_label.first) * data_label.second;
+    activation_count = activation_count + model.plan(
+        universum_input, &universum_plan);
+    plan_count = plan_count + universum_plan.size();
+    const tensor_type &universum_output = model.forward(universum_plan);
+    universum_objective = loss.forward(
+        universum_output, universum_label.first) * universum_label.second;
     // Backward propagation
-    const tensor_type &data_grad_output =
-        loss.backward(data_output, data_label.first);
-    data_grad_output.mul(data_label.second);
+    const tensor_type &universum_grad_output =
+        loss.backward(universum_output, universum_label.first);
+    universum_grad_output.mul(universum_label.second);
     // Parameter update
-    model.update(data_input, data_grad_output, rate_, lambda_);
-    // Get universum sample
-    for (size_type i = 0; i < n_ && universum_->getSample(
-             input_size_, label_size_, data_input, data_label, &universum_input,
-             &universum_label) == true; ++i) {
-      // Forward propagation
-      const tensor_type &universum_output = model.forward(universum_input);
-      universum_objective = loss.forward(
-          universum_output, universum_label.first) * universum_label.second;
-      // Backward propagation
-      const tensor_type &universum_grad_output =
-          loss.backward(universum_output, universum_label.first);
-      universum_grad_output.mul(universum_label.second);
-      // Parameter update
-      model.update(
-          universum_input, universum_grad_output, rate_ * rho_, lambda_);
-    }
+    model.update(
+        universum_plan, universum_grad_output, rate * rho_, lambda_);
+  }
 
-    // Update step count and learning rate
-    mutex->unlock();
-    step_mutex_.lock();
-    step_ = step_ + 1;
-    updateRate();
-    step_mutex_.unlock();
+  // Update step count
+  step_.fetch_add(1, ::std::memory_order_relaxed);
+  activation_count_.fetch_add(activation_count, ::std::memory_order_relaxed);
+  plan_count_.fetch_add(plan_count, ::std::memory_order_relaxed);
+}
 
-    // Execute callback
-    callback(local);
+template < typename D, typename U, typename M, typename L >
+void Train< D, U, M, L >::enter() {
+  active_.fetch_add(1);
+  while (pause_.load() == true) {
+    // Leave the active set until unlock() is called
+    ::std::unique_lock< ::std::mutex > pause_lock(pause_mutex_);
+    active_.fetch_sub(1);
+    pause_condition_.notify_all();
+    pause_condition_.wait(pause_lock, [this] {
+        return pause_.load() == false; });
+    active_.fetch_add(1);
+  }
+}
+
+template < typename D, typename U, typename M, typename L >
+void Train< D, U, M, L >::leave() {
+  if (active_.fetch_sub(1) == 1 && pause_.load() == true) {
+    ::std::lock_guard< ::std::mutex > pause_lock(pause_mutex_);
+    pause_condition_.notify_all();
   }
 }
 
@@ -102,32 +184,83 @@ void Train< D, U, M, L >::join() {
   for (::std::thread &thread : threads_) {
     thread.join();
   }
+  if (prefetch_ != nullptr) {
+    prefetch_->join();
+  }
+  // Update the model with the last partial mini-batch of lock()
+  if (drain_local_ != nullptr) {
+    drain_local_->model.updateBatch(rate(step_.load()), lambda_);
+    {
+      ::std::lock_guard< ::std::mutex > pause_lock(pause_mutex_);
+      models_.erase(::std::find(
+          models_.begin(), models_.end(), &drain_local_->model));
+    }
+    drain_local_.reset();
+  }
 }
 
 template < typename D, typename U, typename M, typename L >
 void Train< D, U, M, L >::lock() {
+  lock_mutex_.lock();
+  pause();
+}
+
+template < typename D, typename U, typename M, typename L >
+void Train< D, U, M, L >::pause() {
+  // Train the samples read ahead, since the data position counts them. The
+  // other threads may be waiting in lock(), so this thread takes them out.
+  if (prefetch_ != nullptr) {
+    prefetch_->drain([this](field_array *input, index_pair *label) -> void {
+        ::std::swap(drain_local_->data_input, *input);
+        ::std::swap(drain_local_->data_label, *label);
+        enter();
+        learn(drain_local_.get());
+        leave();
+      });
+  }
   // Lock the data reading operation
   data_->lock();
-  // Lock the threads
-  for (const ::std::shared_ptr< ::std::mutex > &mutex : mutexes_) {
-    mutex->lock();
+  // Wait for the threads to leave the active set
+  ::std::unique_lock< ::std::mutex > pause_lock(pause_mutex_);
+  pause_.store(true);
+  pause_condition_.wait(pause_lock, [this] { return active_.load() == 0; });
+  // Apply the mini-batches accumulated by the threads and pending weight
+  // decay, so that the parameters can be read
+  value_type rate = this->rate(step_.load());
+  for (M *model : models_) {
+    model->updateBatch(rate, lambda_);
   }
+  model_->normalize();
 }
 
 template < typename D, typename U, typename M, typename L >
-void Train< D, U, M, L >::unlock() {
-  // Unlock the data reading operation
-  data_->unlock();
-  // Unlock the threads
-  for (const ::std::shared_ptr< ::std::mutex > &mutex : mutexes_) {
-    mutex->unlock();
+void Train< D, U, M, L >::fold() {
+  // Threads that find another one folding, or the request already served,
+  // go on training
+  if (lock_mutex_.try_lock() == false) {
+    return;
   }
+  if (model_->folding() == false) {
+    lock_mutex_.unlock();
+    return;
+  }
+  pause();
+  unlock();
 }
 
 template < typename D, typename U, typename M, typename L >
-void Train< D, U, M, L >::updateRate() {
-  value_type ratio = 1.0 / (1.0 + alpha_ *  static_cast< value_type >(step_));
-  rate_ = ratio * a_ + (1.0 - ratio) * b_;
+void Train< D, U, M, L >::unlock() {
+  // Unlock the data reading operation
+  data_->unlock();
+  // Release the threads
+  pause_mutex_.lock();
+  pause_.store(false);
+  pause_mutex_.unlock();
+  pause_condition_.notify_all();
+  if (prefetch_ != nullptr) {
+    prefetch_->resume();
+  }
+  lock_mutex_.unlock();
 }
 
 template < typename D, typename U, typename M, typename L >
@@ -200,20 +333,80 @@ void Train< D, U, M, L >::set_thread_size(size_type t) {
   thread_size_ = t;
 }
 
+template < typename D, typename U, typename M, typename L >
+typename Train< D, U, M, L >::size_type Train< D, U, M, L >::batch_size() const {
+  return batch_size_;
+}
+
+template < typename D, typename U, typename M, typename L >
+void Train< D, U, M, L >::set_batch_size(size_type b) {
+  batch_size_ = b;
+}
+
+template < typename D, typename U, typename M, typename L >
+typename Train< D, U, M, L >::size_type
+Train< D, U, M, L >::prefetch_size() const {
+  return prefetch_size_;
+}
+
+template < typename D, typename U, typename M, typename L >
+void Train< D, U, M, L >::set_prefetch_size(size_type q) {
+  prefetch_size_ = q;
+}
+
+template < typename D, typename U, typename M, typename L >
+typename Train< D, U, M, L >::size_type
+Train< D, U, M, L >::reader_size() const {
+  return reader_size_;
+}
+
+template < typename D, typename U, typename M, typename L >
+void Train< D, U, M, L >::set_reader_size(size_type r) {
+  reader_size_ = r;
+}
+
+template < typename D, typename U, typename M, typename L >
+const Placement &Train< D, U, M, L >::placement() const {
+  return placement_;
+}
+
+template < typename D, typename U, typename M, typename L >
+void Train< D, U, M, L >::set_placement(const Placement &p) {
+  placement_ = p;
+}
+
 template < typename D, typename U, typename M, typename L >
 typename Train< D, U, M, L >::size_type Train< D, U, M, L >::step() const {
-  return step_;
+  return step_.load();
 }
 
 template < typename D, typename U, typename M, typename L >
 void Train< D, U, M, L >::set_step(size_type s) {
-  step_ = s;
-  updateRate();
+  step_.store(s);
 }
 
 template < typename D, typename U, typename M, typename L >
 typename Train< D, U, M, L >::value_type Train< D, U, M, L >::rate() const {
-  return rate_;
+  return rate(step_.load());
+}
+
+template < typename D, typename U, typename M, typename L >
+typename Train< D, U, M, L >::value_type Train< D, U, M, L >::rate(
+    size_type s) const {
+  value_type ratio = 1.0 / (1.0 + alpha_ * static_cast< value_type >(s));
+  return ratio * a_ + (1.0 - ratio) * b_;
+}
+
+template < typename D, typename U, typename M, typename L >
+typename Train< D, U, M, L >::size_type
+Train< D, U, M, L >::activation_count() const {
+  return activation_count_.load();
+}
+
+template < typename D, typename U, typename M, typename L >
+typename Train< D, U, M, L >::size_type
+Train< D, U, M, L >::plan_count() const {
+  return plan_count_.load();
 }
 
 }  // namespace bytesteady
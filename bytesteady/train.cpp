@@ -30,6 +30,10 @@ template class Train<
   DoubleData, DoubleUniversum, DoubleCityModel, DoubleNLLLoss >;
 template class Train<
   FloatData, FloatUniversum, FloatCityModel, FloatNLLLoss >;
+template class Train<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, FloatRollingModel, FloatNLLLoss >;
 template class Train<
   DoubleData, DoubleUniversum, DoubleFNVModel, DoubleHingeLoss >;
 template class Train<
@@ -38,4 +42,44 @@ template class Train<
   DoubleData, DoubleUniversum, DoubleCityModel, DoubleHingeLoss >;
 template class Train<
   FloatData, FloatUniversum, FloatCityModel, FloatHingeLoss >;
+template class Train<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, FloatRollingModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, HalfFNVModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, HalfCityModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, HalfRollingModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, HalfFNVModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, HalfCityModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, HalfRollingModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, QuantFNVModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, QuantCityModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, QuantRollingModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, QuantFNVModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, QuantCityModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, QuantRollingModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, SparseFNVModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, SparseCityModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, SparseRollingModel, FloatNLLLoss >;
+template class Train<
+  FloatData, FloatUniversum, SparseFNVModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, SparseCityModel, FloatHingeLoss >;
+template class Train<
+  FloatData, FloatUniversum, SparseRollingModel, FloatHingeLoss >;
 }  // namespace bytesteady
@@ -14,6 +14,8 @@
 #ifndef BYTESTEADY_TRAIN_HPP_
 #define BYTESTEADY_TRAIN_HPP_
 
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -23,6 +25,8 @@
 #include "bytesteady/data.hpp"
 #include "bytesteady/loss.hpp"
 #include "bytesteady/model.hpp"
+#include "bytesteady/placement.hpp"
+#include "bytesteady/prefetch.hpp"
 #include "bytesteady/universum.hpp"
 
 namespace bytesteady {
@@ -37,6 +41,7 @@ class Train {
   typedef L loss_type;
   typedef typename D::field_array field_array;
   typedef typename D::index_pair index_pair;
+  typedef typename M::plan_array plan_array;
   typedef typename M::size_storage size_storage;
   typedef typename M::size_type size_type;
   typedef typename M::tensor_type tensor_type;
@@ -51,6 +56,8 @@ class Train {
     field_array universum_input;
     index_pair universum_label = {0, 1.0};
     value_type universum_objective = 0.0;
+    plan_array data_plan;
+    plan_array universum_plan;
   };
   typedef Local local_type;
   typedef ::std::function< void (const Local &) > callback_type;
@@ -67,15 +74,20 @@ class Train {
         size_type s = 0);
 
   // Guarantee: when callback() is called, no mutex will be held by the thread.
+  // Threads update the shared parameters without locking (Hogwild).
   void train(const callback_type &callback);
-  void job(const callback_type &callback, ::std::mutex *mutex);
+  // Each job reads from its own data shards starting at shard
+  void job(const callback_type &callback, size_type shard);
 
   void join();
+  // Stop reading data and wait for all threads to finish their current
+  // sample. The caller trains the samples read ahead itself, so it can be one
+  // of the training threads. Pending mini-batches and weight decay are then
+  // applied to the model, and the parameters are not modified until unlock()
+  // is called.
   void lock();
   void unlock();
 
-  void updateRate();
-
   value_type a() const;
   void set_a(value_type a_val);
 
@@ -97,10 +109,33 @@ class Train {
   size_type thread_size() const;
   void set_thread_size(size_type t);
 
+  // Number of samples each thread accumulates before updating the model.
+  // Size 1 updates the model after every sample.
+  size_type batch_size() const;
+  void set_batch_size(size_type b);
+
+  // Number of slots of samples read ahead by reader threads, or 0 for the
+  // training threads to read their own shards
+  size_type prefetch_size() const;
+  void set_prefetch_size(size_type q);
+
+  size_type reader_size() const;
+  void set_reader_size(size_type r);
+
+  // Threads are pinned to the CPUs given by the placement policy
+  const Placement &placement() const;
+  void set_placement(const Placement &p);
+
   size_type step() const;
   void set_step(size_type s);
 
+  // Learning rate at current step or at the given step
   value_type rate() const;
+  value_type rate(size_type s) const;
+
+  // Number of activated embedding rows before and after coalescing
+  size_type activation_count() const;
+  size_type plan_count() const;
 
  private:
   // Foreign object pointers
@@ -117,18 +152,45 @@ class Train {
   size_type n_;
   value_type rho_;
   size_type thread_size_;
+  size_type batch_size_;
+  size_type prefetch_size_;
+  size_type reader_size_;
+  Placement placement_;
 
-  size_type step_;
-  value_type rate_;
+  ::std::atomic< size_type > step_;
+  ::std::atomic< size_type > activation_count_;
+  ::std::atomic< size_type > plan_count_;
   size_storage input_size_;
   size_type label_size_;
 
-  // Thread and mutex container
+  // Thread container
   ::std::vector< ::std::thread > threads_;
-  ::std::vector< ::std::shared_ptr< ::std::mutex > > mutexes_;
+  ::std::unique_ptr< Prefetch< D > > prefetch_;
 
-  // Mutex to update step and rate
-  ::std::mutex step_mutex_;
+  // Quiesce state for lock() and unlock(). Threads count themselves in
+  // active_ while processing a sample and wait on pause_condition_ if
+  // pause_ is set.
+  ::std::atomic< bool > pause_;
+  ::std::atomic< size_type > active_;
+  ::std::mutex pause_mutex_;
+  ::std::condition_variable pause_condition_;
+  // Held from lock() to unlock(), so that only one caller drains and pauses
+  ::std::mutex lock_mutex_;
+  // Local models of the running threads, whose pending mini-batches lock()
+  // applies. Guarded by pause_mutex_.
+  ::std::vector< M * > models_;
+  // Local state for the samples read ahead that lock() trains itself
+  ::std::unique_ptr< Local > drain_local_;
+
+  // Train the local model on its data sample and universum samples
+  void learn(Local *local);
+  // Enter the active set, waiting while lock() holds the threads, and leave
+  void enter();
+  void leave();
+  // Body of lock() after lock_mutex_ is taken
+  void pause();
+  // Fold pending decay scales once for all threads that saw the request
+  void fold();
 };
 
 typedef Train< DoubleData, DoubleUniversum, DoubleFNVModel, DoubleNLLLoss >
@@ -139,6 +201,10 @@ typedef Train< DoubleData, DoubleUniversum, DoubleCityModel, DoubleNLLLoss >
 DoubleCityNLLTrain;
 typedef Train< FloatData, FloatUniversum, FloatCityModel, FloatNLLLoss >
 FloatCityNLLTrain;
+typedef Train< DoubleData, DoubleUniversum, DoubleRollingModel, DoubleNLLLoss >
+DoubleRollingNLLTrain;
+typedef Train< FloatData, FloatUniversum, FloatRollingModel, FloatNLLLoss >
+FloatRollingNLLTrain;
 typedef Train< DoubleData, DoubleUniversum, DoubleFNVModel, DoubleHingeLoss >
 DoubleFNVHingeTrain;
 typedef Train< FloatData, FloatUniversum, FloatFNVModel, FloatHingeLoss >
@@ -147,6 +213,47 @@ typedef Train< DoubleData, DoubleUniversum, DoubleCityModel, DoubleHingeLoss >
 DoubleCityHingeTrain;
 typedef Train< FloatData, FloatUniversum, FloatCityModel, FloatHingeLoss >
 FloatCityHingeTrain;
+typedef Train<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleHingeLoss >
+DoubleRollingHingeTrain;
+typedef Train< FloatData, FloatUniversum, FloatRollingModel, FloatHingeLoss >
+FloatRollingHingeTrain;
+typedef Train< FloatData, FloatUniversum, HalfFNVModel, FloatNLLLoss >
+HalfFNVNLLTrain;
+typedef Train< FloatData, FloatUniversum, HalfCityModel, FloatNLLLoss >
+HalfCityNLLTrain;
+typedef Train< FloatData, FloatUniversum, HalfRollingModel, FloatNLLLoss >
+HalfRollingNLLTrain;
+typedef Train< FloatData, FloatUniversum, HalfFNVModel, FloatHingeLoss >
+HalfFNVHingeTrain;
+typedef Train< FloatData, FloatUniversum, HalfCityModel, FloatHingeLoss >
+HalfCityHingeTrain;
+typedef Train< FloatData, FloatUniversum, HalfRollingModel, FloatHingeLoss >
+HalfRollingHingeTrain;
+typedef Train< FloatData, FloatUniversum, QuantFNVModel, FloatNLLLoss >
+QuantFNVNLLTrain;
+typedef Train< FloatData, FloatUniversum, QuantCityModel, FloatNLLLoss >
+QuantCityNLLTrain;
+typedef Train< FloatData, FloatUniversum, QuantRollingModel, FloatNLLLoss >
+QuantRollingNLLTrain;
+typedef Train< FloatData, FloatUniversum, QuantFNVModel, FloatHingeLoss >
+QuantFNVHingeTrain;
+typedef Train< FloatData, FloatUniversum, QuantCityModel, FloatHingeLoss >
+QuantCityHingeTrain;
+typedef Train< FloatData, FloatUniversum, QuantRollingModel, FloatHingeLoss >
+QuantRollingHingeTrain;
+typedef Train< FloatData, FloatUniversum, SparseFNVModel, FloatNLLLoss >
+SparseFNVNLLTrain;
+typedef Train< FloatData, FloatUniversum, SparseCityModel, FloatNLLLoss >
+SparseCityNLLTrain;
+typedef Train< FloatData, FloatUniversum, SparseRollingModel, FloatNLLLoss >
+SparseRollingNLLTrain;
+typedef Train< FloatData, FloatUniversum, SparseFNVModel, FloatHingeLoss >
+SparseFNVHingeTrain;
+typedef Train< FloatData, FloatUniversum, SparseCityModel, FloatHingeLoss >
+SparseCityHingeTrain;
+typedef Train< FloatData, FloatUniversum, SparseRollingModel, FloatHingeLoss >
+SparseRollingHingeTrain;
 // Already exists: typedef DoubleFNVNLLTrain Train;
 
 }  // namespace bytesteady
@@ -162,6 +269,10 @@ extern template class Train<
   DoubleData, DoubleUniversum, DoubleCityModel, DoubleNLLLoss >;
 extern template class Train<
   FloatData, FloatUniversum, FloatCityModel, FloatNLLLoss >;
+extern template class Train<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, FloatRollingModel, FloatNLLLoss >;
 extern template class Train<
   DoubleData, DoubleUniversum, DoubleFNVModel, DoubleHingeLoss >;
 extern template class Train<
@@ -170,6 +281,46 @@ extern template class Train<
   DoubleData, DoubleUniversum, DoubleCityModel, DoubleHingeLoss >;
 extern template class Train<
   FloatData, FloatUniversum, FloatCityModel, FloatHingeLoss >;
+extern template class Train<
+  DoubleData, DoubleUniversum, DoubleRollingModel, DoubleHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, FloatRollingModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, HalfFNVModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, HalfCityModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, HalfRollingModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, HalfFNVModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, HalfCityModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, HalfRollingModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, QuantFNVModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, QuantCityModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, QuantRollingModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, QuantFNVModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, QuantCityModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, QuantRollingModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, SparseFNVModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, SparseCityModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, SparseRollingModel, FloatNLLLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, SparseFNVModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, SparseCityModel, FloatHingeLoss >;
+extern template class Train<
+  FloatData, FloatUniversum, SparseRollingModel, FloatHingeLoss >;
 
 }  // namespace bytesteady
 
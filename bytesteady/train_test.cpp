@@ -13,6 +13,9 @@
 
 #include "bytesteady/train.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
 #include <iostream>
 #include <mutex>
@@ -20,6 +23,7 @@
 #include <sstream>
 #include <thread>
 
+#include "bytesteady/test.hpp"
 #include "gtest/gtest.h"
 
 namespace bytesteady {
@@ -183,6 +187,10 @@ void trainTest() {
     train.train(callback);
     train.lock();
     printf("Locked train\n");
+    // No thread makes progress while locked
+    size_type locked_step = train.step();
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds(10));
+    EXPECT_EQ(locked_step, train.step());
     train.unlock();
     printf("Unlocked train\n");
     train.join();
@@ -196,5 +204,208 @@ TEST(TrainTest, trainTest) {
   trainTest< DoubleFNVNLLTrain >();
 }
 
+template < typename T >
+void decayTest() {
+  typedef typename T::callback_type callback_type;
+  typedef typename T::data_type data_type;
+  typedef typename T::loss_type loss_type;
+  typedef typename T::model_type model_type;
+  typedef typename T::local_type local_type;
+  typedef typename T::universum_type universum_type;
+  typedef typename data_type::format_array format_array;
+  typedef typename model_type::size_type size_type;
+  typedef typename model_type::tensor_array tensor_array;
+  typedef typename model_type::value_type value_type;
+
+  data_type data("bytesteady/unittest_train.txt", format_array{kBytes, kIndex});
+  universum_type universum;
+  model_type model({1000, 16}, 4, 10, {{1,2,4,8},{}}, 1946);
+  model.initialize(0.0, 1.0);
+  loss_type loss;
+
+  // Decay strong enough for the shared scales to be folded several times
+  // while other threads keep updating the same rows
+  T train(&data, &universum, &model, &loss, 0.05, 0.0, 0.0, 1.0, 0, 0.0, 4);
+  ::std::mutex callback_mutex;
+  value_type objective = 0.0;
+  callback_type callback = [&](const local_type &local) -> void {
+    ::std::lock_guard< ::std::mutex > lock(callback_mutex);
+    objective = objective + local.data_objective;
+  };
+  size_type epoches = 20;
+  value_type first_objective = 0.0;
+  for (size_type i = 0; i < epoches; ++i) {
+    objective = 0.0;
+    data.rewind();
+    train.train(callback);
+    train.join();
+    if (i == 0) {
+      first_objective = objective;
+    }
+  }
+  printf("Decay first objective = %.8g, last objective = %.8g\n",
+         first_objective, objective);
+  EXPECT_LT(objective, first_objective);
+  const tensor_array &input_embedding = model.input_embedding();
+  for (size_type i = 0; i < input_embedding.size(); ++i) {
+    EXPECT_TRUE(::std::isfinite(input_embedding[i].mean()));
+    EXPECT_TRUE(::std::isfinite(input_embedding[i].std()));
+  }
+  EXPECT_TRUE(::std::isfinite(model.output_embedding().mean()));
+  EXPECT_TRUE(::std::isfinite(model.output_embedding().std()));
+}
+
+TEST(TrainTest, decayTest) {
+  decayTest< DoubleFNVNLLTrain >();
+}
+
+template < typename T >
+void batchLockTest() {
+  typedef typename T::callback_type callback_type;
+  typedef typename T::data_type data_type;
+  typedef typename T::loss_type loss_type;
+  typedef typename T::model_type model_type;
+  typedef typename T::local_type local_type;
+  typedef typename T::universum_type universum_type;
+  typedef typename data_type::format_array format_array;
+  typedef typename model_type::size_type size_type;
+  typedef typename model_type::tensor_type tensor_type;
+
+  data_type data("bytesteady/unittest_train.txt", format_array{kBytes, kIndex});
+  universum_type universum;
+  model_type model({1000, 16}, 4, 10, {{1,2,4,8},{}}, 1946);
+  model.initialize(0.0, 1.0);
+  loss_type loss;
+  tensor_type output_embedding = model.output_embedding().clone();
+
+  // The mini-batch is larger than the data, so only lock() can apply it
+  T train(&data, &universum, &model, &loss, 0.01, 0.0, 0.0, 0.0, 0, 0.0, 2);
+  train.set_batch_size(64);
+  bool changed = false;
+  ::std::atomic< bool > checked(false);
+  callback_type callback = [&](const local_type &local) -> void {
+    if (train.step() >= 10 && checked.exchange(true) == false) {
+      train.lock();
+      const tensor_type &locked_embedding = model.output_embedding();
+      for (size_type i = 0; i < output_embedding.size(0); ++i) {
+        for (size_type j = 0; j < output_embedding.size(1); ++j) {
+          changed = changed ||
+              output_embedding(i, j) != locked_embedding(i, j);
+        }
+      }
+      train.unlock();
+    }
+  };
+  data.rewind();
+  train.train(callback);
+  train.join();
+  EXPECT_TRUE(changed);
+}
+
+TEST(TrainTest, batchLockTest) {
+  batchLockTest< DoubleFNVNLLTrain >();
+}
+
+template < typename T >
+void prefetchLockTest(typename T::size_type threads) {
+  typedef typename T::callback_type callback_type;
+  typedef typename T::data_type data_type;
+  typedef typename T::loss_type loss_type;
+  typedef typename T::model_type model_type;
+  typedef typename T::local_type local_type;
+  typedef typename T::universum_type universum_type;
+  typedef typename data_type::format_array format_array;
+  typedef typename model_type::size_type size_type;
+
+  data_type data("bytesteady/unittest_train.txt", format_array{kBytes, kIndex},
+                 2);
+  universum_type universum;
+  model_type model({1000, 16}, 4, 10, {{1,2,4,8},{}}, 1946);
+  model.initialize(0.0, 1.0);
+  loss_type loss;
+
+  // Lock from the training threads while samples wait in the ring, which
+  // only the locking thread can take out when the others wait for the lock
+  T train(&data, &universum, &model, &loss, 0.01, 0.0, 0.0, 0.0, 0, 0.0,
+          threads);
+  train.set_prefetch_size(16);
+  train.set_reader_size(2);
+  ::std::atomic< size_type > locks(0);
+  callback_type callback = [&](const local_type &local) -> void {
+    train.lock();
+    ++locks;
+    train.unlock();
+  };
+  size_type epoches = 5;
+  for (size_type i = 0; i < epoches; ++i) {
+    data.rewind();
+    train.train(callback);
+    train.join();
+  }
+  // Every sample read is trained once
+  EXPECT_EQ(epoches * 20, train.step());
+  EXPECT_LT(0, locks.load());
+}
+
+TEST(TrainTest, prefetchLockTest) {
+  prefetchLockTest< DoubleFNVNLLTrain >(1);
+  prefetchLockTest< DoubleFNVNLLTrain >(4);
+}
+
+template < typename T, typename S >
+void halfTrain(typename T::value_type *objective,
+               typename T::value_type *error) {
+  typedef typename T::callback_type callback_type;
+  typedef typename T::data_type data_type;
+  typedef typename T::loss_type loss_type;
+  typedef typename T::model_type model_type;
+  typedef typename T::local_type local_type;
+  typedef typename T::universum_type universum_type;
+  typedef typename data_type::format_array format_array;
+  typedef typename model_type::size_type size_type;
+
+  data_type data("bytesteady/unittest_train.txt", format_array{kBytes, kIndex});
+  universum_type universum;
+  model_type model({1000, 16}, 4, 10, {{1,2,4,8},{}}, 1946);
+  model.initialize(0.0, 1.0);
+  loss_type loss;
+
+  // Updates are mostly below half a bfloat16 unit of the embedding values
+  T train(&data, &universum, &model, &loss, 0.002, 0.0, 0.0, 0.0, 0, 0.0, 1);
+  callback_type callback = [](const local_type &local) -> void {};
+  size_type epoches = 50;
+  for (size_type i = 0; i < epoches; ++i) {
+    data.rewind();
+    train.train(callback);
+    train.join();
+  }
+  data.rewind();
+  S test(&data, &model, &loss);
+  test.test([](const typename S::local_type &local) -> void {});
+  test.join();
+  *objective = test.objective();
+  *error = test.error();
+}
+
+TEST(TrainTest, halfTest) {
+  double double_objective, double_error;
+  halfTrain< DoubleFNVNLLTrain, DoubleFNVNLLTest >(
+      &double_objective, &double_error);
+  // Stochastic rounding makes every half run different, so average a few
+  const int runs = 4;
+  float half_objective = 0.0f, half_error = 0.0f;
+  for (int i = 0; i < runs; ++i) {
+    float objective, error;
+    halfTrain< HalfFNVNLLTrain, HalfFNVNLLTest >(&objective, &error);
+    half_objective = half_objective + objective / runs;
+    half_error = half_error + error / runs;
+  }
+  printf("Half double objective = %.8g, double error = %.8g, "
+         "half objective = %.8g, half error = %.8g\n", double_objective,
+         double_error, half_objective, half_error);
+  EXPECT_NEAR(double_objective, half_objective, 0.05 * double_objective);
+  EXPECT_NEAR(double_error, half_error, 0.1);
+}
+
 }  // namespace
 }  // namespace bytesteady
@@ -18,6 +18,8 @@
 #include <random>
 #include <utility>
 
+#include "bytesteady/field_format.hpp"
+
 namespace bytesteady {
 
 template < typename T >
@@ -31,27 +33,28 @@ bool Universum< T >::getSample(
     const size_storage &input_size, size_type label_size,
     const field_array &data_input, const index_pair &data_label,
     field_array *universum_input, index_pair *universum_label) {
-  universum_input->clear();
+  universum_input->resize(data_input.size());
   ::std::lock_guard< ::std::mutex > lock(random_mutex_);
   const index_array *data_field_index;
   const byte_array *data_field_bytes;
   for (size_type i = 0; i < data_input.size(); ++i) {
     if ((data_field_index = ::std::get_if< index_array >(&data_input[i]))
         != nullptr) {
-      index_array universum_field_index;
+      index_array &universum_field_index =
+          *resetField< index_array >(universum_input, i);
       for (size_type j = 0; j < data_field_index->size(); ++j) {
         universum_field_index.push_back(::std::make_pair(
             index_distribution_(generator_) % input_size[i],
             (*data_field_index)[j].second));
       }
-      universum_input->push_back(universum_field_index);
     } else if ((data_field_bytes = ::std::get_if< byte_array >(&data_input[i]))
                != nullptr) {
-      byte_array universum_field_bytes(data_field_bytes->size());
+      byte_array &universum_field_bytes =
+          *resetField< byte_array >(universum_input, i);
+      universum_field_bytes.resize(data_field_bytes->size());
       for (size_type j = 0; j < universum_field_bytes.size(); ++j) {
         universum_field_bytes[j] = byte_distribution_(generator_);
       }
-      universum_input->push_back(universum_field_bytes);
     } else {
       return false;
     }